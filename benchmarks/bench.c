@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <bench.h>
+#include <swf.h>
+#include <utils.h>
+
+#define DEFAULT_SAMPLES 100
+#define DEFAULT_WARMUP 10
+#define TARGET_SAMPLE_NS 1000000
+#define MAX_ITERATIONS (1ull << 32)
+
+int benchInit(BenchRunner* runner, const char* suite, int argc, char** argv)
+{
+	memset(runner, 0, sizeof(BenchRunner));
+	runner->samples = DEFAULT_SAMPLES;
+	runner->warmup = DEFAULT_WARMUP;
+	runner->target_sample_ns = TARGET_SAMPLE_NS;
+	
+	const char* json_path = NULL;
+	
+	for (int i = 1; i < argc; ++i)
+	{
+		if (i + 1 == argc)
+		{
+			fprintf(stderr, "Missing value for %s\n", argv[i]);
+			return 1;
+		}
+		
+		if (!strcmp(argv[i], "--json"))
+		{
+			json_path = argv[++i];
+		}
+		
+		else if (!strcmp(argv[i], "--filter"))
+		{
+			runner->filter = argv[++i];
+		}
+		
+		else if (!strcmp(argv[i], "--samples"))
+		{
+			runner->samples = (u32) strtoul(argv[++i], NULL, 10);
+		}
+		
+		else if (!strcmp(argv[i], "--warmup"))
+		{
+			runner->warmup = (u32) strtoul(argv[++i], NULL, 10);
+		}
+		
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	
+	if (runner->samples == 0)
+	{
+		fprintf(stderr, "--samples must be at least 1\n");
+		return 1;
+	}
+	
+	if (json_path != NULL)
+	{
+		runner->json = fopen(json_path, "w");
+		
+		if (runner->json == NULL)
+		{
+			fprintf(stderr, "Couldn't open %s\n", json_path);
+			return 1;
+		}
+		
+		fprintf(runner->json, "{\n  \"suite\": \"%s\",\n  \"benchmarks\": [", suite);
+	}
+	
+	runner->sample_ns = malloc(runner->samples*sizeof(double));
+	
+	printf("%-44s %12s %12s %12s\n", "benchmark", "median ns", "p99 ns", "iterations");
+	
+	return 0;
+}
+
+static int compareDoubles(const void* a, const void* b)
+{
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	
+	return (x > y) - (x < y);
+}
+
+// Double the count until one sample is long enough to time reliably
+static u64 calibrate(BenchRunner* runner, BenchFunc func, void* user)
+{
+	u64 iterations = 1;
+	
+	while (iterations < MAX_ITERATIONS)
+	{
+		u64 start = get_elapsed_ns();
+		func(user, iterations);
+		u64 elapsed = get_elapsed_ns() - start;
+		
+		if (elapsed >= runner->target_sample_ns)
+		{
+			break;
+		}
+		
+		// Jump most of the way once the timing means something
+		if (elapsed > runner->target_sample_ns/16)
+		{
+			iterations = iterations*runner->target_sample_ns/elapsed + 1;
+			break;
+		}
+		
+		iterations *= 2;
+	}
+	
+	return iterations;
+}
+
+void benchRun(BenchRunner* runner, const char* name, BenchFunc func, void* user)
+{
+	if (runner->filter != NULL && strstr(name, runner->filter) == NULL)
+	{
+		return;
+	}
+	
+	u64 iterations = calibrate(runner, func, user);
+	
+	for (u32 i = 0; i < runner->warmup; ++i)
+	{
+		func(user, iterations);
+	}
+	
+	double total = 0.0;
+	
+	for (u32 i = 0; i < runner->samples; ++i)
+	{
+		u64 start = get_elapsed_ns();
+		func(user, iterations);
+		u64 elapsed = get_elapsed_ns() - start;
+		
+		runner->sample_ns[i] = (double) elapsed/iterations;
+		total += runner->sample_ns[i];
+	}
+	
+	u32 n = runner->samples;
+	qsort(runner->sample_ns, n, sizeof(double), compareDoubles);
+	
+	double median = n & 1 ? runner->sample_ns[n/2] : (runner->sample_ns[n/2 - 1] + runner->sample_ns[n/2])/2;
+	double p99 = runner->sample_ns[(99*n + 99)/100 - 1];
+	double min = runner->sample_ns[0];
+	double mean = total/n;
+	
+	printf("%-44s %12.2f %12.2f %12llu\n", name, median, p99, (unsigned long long) iterations);
+	fflush(stdout);
+	
+	if (runner->json != NULL)
+	{
+		fprintf(runner->json,
+		        "%s\n    {\"name\": \"%s\", \"iterations\": %llu, \"samples\": %u, "
+		        "\"median_ns\": %.3f, \"p99_ns\": %.3f, \"min_ns\": %.3f, \"mean_ns\": %.3f}",
+		        runner->num_results == 0 ? "" : ",", name, (unsigned long long) iterations, n,
+		        median, p99, min, mean);
+	}
+	
+	runner->num_results += 1;
+}
+
+void benchFinish(BenchRunner* runner)
+{
+	if (runner->json != NULL)
+	{
+		fprintf(runner->json, "\n  ]\n}\n");
+		fclose(runner->json);
+	}
+	
+	free(runner->sample_ns);
+}
\ No newline at end of file
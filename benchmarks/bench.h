@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <common.h>
+
+/**
+ * Benchmark Harness
+ *
+ * Times a function that runs a measured operation a given number of
+ * times. The count is calibrated so one sample takes about a
+ * millisecond, then warmup samples are discarded and the rest are
+ * reported as ns per operation: median, p99, min and mean, on stdout
+ * and optionally as JSON for comparing runs.
+ *
+ * Command line options:
+ *   --json <path>     Also write results as JSON to path
+ *   --filter <text>   Only run benchmarks whose name contains text
+ *   --samples <n>     Measured samples per benchmark (default 100)
+ *   --warmup <n>      Discarded samples per benchmark (default 10)
+ */
+
+/**
+ * Runs the measured operation
+ *
+ * @param user User pointer given to benchRun
+ * @param iterations How many times to run it
+ */
+typedef void (*BenchFunc)(void* user, u64 iterations);
+
+typedef struct
+{
+	const char* filter;
+	u32 samples;
+	u32 warmup;
+	u64 target_sample_ns;
+	
+	FILE* json;
+	u32 num_results;
+	
+	double* sample_ns;
+} BenchRunner;
+
+/**
+ * Parse options and open the JSON output
+ *
+ * @return Nonzero if the options were invalid
+ */
+int benchInit(BenchRunner* runner, const char* suite, int argc, char** argv);
+
+void benchRun(BenchRunner* runner, const char* name, BenchFunc func, void* user);
+
+/**
+ * Close the JSON output and free the runner
+ */
+void benchFinish(BenchRunner* runner);
\ No newline at end of file
@@ -0,0 +1,385 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <bench.h>
+#include <action.h>
+#include <actionstack.h>
+#include <variables.h>
+#include <sharedstring.h>
+#include <tracesink.h>
+#include <frameclock.h>
+#include <number.h>
+#include <heap.h>
+
+/**
+ * Action Op Benchmarks
+ *
+ * Times every op in action.h, variable access by id and by name as the
+ * number of dynamic variables grows, and string concatenation chains.
+ *
+ * Each op is timed together with the pushes that feed it and the pop of
+ * its result, so a benchmark leaves the stack as it found it. Compare
+ * the same benchmark across builds rather than ops against each other.
+ */
+
+#define MAX_STRING_ID 256
+
+// Constant string id naming the variable used by the id paths
+#define VAR_ID 1
+
+#define NAME_STRIDE 16
+
+#define PUSH_LITERAL(s, id) PUSH_STR_ID(s, sizeof(s) - 1, id)
+
+static volatile u64 result_sink;
+
+static inline void pushF32(SWFAppContext* app_context, float v)
+{
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &v));
+}
+
+static inline void pushF64(SWFAppContext* app_context, double v)
+{
+	PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &v));
+}
+
+#define BENCH_OP(name, ...) \
+	static void bench_##name(void* user, u64 iterations) \
+	{ \
+		SWFAppContext* app_context = (SWFAppContext*) user; \
+		char a_str[CONVERT_STRING_SIZE]; \
+		char b_str[CONVERT_STRING_SIZE]; \
+		(void) a_str; \
+		(void) b_str; \
+		\
+		for (u64 i = 0; i < iterations; ++i) \
+		{ \
+			__VA_ARGS__ \
+		} \
+	}
+
+#define BENCH_BINARY(name, push_a, push_b, op) \
+	BENCH_OP(name, push_a; push_b; op; POP();)
+
+#define BENCH_TYPED(name) \
+	BENCH_BINARY(name##_f32, pushF32(app_context, 3.0f), pushF32(app_context, 5.0f), action##name##F32(app_context)) \
+	BENCH_BINARY(name##_f64, pushF64(app_context, 3.0), pushF64(app_context, 5.0), action##name##F64(app_context)) \
+	BENCH_BINARY(name##_mixed, pushF32(app_context, 3.0f), pushF64(app_context, 5.0), action##name##Mixed(app_context)) \
+	BENCH_BINARY(name##_str_num, PUSH_LITERAL("12.5", 0), pushF32(app_context, 5.0f), action##name##StrNum(app_context))
+
+BENCH_BINARY(add, pushF32(app_context, 3.0f), pushF32(app_context, 5.0f), actionAdd(app_context))
+BENCH_BINARY(subtract, pushF32(app_context, 3.0f), pushF32(app_context, 5.0f), actionSubtract(app_context))
+BENCH_BINARY(multiply, pushF32(app_context, 3.0f), pushF32(app_context, 5.0f), actionMultiply(app_context))
+BENCH_BINARY(divide, pushF32(app_context, 3.0f), pushF32(app_context, 5.0f), actionDivide(app_context))
+BENCH_BINARY(equals, pushF32(app_context, 3.0f), pushF32(app_context, 5.0f), actionEquals(app_context))
+BENCH_BINARY(less, pushF32(app_context, 3.0f), pushF32(app_context, 5.0f), actionLess(app_context))
+BENCH_BINARY(and, pushF32(app_context, 1.0f), pushF32(app_context, 0.0f), actionAnd(app_context))
+BENCH_BINARY(or, pushF32(app_context, 1.0f), pushF32(app_context, 0.0f), actionOr(app_context))
+BENCH_BINARY(numeric_op, pushF32(app_context, 3.0f), pushF64(app_context, 5.0), actionNumericOp(app_context, ACTION_NUMERIC_OP_ADD))
+
+BENCH_TYPED(Add)
+BENCH_TYPED(Subtract)
+BENCH_TYPED(Multiply)
+BENCH_TYPED(Divide)
+BENCH_TYPED(Equals)
+BENCH_TYPED(Less)
+
+BENCH_BINARY(string_equals, PUSH_LITERAL("abc", 0), PUSH_LITERAL("abd", 0), actionStringEquals(app_context, a_str, b_str))
+BENCH_BINARY(string_add, PUSH_LITERAL("foo", 0), PUSH_LITERAL("bar", 0), actionStringAdd(app_context, a_str, b_str))
+
+BENCH_OP(push_pop, pushF32(app_context, 1.0f); POP();)
+BENCH_OP(not, pushF32(app_context, 1.0f); actionNot(app_context); POP();)
+BENCH_OP(evaluate_condition, pushF32(app_context, 1.0f); result_sink += evaluateCondition(app_context);)
+BENCH_OP(add_const, pushF32(app_context, 3.0f); actionAddConst(app_context, 1.0f); POP();)
+BENCH_OP(add_const_f64, pushF64(app_context, 3.0); actionAddConstF64(app_context, 1.0); POP();)
+BENCH_OP(increment_var_by_id, actionIncrementVarById(app_context, VAR_ID);)
+BENCH_OP(compare_var_const_branch, result_sink += actionCompareVarConstBranch(app_context, VAR_ID, 1e9f);)
+BENCH_OP(string_length, PUSH_LITERAL("hello", 0); actionStringLength(app_context, a_str); POP();)
+BENCH_OP(push_var, pushVar(app_context, getVariableById(app_context, VAR_ID)); POP();)
+BENCH_OP(get_variable_by_id, actionGetVariableById(app_context, VAR_ID); POP();)
+BENCH_OP(set_variable_by_id, pushF32(app_context, 2.0f); actionSetVariableById(app_context, VAR_ID);)
+BENCH_OP(get_variable_const_name, PUSH_LITERAL("v", VAR_ID); actionGetVariable(app_context); POP();)
+BENCH_OP(set_variable_const_name, PUSH_LITERAL("v", VAR_ID); pushF32(app_context, 2.0f); actionSetVariable(app_context);)
+BENCH_OP(trace, PUSH_LITERAL("hello", 0); actionTrace(app_context);)
+BENCH_OP(get_time, actionGetTime(app_context); POP();)
+
+typedef struct
+{
+	SWFAppContext* app_context;
+	
+	// NAME_STRIDE bytes per name, count is a power of two
+	char* names;
+	u32 count;
+	u32 next;
+	
+	// Segments per concat chain
+	u32 length;
+} VarBench;
+
+// An odd stride visits every name before repeating, in cache-unfriendly order
+static inline const char* nextName(VarBench* bench)
+{
+	bench->next = (bench->next + 40503) & (bench->count - 1);
+	
+	return bench->names + bench->next*NAME_STRIDE;
+}
+
+static void benchGetByName(void* user, u64 iterations)
+{
+	VarBench* bench = (VarBench*) user;
+	SWFAppContext* app_context = bench->app_context;
+	
+	for (u64 i = 0; i < iterations; ++i)
+	{
+		const char* name = nextName(bench);
+		PUSH_STR((char*) name, (u32) strlen(name));
+		actionGetVariable(app_context);
+		POP();
+	}
+}
+
+static void benchSetByName(void* user, u64 iterations)
+{
+	VarBench* bench = (VarBench*) user;
+	SWFAppContext* app_context = bench->app_context;
+	
+	for (u64 i = 0; i < iterations; ++i)
+	{
+		const char* name = nextName(bench);
+		PUSH_STR((char*) name, (u32) strlen(name));
+		pushF32(app_context, 2.0f);
+		actionSetVariable(app_context);
+	}
+}
+
+static void pushChain(SWFAppContext* app_context, u32 length, char* a_str, char* b_str)
+{
+	PUSH_LITERAL("segment", 0);
+	
+	for (u32 i = 1; i < length; ++i)
+	{
+		PUSH_LITERAL("segment", 0);
+		actionStringAdd(app_context, a_str, b_str);
+	}
+}
+
+static void benchConcatChain(void* user, u64 iterations)
+{
+	VarBench* bench = (VarBench*) user;
+	SWFAppContext* app_context = bench->app_context;
+	char a_str[CONVERT_STRING_SIZE];
+	char b_str[CONVERT_STRING_SIZE];
+	
+	for (u64 i = 0; i < iterations; ++i)
+	{
+		pushChain(app_context, bench->length, a_str, b_str);
+		POP();
+	}
+}
+
+static void benchMaterialize(void* user, u64 iterations)
+{
+	VarBench* bench = (VarBench*) user;
+	SWFAppContext* app_context = bench->app_context;
+	char a_str[CONVERT_STRING_SIZE];
+	char b_str[CONVERT_STRING_SIZE];
+	
+	for (u64 i = 0; i < iterations; ++i)
+	{
+		pushChain(app_context, bench->length, a_str, b_str);
+		releaseSharedString(app_context, materializeStringList(app_context));
+		POP();
+	}
+}
+
+static void discardTrace(const char* data, size_t size, void* user)
+{
+	result_sink += size;
+}
+
+static void initContext(SWFAppContext* app_context)
+{
+	memset(app_context, 0, sizeof(SWFAppContext));
+	app_context->max_string_id = MAX_STRING_ID;
+	
+	heap_init(app_context, HEAP_SIZE);
+	initActionStack(app_context);
+	
+	app_context->str_list_arena = (u64*) HALLOC(STR_LIST_ARENA_SIZE);
+	
+	initVarArray(app_context, MAX_STRING_ID);
+	initNumberCache(app_context, MAX_STRING_ID);
+	initFrameClock(app_context);
+	initMap(app_context);
+
+#ifdef SWF_OP_PAIR_PROFILE
+	opProfileInit(app_context);
+#endif
+
+#ifdef SWF_OP_CYCLE_PROFILE
+	opCycleProfileInit(app_context);
+#endif
+	
+	pushF32(app_context, 0.0f);
+	actionSetVariableById(app_context, VAR_ID);
+}
+
+static void freeContext(SWFAppContext* app_context)
+{
+#ifdef SWF_OP_PAIR_PROFILE
+	opProfileShutdown(app_context, stderr, 64);
+#endif
+
+#ifdef SWF_OP_CYCLE_PROFILE
+	opCycleProfileShutdown(app_context, stderr);
+#endif
+	
+	freeMap(app_context);
+	freeNumberCache(app_context);
+	FREE(app_context->str_list_arena);
+	freeActionStack(app_context);
+	
+	heap_shutdown(app_context);
+}
+
+static int failed;
+
+// Every benchmark has to leave the stack balanced, or the numbers after
+// it measure a different stack
+static void run(BenchRunner* runner, const char* name, BenchFunc func, void* user, SWFAppContext* app_context)
+{
+	benchRun(runner, name, func, user);
+	
+	if (SP != INITIAL_SP)
+	{
+		fprintf(stderr, "%s left the stack unbalanced\n", name);
+		SP = INITIAL_SP;
+		failed = 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchRunner runner;
+	
+	if (benchInit(&runner, "actions", argc, argv))
+	{
+		return 1;
+	}
+	
+	SWFAppContext context;
+	SWFAppContext* app_context = &context;
+	initContext(app_context);
+	
+	TraceSinkConfig count_only = { TRACE_COUNT_ONLY };
+	traceSinkInit(app_context, &count_only);
+
+#define RUN_OP(name) run(&runner, "op/" #name, bench_##name, app_context, app_context);
+	
+	RUN_OP(push_pop)
+	RUN_OP(add)
+	RUN_OP(subtract)
+	RUN_OP(multiply)
+	RUN_OP(divide)
+	RUN_OP(equals)
+	RUN_OP(less)
+	RUN_OP(and)
+	RUN_OP(or)
+	RUN_OP(not)
+	RUN_OP(numeric_op)
+	RUN_OP(evaluate_condition)
+
+#define RUN_TYPED(name) \
+	RUN_OP(name##_f32) \
+	RUN_OP(name##_f64) \
+	RUN_OP(name##_mixed) \
+	RUN_OP(name##_str_num)
+	
+	RUN_TYPED(Add)
+	RUN_TYPED(Subtract)
+	RUN_TYPED(Multiply)
+	RUN_TYPED(Divide)
+	RUN_TYPED(Equals)
+	RUN_TYPED(Less)
+	
+	RUN_OP(add_const)
+	RUN_OP(add_const_f64)
+	RUN_OP(increment_var_by_id)
+	RUN_OP(compare_var_const_branch)
+	RUN_OP(string_equals)
+	RUN_OP(string_length)
+	RUN_OP(string_add)
+	RUN_OP(push_var)
+	RUN_OP(get_variable_by_id)
+	RUN_OP(set_variable_by_id)
+	RUN_OP(get_variable_const_name)
+	RUN_OP(set_variable_const_name)
+	RUN_OP(get_time)
+	
+	RUN_OP(trace)
+	traceSinkShutdown(app_context);
+	
+	TraceSinkConfig callback = { TRACE_TO_CALLBACK, TRACE_FLUSH_ON_EXIT };
+	callback.callback = discardTrace;
+	traceSinkInit(app_context, &callback);
+	
+	run(&runner, "op/trace_buffered", bench_trace, app_context, app_context);
+	traceSinkShutdown(app_context);
+	
+	// Dynamic variables, added to the table a size at a time
+	static const u32 map_sizes[] = { 16, 1024, 65536 };
+	
+	VarBench bench = { app_context };
+	bench.names = malloc(65536*NAME_STRIDE);
+	u32 num_names = 0;
+	
+	for (u32 i = 0; i < sizeof(map_sizes)/sizeof(map_sizes[0]); ++i)
+	{
+		for (; num_names < map_sizes[i]; ++num_names)
+		{
+			char* name = bench.names + num_names*NAME_STRIDE;
+			snprintf(name, NAME_STRIDE, "var%u", num_names);
+			
+			PUSH_STR(name, (u32) strlen(name));
+			pushF32(app_context, (float) num_names);
+			actionSetVariable(app_context);
+		}
+		
+		bench.count = num_names;
+		
+		char name[64];
+		
+		snprintf(name, sizeof(name), "var/get_by_name/%u", num_names);
+		run(&runner, name, benchGetByName, &bench, app_context);
+		
+		snprintf(name, sizeof(name), "var/set_by_name/%u", num_names);
+		run(&runner, name, benchSetByName, &bench, app_context);
+		
+		snprintf(name, sizeof(name), "var/get_by_id/%u", num_names);
+		run(&runner, name, bench_get_variable_by_id, app_context, app_context);
+		
+		snprintf(name, sizeof(name), "var/set_by_id/%u", num_names);
+		run(&runner, name, bench_set_variable_by_id, app_context, app_context);
+	}
+	
+	static const u32 chain_lengths[] = { 2, 8, 32 };
+	
+	for (u32 i = 0; i < sizeof(chain_lengths)/sizeof(chain_lengths[0]); ++i)
+	{
+		bench.length = chain_lengths[i];
+		
+		char name[64];
+		
+		snprintf(name, sizeof(name), "string/concat_chain/%u", bench.length);
+		run(&runner, name, benchConcatChain, &bench, app_context);
+		
+		snprintf(name, sizeof(name), "string/materialize/%u", bench.length);
+		run(&runner, name, benchMaterialize, &bench, app_context);
+	}
+	
+	free(bench.names);
+	freeContext(app_context);
+	benchFinish(&runner);
+	
+	return failed;
+}
\ No newline at end of file
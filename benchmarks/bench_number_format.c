@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <number.h>
+
+/**
+ * Number Formatting Benchmark
+ *
+ * Times numberToString against the snprintf("%.15g") path it replaced,
+ * over inputs shaped like what SWFs actually convert, and checks both
+ * produce strings that parse back to the same value.
+ */
+
+#define NUM_VALUES 1000000
+#define NUM_REPS 5
+
+static u64 rng_state = 0x9E3779B97F4A7C15ull;
+
+static u64 nextRandom()
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	
+	return rng_state;
+}
+
+static void fillValues(double* values, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		u64 r = nextRandom();
+		
+		switch (i & 3)
+		{
+			// Counters, scores and coordinates
+			case 0:
+			{
+				values[i] = (double) (s32) (r % 2000001) - 1000000;
+				break;
+			}
+			
+			// Prices and percentages
+			case 1:
+			{
+				values[i] = (double) (r % 100000)/100.0;
+				break;
+			}
+			
+			// F32 results widened to double
+			case 2:
+			{
+				values[i] = (double) ((float) (r % 1000000)/7.0f);
+				break;
+			}
+			
+			// Arbitrary doubles
+			default:
+			{
+				u64 bits = r & 0x7FEFFFFFFFFFFFFFull;
+				memcpy(&values[i], &bits, sizeof(double));
+				break;
+			}
+		}
+	}
+}
+
+static double elapsedNs(clock_t start, clock_t end)
+{
+	return 1e9*(double) (end - start)/CLOCKS_PER_SEC;
+}
+
+int main()
+{
+	double* values = malloc(NUM_VALUES*sizeof(double));
+	char str[NUMBER_STRING_MAX_SIZE];
+	char ref[32];
+	size_t sink = 0;
+	
+	fillValues(values, NUM_VALUES);
+	
+	size_t mismatches = 0;
+	
+	for (size_t i = 0; i < NUM_VALUES; ++i)
+	{
+		numberToString(values[i], str);
+		snprintf(ref, sizeof(ref), "%.15g", values[i]);
+		
+		if (strtod(str, NULL) != strtod(ref, NULL))
+		{
+			if (mismatches < 10)
+			{
+				printf("mismatch: %s vs %s\n", str, ref);
+			}
+			
+			mismatches += 1;
+		}
+	}
+	
+	double best_fast = 0.0;
+	double best_snprintf = 0.0;
+	
+	for (int rep = 0; rep < NUM_REPS; ++rep)
+	{
+		clock_t start = clock();
+		
+		for (size_t i = 0; i < NUM_VALUES; ++i)
+		{
+			sink += numberToString(values[i], str);
+		}
+		
+		clock_t middle = clock();
+		
+		for (size_t i = 0; i < NUM_VALUES; ++i)
+		{
+			sink += snprintf(ref, sizeof(ref), "%.15g", values[i]);
+		}
+		
+		clock_t end = clock();
+		
+		double fast = elapsedNs(start, middle)/NUM_VALUES;
+		double slow = elapsedNs(middle, end)/NUM_VALUES;
+		
+		if (rep == 0 || fast < best_fast)
+		{
+			best_fast = fast;
+		}
+		
+		if (rep == 0 || slow < best_snprintf)
+		{
+			best_snprintf = slow;
+		}
+	}
+	
+	printf("numberToString: %8.1f ns/op\n", best_fast);
+	printf("snprintf %%.15g: %8.1f ns/op\n", best_snprintf);
+	printf("speedup:        %8.2fx\n", best_snprintf/best_fast);
+	printf("mismatches:     %zu (checksum %zu)\n", mismatches, sink);
+	
+	free(values);
+	
+	return mismatches != 0;
+}
\ No newline at end of file
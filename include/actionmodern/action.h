@@ -3,65 +3,87 @@
 #include <swf.h>
 #include <variables.h>
 #include <stackvalue.h>
+#include <opprofile.h>
+
+// Every stack value occupies one fixed 16-byte slot:
+//
+//   +0  u8   type
+//   +1  u24  string id (0 for dynamic strings and non-strings)
+//   +4  u32  string length
+//   +8  u64  value (number bits, char*, or u64* string list)
+//
+// String list segments don't fit in a slot, so they live in a separate
+// arena and the slot only holds a pointer to them (see actionStringAdd).
+#define STACK_SLOT_SIZE 16
 
 #define PUSH(t, v) \
-	OLDSP = SP; \
-	SP -= 4 + 4 + 8 + 8; \
-	SP &= ~7; \
-	STACK[SP] = t; \
-	VAL(u32, &STACK[SP + 4]) = OLDSP; \
-	VAL(u64, &STACK[SP + 16]) = v; \
+	PROFILE_STACK_OP(ACTION_OP_PUSH); \
+	SP -= STACK_SLOT_SIZE; \
+	VAL(u32, &STACK[SP]) = (u32) (t); \
+	VAL(u64, &STACK[SP + 8]) = v; \
 
 // Push string with ID (for constant strings from compiler)
 #define PUSH_STR_ID(v, n, id) \
-	OLDSP = SP; \
-	SP -= 4 + 4 + 8 + 8; \
-	SP &= ~7; \
-	STACK[SP] = ACTION_STACK_VALUE_STRING; \
-	VAL(u32, &STACK[SP + 4]) = OLDSP; \
-	VAL(u32, &STACK[SP + 8]) = n; \
-	VAL(u32, &STACK[SP + 12]) = id; \
-	VAL(char*, &STACK[SP + 16]) = v; \
+	PROFILE_STACK_OP(ACTION_OP_PUSH); \
+	SP -= STACK_SLOT_SIZE; \
+	VAL(u32, &STACK[SP]) = ACTION_STACK_VALUE_STRING | ((u32) (id) << 8); \
+	VAL(u32, &STACK[SP + 4]) = n; \
+	VAL(char*, &STACK[SP + 8]) = v; \
 
 // Push string without ID (for dynamic strings, ID = 0)
 #define PUSH_STR(v, n) PUSH_STR_ID(v, n, 0)
 
-#define PUSH_STR_LIST(n, size) \
-	OLDSP = VAL(u32, &STACK[SP_SECOND_TOP + 4]); \
-	SP -= (u32) (4 + 4 + 8 + size); \
-	SP &= ~7; \
-	STACK[SP] = ACTION_STACK_VALUE_STR_LIST; \
-	VAL(u32, &STACK[SP + 4]) = OLDSP; \
-	VAL(u32, &STACK[SP + 8]) = n; \
+#define PUSH_STR_LIST(n, list) \
+	SP -= STACK_SLOT_SIZE; \
+	VAL(u32, &STACK[SP]) = ACTION_STACK_VALUE_STR_LIST; \
+	VAL(u32, &STACK[SP + 4]) = n; \
+	VAL(u64*, &STACK[SP + 8]) = list; \
 
 #define PUSH_VAR(p) pushVar(app_context, p);
 
 #define POP() \
-	SP = VAL(u32, &STACK[SP + 4]); \
+	PROFILE_STACK_OP(ACTION_OP_POP); \
+	SP += STACK_SLOT_SIZE; \
 
 #define POP_2() \
-	POP(); \
-	POP(); \
+	SP += 2*STACK_SLOT_SIZE; \
 
 #define STACK_TOP_TYPE STACK[SP]
-#define STACK_TOP_N VAL(u32, &STACK[SP + 8])
-#define STACK_TOP_ID VAL(u32, &STACK[SP + 12])
-#define STACK_TOP_VALUE VAL(u64, &STACK[SP + 16])
+#define STACK_TOP_N VAL(u32, &STACK[SP + 4])
+#define STACK_TOP_ID (VAL(u32, &STACK[SP]) >> 8)
+#define STACK_TOP_VALUE VAL(u64, &STACK[SP + 8])
 
-#define SP_SECOND_TOP VAL(u32, &STACK[SP + 4])
+#define SP_SECOND_TOP (SP + STACK_SLOT_SIZE)
 #define STACK_SECOND_TOP_TYPE STACK[SP_SECOND_TOP]
-#define STACK_SECOND_TOP_N VAL(u32, &STACK[SP_SECOND_TOP + 8])
-#define STACK_SECOND_TOP_ID VAL(u32, &STACK[SP_SECOND_TOP + 12])
-#define STACK_SECOND_TOP_VALUE VAL(u64, &STACK[SP_SECOND_TOP + 16])
+#define STACK_SECOND_TOP_N VAL(u32, &STACK[SP_SECOND_TOP + 4])
+#define STACK_SECOND_TOP_ID (VAL(u32, &STACK[SP_SECOND_TOP]) >> 8)
+#define STACK_SECOND_TOP_VALUE VAL(u64, &STACK[SP_SECOND_TOP + 8])
 
 #define VAL(type, x) *((type*) x)
 
-#define INITIAL_STACK_SIZE 8388608  // 8 MB
+#define INITIAL_STACK_SIZE 8388608  // 8 MB reserved, see actionstack.h
 #define INITIAL_SP INITIAL_STACK_SIZE
 
-extern ActionVar* temp_val;
+#define STR_LIST_ARENA_SIZE 1048576  // 1 MB
 
-void initTime();
+// Words before each list in the arena: previous list, owning SP and hash
+#define STR_LIST_HEADER_SIZE 3
+
+// Size of the buffers generated code passes for number to string conversion
+#define CONVERT_STRING_SIZE 17
+
+typedef enum
+{
+	ACTION_NUMERIC_OP_ADD,
+	ACTION_NUMERIC_OP_SUBTRACT,
+	ACTION_NUMERIC_OP_MULTIPLY,
+	ACTION_NUMERIC_OP_DIVIDE,
+	ACTION_NUMERIC_OP_EQUALS,
+	ACTION_NUMERIC_OP_LESS,
+	ACTION_NUMERIC_OP_AND,
+	ACTION_NUMERIC_OP_OR,
+	ACTION_NUMERIC_OP_COUNT
+} ActionNumericOp;
 
 void pushVar(SWFAppContext* app_context, ActionVar* p);
 
@@ -75,6 +97,60 @@ void actionAnd(SWFAppContext* app_context);
 void actionOr(SWFAppContext* app_context);
 void actionNot(SWFAppContext* app_context);
 
+int evaluateCondition(SWFAppContext* app_context);
+
+// Generic fallback for all binary numeric ops, used when operand types
+// aren't known statically
+void actionNumericOp(SWFAppContext* app_context, ActionNumericOp op);
+
+// Type-specialized variants for when the recompiler already knows the
+// operand types. F32 and F64 expect both operands to be of that type,
+// Mixed takes any two numbers, and StrNum takes a string and a number
+// in either order.
+void actionAddF32(SWFAppContext* app_context);
+void actionAddF64(SWFAppContext* app_context);
+void actionAddMixed(SWFAppContext* app_context);
+void actionAddStrNum(SWFAppContext* app_context);
+
+void actionSubtractF32(SWFAppContext* app_context);
+void actionSubtractF64(SWFAppContext* app_context);
+void actionSubtractMixed(SWFAppContext* app_context);
+void actionSubtractStrNum(SWFAppContext* app_context);
+
+void actionMultiplyF32(SWFAppContext* app_context);
+void actionMultiplyF64(SWFAppContext* app_context);
+void actionMultiplyMixed(SWFAppContext* app_context);
+void actionMultiplyStrNum(SWFAppContext* app_context);
+
+void actionDivideF32(SWFAppContext* app_context);
+void actionDivideF64(SWFAppContext* app_context);
+void actionDivideMixed(SWFAppContext* app_context);
+void actionDivideStrNum(SWFAppContext* app_context);
+
+void actionEqualsF32(SWFAppContext* app_context);
+void actionEqualsF64(SWFAppContext* app_context);
+void actionEqualsMixed(SWFAppContext* app_context);
+void actionEqualsStrNum(SWFAppContext* app_context);
+
+void actionLessF32(SWFAppContext* app_context);
+void actionLessF64(SWFAppContext* app_context);
+void actionLessMixed(SWFAppContext* app_context);
+void actionLessStrNum(SWFAppContext* app_context);
+
+// Superinstructions for op sequences the recompiler emits constantly.
+// Build with SWF_OP_PAIR_PROFILE to find candidates for new ones.
+
+// Push F32/F64 constant + Add
+void actionAddConst(SWFAppContext* app_context, float c);
+void actionAddConstF64(SWFAppContext* app_context, double c);
+
+// Push name + Push name + GetVariable + Push 1 + Add + SetVariable
+void actionIncrementVarById(SWFAppContext* app_context, u32 string_id);
+
+// Push name + GetVariable + Push constant + Less, returning the value
+// If would branch on instead of pushing it
+int actionCompareVarConstBranch(SWFAppContext* app_context, u32 string_id, float c);
+
 void actionStringEquals(SWFAppContext* app_context, char* a_str, char* b_str);
 void actionStringLength(SWFAppContext* app_context, char* v_str);
 void actionStringAdd(SWFAppContext* app_context, char* a_str, char* b_str);
@@ -82,5 +158,63 @@ void actionStringAdd(SWFAppContext* app_context, char* a_str, char* b_str);
 void actionGetVariable(SWFAppContext* app_context);
 void actionSetVariable(SWFAppContext* app_context);
 
+// Variable access when the recompiler knows the name's string id, so the
+// name is never pushed to the stack
+void actionGetVariableById(SWFAppContext* app_context, u32 string_id);
+void actionSetVariableById(SWFAppContext* app_context, u32 string_id);
+
 void actionTrace(SWFAppContext* app_context);
-void actionGetTime(SWFAppContext* app_context);
\ No newline at end of file
+void actionGetTime(SWFAppContext* app_context);
+
+// Calls from generated code go through these, see opprofile.h
+#if defined(SWF_OP_CYCLE_PROFILE) && !defined(SWF_RUNTIME_INTERNAL)
+#define pushVar(...) PROFILE_CALL(ACTION_FN_PUSH_VAR, pushVar(__VA_ARGS__))
+#define actionAdd(...) PROFILE_CALL(ACTION_FN_ADD, actionAdd(__VA_ARGS__))
+#define actionSubtract(...) PROFILE_CALL(ACTION_FN_SUBTRACT, actionSubtract(__VA_ARGS__))
+#define actionMultiply(...) PROFILE_CALL(ACTION_FN_MULTIPLY, actionMultiply(__VA_ARGS__))
+#define actionDivide(...) PROFILE_CALL(ACTION_FN_DIVIDE, actionDivide(__VA_ARGS__))
+#define actionEquals(...) PROFILE_CALL(ACTION_FN_EQUALS, actionEquals(__VA_ARGS__))
+#define actionLess(...) PROFILE_CALL(ACTION_FN_LESS, actionLess(__VA_ARGS__))
+#define actionAnd(...) PROFILE_CALL(ACTION_FN_AND, actionAnd(__VA_ARGS__))
+#define actionOr(...) PROFILE_CALL(ACTION_FN_OR, actionOr(__VA_ARGS__))
+#define actionNot(...) PROFILE_CALL(ACTION_FN_NOT, actionNot(__VA_ARGS__))
+#define evaluateCondition(...) PROFILE_CALL_INT(ACTION_FN_EVALUATE_CONDITION, evaluateCondition(__VA_ARGS__))
+#define actionNumericOp(...) PROFILE_CALL(ACTION_FN_NUMERIC_OP, actionNumericOp(__VA_ARGS__))
+#define actionAddF32(...) PROFILE_CALL(ACTION_FN_ADD_F32, actionAddF32(__VA_ARGS__))
+#define actionAddF64(...) PROFILE_CALL(ACTION_FN_ADD_F64, actionAddF64(__VA_ARGS__))
+#define actionAddMixed(...) PROFILE_CALL(ACTION_FN_ADD_MIXED, actionAddMixed(__VA_ARGS__))
+#define actionAddStrNum(...) PROFILE_CALL(ACTION_FN_ADD_STR_NUM, actionAddStrNum(__VA_ARGS__))
+#define actionSubtractF32(...) PROFILE_CALL(ACTION_FN_SUBTRACT_F32, actionSubtractF32(__VA_ARGS__))
+#define actionSubtractF64(...) PROFILE_CALL(ACTION_FN_SUBTRACT_F64, actionSubtractF64(__VA_ARGS__))
+#define actionSubtractMixed(...) PROFILE_CALL(ACTION_FN_SUBTRACT_MIXED, actionSubtractMixed(__VA_ARGS__))
+#define actionSubtractStrNum(...) PROFILE_CALL(ACTION_FN_SUBTRACT_STR_NUM, actionSubtractStrNum(__VA_ARGS__))
+#define actionMultiplyF32(...) PROFILE_CALL(ACTION_FN_MULTIPLY_F32, actionMultiplyF32(__VA_ARGS__))
+#define actionMultiplyF64(...) PROFILE_CALL(ACTION_FN_MULTIPLY_F64, actionMultiplyF64(__VA_ARGS__))
+#define actionMultiplyMixed(...) PROFILE_CALL(ACTION_FN_MULTIPLY_MIXED, actionMultiplyMixed(__VA_ARGS__))
+#define actionMultiplyStrNum(...) PROFILE_CALL(ACTION_FN_MULTIPLY_STR_NUM, actionMultiplyStrNum(__VA_ARGS__))
+#define actionDivideF32(...) PROFILE_CALL(ACTION_FN_DIVIDE_F32, actionDivideF32(__VA_ARGS__))
+#define actionDivideF64(...) PROFILE_CALL(ACTION_FN_DIVIDE_F64, actionDivideF64(__VA_ARGS__))
+#define actionDivideMixed(...) PROFILE_CALL(ACTION_FN_DIVIDE_MIXED, actionDivideMixed(__VA_ARGS__))
+#define actionDivideStrNum(...) PROFILE_CALL(ACTION_FN_DIVIDE_STR_NUM, actionDivideStrNum(__VA_ARGS__))
+#define actionEqualsF32(...) PROFILE_CALL(ACTION_FN_EQUALS_F32, actionEqualsF32(__VA_ARGS__))
+#define actionEqualsF64(...) PROFILE_CALL(ACTION_FN_EQUALS_F64, actionEqualsF64(__VA_ARGS__))
+#define actionEqualsMixed(...) PROFILE_CALL(ACTION_FN_EQUALS_MIXED, actionEqualsMixed(__VA_ARGS__))
+#define actionEqualsStrNum(...) PROFILE_CALL(ACTION_FN_EQUALS_STR_NUM, actionEqualsStrNum(__VA_ARGS__))
+#define actionLessF32(...) PROFILE_CALL(ACTION_FN_LESS_F32, actionLessF32(__VA_ARGS__))
+#define actionLessF64(...) PROFILE_CALL(ACTION_FN_LESS_F64, actionLessF64(__VA_ARGS__))
+#define actionLessMixed(...) PROFILE_CALL(ACTION_FN_LESS_MIXED, actionLessMixed(__VA_ARGS__))
+#define actionLessStrNum(...) PROFILE_CALL(ACTION_FN_LESS_STR_NUM, actionLessStrNum(__VA_ARGS__))
+#define actionAddConst(...) PROFILE_CALL(ACTION_FN_ADD_CONST, actionAddConst(__VA_ARGS__))
+#define actionAddConstF64(...) PROFILE_CALL(ACTION_FN_ADD_CONST_F64, actionAddConstF64(__VA_ARGS__))
+#define actionIncrementVarById(...) PROFILE_CALL(ACTION_FN_INCREMENT_VAR_BY_ID, actionIncrementVarById(__VA_ARGS__))
+#define actionCompareVarConstBranch(...) PROFILE_CALL_INT(ACTION_FN_COMPARE_VAR_CONST_BRANCH, actionCompareVarConstBranch(__VA_ARGS__))
+#define actionStringEquals(...) PROFILE_CALL(ACTION_FN_STRING_EQUALS, actionStringEquals(__VA_ARGS__))
+#define actionStringLength(...) PROFILE_CALL(ACTION_FN_STRING_LENGTH, actionStringLength(__VA_ARGS__))
+#define actionStringAdd(...) PROFILE_CALL(ACTION_FN_STRING_ADD, actionStringAdd(__VA_ARGS__))
+#define actionGetVariable(...) PROFILE_CALL(ACTION_FN_GET_VARIABLE, actionGetVariable(__VA_ARGS__))
+#define actionSetVariable(...) PROFILE_CALL(ACTION_FN_SET_VARIABLE, actionSetVariable(__VA_ARGS__))
+#define actionGetVariableById(...) PROFILE_CALL(ACTION_FN_GET_VARIABLE_BY_ID, actionGetVariableById(__VA_ARGS__))
+#define actionSetVariableById(...) PROFILE_CALL(ACTION_FN_SET_VARIABLE_BY_ID, actionSetVariableById(__VA_ARGS__))
+#define actionTrace(...) PROFILE_CALL(ACTION_FN_TRACE, actionTrace(__VA_ARGS__))
+#define actionGetTime(...) PROFILE_CALL(ACTION_FN_GET_TIME, actionGetTime(__VA_ARGS__))
+#endif
\ No newline at end of file
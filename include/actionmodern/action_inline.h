@@ -0,0 +1,230 @@
+#pragma once
+
+#include <action.h>
+
+/**
+ * Inline Action Fast Paths
+ *
+ * Static inline versions of the hottest action ops, for generated frame
+ * functions that want the compiler to optimize across consecutive ops.
+ *
+ * Each fast path loads STACK and SP into locals once, handles the common
+ * case entirely in registers, and stores SP back once. Anything outside
+ * the fast path (dynamic strings, string lists, shared strings) falls through to
+ * the out-of-line function of the same name in action.c, which stays the
+ * stable ABI and has identical semantics.
+ */
+
+#define INLINE_SLOT_HEAD(stack, sp) VAL(u32, &(stack)[sp])
+#define INLINE_SLOT_N(stack, sp) VAL(u32, &(stack)[(sp) + 4])
+#define INLINE_SLOT_VALUE(stack, sp) VAL(u64, &(stack)[(sp) + 8])
+
+#define INLINE_IS_NUMBER(t) ((t) == ACTION_STACK_VALUE_F32 || (t) == ACTION_STACK_VALUE_F64)
+
+static inline double inlineSlotToF64(char* stack, u32 sp)
+{
+	u64 value = INLINE_SLOT_VALUE(stack, sp);
+	
+	return stack[sp] == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &value) : VAL(double, &value);
+}
+
+static inline void inlineWriteF32(char* stack, u32 sp, float v)
+{
+	INLINE_SLOT_HEAD(stack, sp) = ACTION_STACK_VALUE_F32;
+	INLINE_SLOT_VALUE(stack, sp) = VAL(u32, &v);
+}
+
+static inline void inlineWriteF64(char* stack, u32 sp, double v)
+{
+	INLINE_SLOT_HEAD(stack, sp) = ACTION_STACK_VALUE_F64;
+	INLINE_SLOT_VALUE(stack, sp) = VAL(u64, &v);
+}
+
+static inline void actionPushF32Inline(SWFAppContext* app_context, float v)
+{
+	PROFILE_OP(ACTION_OP_PUSH);
+	u32 sp = SP - STACK_SLOT_SIZE;
+	inlineWriteF32(STACK, sp, v);
+	SP = sp;
+}
+
+static inline void actionPushF64Inline(SWFAppContext* app_context, double v)
+{
+	PROFILE_OP(ACTION_OP_PUSH);
+	u32 sp = SP - STACK_SLOT_SIZE;
+	inlineWriteF64(STACK, sp, v);
+	SP = sp;
+}
+
+static inline void actionPushStrIdInline(SWFAppContext* app_context, char* v, u32 n, u32 id)
+{
+	PROFILE_OP(ACTION_OP_PUSH);
+	
+	char* stack = STACK;
+	u32 sp = SP - STACK_SLOT_SIZE;
+	
+	INLINE_SLOT_HEAD(stack, sp) = ACTION_STACK_VALUE_STRING | (id << 8);
+	INLINE_SLOT_N(stack, sp) = n;
+	VAL(char*, &stack[sp + 8]) = v;
+	
+	SP = sp;
+}
+
+static inline void actionPopInline(SWFAppContext* app_context)
+{
+	PROFILE_OP(ACTION_OP_POP);
+	SP += STACK_SLOT_SIZE;
+}
+
+// Binary ops: both operands are read in place, the result overwrites
+// the second-to-top slot, and F32 x F32 stays F32 like actionNumericOp.
+#define DEFINE_INLINE_ARITHMETIC(name, op, op_id) \
+	static inline void action##name##Inline(SWFAppContext* app_context) \
+	{ \
+		char* stack = STACK; \
+		u32 sp = SP; \
+		u8 a_type = stack[sp]; \
+		u8 b_type = stack[sp + STACK_SLOT_SIZE]; \
+		\
+		if (a_type == ACTION_STACK_VALUE_F32 && b_type == ACTION_STACK_VALUE_F32) \
+		{ \
+			float a = VAL(float, &stack[sp + 8]); \
+			float b = VAL(float, &stack[sp + STACK_SLOT_SIZE + 8]); \
+			sp += STACK_SLOT_SIZE; \
+			inlineWriteF32(stack, sp, b op a); \
+			SP = sp; \
+			PROFILE_OP(op_id); \
+			return; \
+		} \
+		\
+		if (INLINE_IS_NUMBER(a_type) && INLINE_IS_NUMBER(b_type)) \
+		{ \
+			double a = inlineSlotToF64(stack, sp); \
+			double b = inlineSlotToF64(stack, sp + STACK_SLOT_SIZE); \
+			sp += STACK_SLOT_SIZE; \
+			inlineWriteF64(stack, sp, b op a); \
+			SP = sp; \
+			PROFILE_OP(op_id); \
+			return; \
+		} \
+		\
+		action##name(app_context); \
+	}
+
+#define DEFINE_INLINE_COMPARISON(name, op, op_id) \
+	static inline void action##name##Inline(SWFAppContext* app_context) \
+	{ \
+		char* stack = STACK; \
+		u32 sp = SP; \
+		u8 a_type = stack[sp]; \
+		u8 b_type = stack[sp + STACK_SLOT_SIZE]; \
+		\
+		if (INLINE_IS_NUMBER(a_type) && INLINE_IS_NUMBER(b_type)) \
+		{ \
+			int c; \
+			\
+			if (a_type == ACTION_STACK_VALUE_F32 && b_type == ACTION_STACK_VALUE_F32) \
+			{ \
+				c = VAL(float, &stack[sp + STACK_SLOT_SIZE + 8]) op VAL(float, &stack[sp + 8]); \
+			} \
+			\
+			else \
+			{ \
+				c = inlineSlotToF64(stack, sp + STACK_SLOT_SIZE) op inlineSlotToF64(stack, sp); \
+			} \
+			\
+			sp += STACK_SLOT_SIZE; \
+			inlineWriteF32(stack, sp, c ? 1.0f : 0.0f); \
+			SP = sp; \
+			PROFILE_OP(op_id); \
+			return; \
+		} \
+		\
+		action##name(app_context); \
+	}
+
+DEFINE_INLINE_ARITHMETIC(Add, +, ACTION_OP_ADD)
+DEFINE_INLINE_ARITHMETIC(Subtract, -, ACTION_OP_SUBTRACT)
+DEFINE_INLINE_ARITHMETIC(Multiply, *, ACTION_OP_MULTIPLY)
+
+DEFINE_INLINE_COMPARISON(Equals, ==, ACTION_OP_EQUALS)
+DEFINE_INLINE_COMPARISON(Less, <, ACTION_OP_LESS)
+
+static inline int evaluateConditionInline(SWFAppContext* app_context)
+{
+	char* stack = STACK;
+	u32 sp = SP;
+	u8 type = stack[sp];
+	
+	if (INLINE_IS_NUMBER(type))
+	{
+		double value = inlineSlotToF64(stack, sp);
+		int result = value != 0.0 && value == value;
+		
+		SP = sp + STACK_SLOT_SIZE;
+		PROFILE_OP(ACTION_OP_IF);
+		
+		return result;
+	}
+	
+	return evaluateCondition(app_context);
+}
+
+static inline void actionGetVariableByIdInline(SWFAppContext* app_context, u32 string_id)
+{
+	PROFILE_OP(ACTION_OP_GET_VARIABLE);
+	PROFILE_LOOKUP_COUNT(ACTION_LOOKUP_VAR_ARRAY);
+	
+	ActionVar* var = &app_context->var_array[string_id];
+	char* stack = STACK;
+	u32 sp = SP - STACK_SLOT_SIZE;
+	
+	if (var->type == ACTION_STACK_VALUE_STRING)
+	{
+		INLINE_SLOT_HEAD(stack, sp) = ACTION_STACK_VALUE_STRING | (var->string_id << 8);
+		INLINE_SLOT_N(stack, sp) = var->str_size;
+		VAL(char*, &stack[sp + 8]) = (char*) var->value;
+		
+		if (var->is_inline)
+		{
+			VAL(char*, &stack[sp + 8]) = var->inline_str;
+			var->inline_borrowed = true;
+		}
+	}
+	
+	else
+	{
+		INLINE_SLOT_HEAD(stack, sp) = var->type;
+		INLINE_SLOT_VALUE(stack, sp) = var->value;
+	}
+	
+	SP = sp;
+}
+
+static inline void actionSetVariableByIdInline(SWFAppContext* app_context, u32 string_id)
+{
+	ActionVar* var = &app_context->var_array[string_id];
+	char* stack = STACK;
+	u32 sp = SP;
+	u8 type = stack[sp];
+	
+	// String lists need materializing, dynamic strings need sharing or
+	// copying, and the variable's own shared or inline chars need releasing
+	if (type == ACTION_STACK_VALUE_STR_LIST ||
+	    (type == ACTION_STACK_VALUE_STRING && (INLINE_SLOT_HEAD(stack, sp) >> 8) == 0) ||
+	    (var->type == ACTION_STACK_VALUE_STRING && (var->owns_memory || var->is_inline)))
+	{
+		actionSetVariableById(app_context, string_id);
+		return;
+	}
+	
+	PROFILE_OP(ACTION_OP_SET_VARIABLE);
+	PROFILE_LOOKUP_COUNT(ACTION_LOOKUP_VAR_ARRAY);
+	
+	var->type = type;
+	var->str_size = INLINE_SLOT_N(stack, sp);
+	var->string_id = type == ACTION_STACK_VALUE_STRING ? INLINE_SLOT_HEAD(stack, sp) >> 8 : 0;
+	var->value = INLINE_SLOT_VALUE(stack, sp);
+	
+	SP = sp + STACK_SLOT_SIZE;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <common.h>
+#include <swf.h>
+
+/**
+ * Action Stack Memory
+ *
+ * The action stack is its own INITIAL_STACK_SIZE reservation of address
+ * space rather than a heap block. Pages are only backed once a push
+ * touches them, so an instance whose stack stays a few KB deep only pays
+ * for those. The lowest ACTION_STACK_GUARD_SIZE bytes are never
+ * accessible, and a push that reaches them is reported as a stack
+ * overflow with the frame and depth instead of writing past the stack.
+ */
+
+#define ACTION_STACK_GUARD_SIZE 65536
+
+/**
+ * Reserve the stack, point STACK and SP at it and bind it to this thread
+ *
+ * @return Nonzero on success, 0 if the stack couldn't be reserved
+ */
+int initActionStack(SWFAppContext* app_context);
+
+void freeActionStack(SWFAppContext* app_context);
+
+/**
+ * Make this thread's overflow reports name this instance
+ *
+ * Call before running an instance on a thread other than the one that
+ * initialized it.
+ */
+void bindActionStack(SWFAppContext* app_context);
\ No newline at end of file
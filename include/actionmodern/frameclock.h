@@ -0,0 +1,42 @@
+#pragma once
+
+#include <common.h>
+#include <swf.h>
+
+/**
+ * Frame Clock
+ *
+ * Samples the monotonic clock once at the start of every frame, and
+ * getTimer reads that sample instead of asking the OS each call. A script
+ * that keeps calling getTimer within one frame, like a busy-wait loop,
+ * gets a fresh sample after CLOCK_RESAMPLE_READS calls so it still sees
+ * time pass.
+ *
+ * With virtual_time set in the app context, time advances by
+ * virtual_frame_us per frame instead, and by a millisecond per read past
+ * CLOCK_RESAMPLE_READS, which makes every run of a movie see exactly the
+ * same timer values.
+ */
+
+/**
+ * Start the clock at zero
+ *
+ * @param app_context Main app context, with virtual_time and
+ *        virtual_frame_us set up beforehand if wanted
+ */
+void initFrameClock(SWFAppContext* app_context);
+
+/**
+ * Take the sample served for the frame about to run
+ */
+void frameClockBeginFrame(SWFAppContext* app_context);
+
+/**
+ * Milliseconds since the clock started, as getTimer returns them
+ */
+u32 frameClockGetTimer(SWFAppContext* app_context);
+
+/**
+ * Nanoseconds since the clock started, read fresh unless in virtual time
+ */
+u64 frameClockNowNs(SWFAppContext* app_context);
\ No newline at end of file
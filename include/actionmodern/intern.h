@@ -0,0 +1,144 @@
+#pragma once
+
+#include <common.h>
+#include <swf.h>
+#include <variables.h>
+
+/**
+ * Runtime String Interning
+ *
+ * Gives dynamically built strings, like variable names made with
+ * "item" + i, integer ids following the recompiler's max_string_id, so
+ * they can use the same id-indexed paths as constant strings. Interned
+ * strings are copied into owned, length-prefixed storage, and the same
+ * string gets the same id for as long as it stays in the table.
+ *
+ * Each interned string also holds the ActionVar of the variable with
+ * that name inline, so a dynamic variable lookup is one probe of the
+ * table. The index is open addressing with SIMD-probed control bytes,
+ * and growing it moves entries over a few slots per operation rather
+ * than rehashing everything at once. Removing a string empties its slot
+ * without a tombstone, and its entry, id and storage go on a free list
+ * for the next new string, so deleting and recreating variables every
+ * frame doesn't grow the table.
+ */
+
+typedef struct InternTable InternTable;
+
+// Marks a cached hash as computed, since 0 is a valid hash
+#define STRING_HASH_KNOWN (1ull << 32)
+
+void initInternTable(SWFAppContext* app_context);
+void freeInternTable(SWFAppContext* app_context);
+
+/**
+ * Hash a string given as segments, as laid out in string lists
+ *
+ * The hash is polynomial, so the hash of a concatenation follows from
+ * the hashes and lengths of its parts.
+ *
+ * @param segments Pointer and length pairs
+ * @param num_segments Number of segments
+ * @return 32-bit hash of the concatenated segments
+ */
+u32 hashStringSegments(const u64* segments, u64 num_segments);
+
+/**
+ * Get the hash of a concatenation from the hashes of its parts
+ *
+ * @param left_hash Hash of the left part
+ * @param right_hash Hash of the right part
+ * @param right_length Length of the right part
+ * @return Hash of left + right
+ */
+u32 combineStringHashes(u32 left_hash, u32 right_hash, u32 right_length);
+
+/**
+ * Get the hash of a constant or interned string, computed at most once
+ *
+ * @param app_context Main app context
+ * @param str The string, only read the first time a constant is hashed
+ * @param length Length of the string
+ * @param string_id Nonzero id of the string
+ * @return Hash of the string
+ */
+u32 getStringIdHash(SWFAppContext* app_context, const char* str, u32 length, u32 string_id);
+
+/**
+ * Get the id of a string given as segments, interning it if it's new
+ *
+ * @param app_context Main app context
+ * @param segments Pointer and length pairs
+ * @param num_segments Number of segments
+ * @param length Total length of the segments
+ * @param hash Hash of the segments, as from hashStringSegments
+ * @return Id of the string, always greater than max_string_id
+ */
+u32 internStringSegments(SWFAppContext* app_context, const u64* segments, u64 num_segments, u32 length, u32 hash);
+
+u32 internString(SWFAppContext* app_context, const char* str, u32 length);
+
+/**
+ * Get the variable stored with an interned string
+ *
+ * The pointer stays valid until the table is freed.
+ *
+ * @param app_context Main app context
+ * @param string_id Id returned by internStringSegments
+ * @return The variable
+ */
+ActionVar* getInternedVariable(SWFAppContext* app_context, u32 string_id);
+
+/**
+ * Remove a string from the table, freeing its id for reuse
+ *
+ * The variable has to be emptied before anything else is interned, since
+ * the next new string takes over the entry, and the old id with it.
+ *
+ * @return The variable stored with the string, or NULL if it wasn't interned
+ */
+ActionVar* removeInternedString(SWFAppContext* app_context, const u64* segments, u64 num_segments, u32 length, u32 hash);
+
+/**
+ * Number of ids handed out so far, free ones included
+ *
+ * They run on from max_string_id + 1.
+ */
+u32 internedStringCount(SWFAppContext* app_context);
+
+/**
+ * Get the chars of an interned string by id
+ *
+ * @param app_context Main app context
+ * @param string_id Id returned by internStringSegments
+ * @param length Set to the length of the string
+ * @return The null-terminated chars, or NULL if the id is free
+ */
+const char* getInternedString(SWFAppContext* app_context, u32 string_id, u32* length);
+
+/**
+ * Walk the free ids in the order they'll be reused
+ *
+ * @param string_id 0 to start, otherwise the id returned last
+ * @return The next free id, or 0 at the end
+ */
+u32 nextFreeInternedId(SWFAppContext* app_context, u32 string_id);
+
+/**
+ * Hand out the next new id without a string, for rebuilding a table id
+ * by id. It stays unused until freeInternedId puts it on the free list.
+ */
+u32 reserveInternedId(SWFAppContext* app_context);
+
+/**
+ * Put a reserved id at the front of the free list
+ */
+void freeInternedId(SWFAppContext* app_context, u32 string_id);
+
+/**
+ * Find the interned variable a pointer points into, like a stack slot
+ * borrowing its inline chars
+ *
+ * @return Id of the variable's string, or 0 if ptr isn't in one
+ */
+u32 findInternedVariable(SWFAppContext* app_context, const char* ptr);
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <common.h>
+#include <swf.h>
+
+/**
+ * Number Conversion
+ *
+ * Locale-free conversions between numbers and strings, following the
+ * rules Flash uses when coercing a Number to a String.
+ */
+
+// Longest string numberToString can produce, including the terminator
+#define NUMBER_STRING_MAX_SIZE 24
+
+/**
+ * Format a number the way Flash does
+ *
+ * Uses at most 15 significant digits with trailing zeros removed, which
+ * is the shortest round-trip representation whenever one that short
+ * exists. Exponential notation is used for decimal exponents below -5
+ * or above 14, as in 1e-7 and 1.5e+20.
+ *
+ * @param value Number to format, F32 values are widened to double first
+ * @param buffer Output, must hold NUMBER_STRING_MAX_SIZE bytes
+ * @return Length of the formatted string, not counting the terminator
+ */
+u32 numberToString(double value, char* buffer);
+
+/**
+ * Convert a string to a number the way Flash does
+ *
+ * Accepts optional leading whitespace, an optional sign, and then a
+ * decimal number with optional fraction and exponent, 0x followed by hex
+ * digits, or Infinity. As in SWF 4 and 5, which the rest of the runtime
+ * follows, whatever comes after the number is ignored, and a string
+ * that doesn't start with one gives 0. SWF 7 players give NaN for both,
+ * which needs the movie's version to tell apart. The C locale is never
+ * consulted.
+ *
+ * @param str Null-terminated string to convert
+ * @return The converted number
+ */
+double stringToNumber(const char* str);
+
+/**
+ * Allocate the parsed number cache for constant strings
+ *
+ * @param app_context Main app context
+ * @param max_string_id Highest string id the recompiler assigned
+ */
+void initNumberCache(SWFAppContext* app_context, size_t max_string_id);
+
+void freeNumberCache(SWFAppContext* app_context);
+
+/**
+ * Convert a string to a number, parsing each constant string only once
+ *
+ * Strings with an id from the recompiler never change, so their result is
+ * cached by id. Dynamic strings (id 0) are parsed every time, and only up
+ * to length, since a borrowed string's buffer may continue past it.
+ *
+ * @param app_context Main app context
+ * @param str String to convert, with at least length + 1 readable bytes
+ * @param length Length of the string
+ * @param string_id Id of the string, or 0 if it has none
+ * @return The converted number
+ */
+double stringIdToNumber(SWFAppContext* app_context, const char* str, u32 length, u32 string_id);
\ No newline at end of file
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <common.h>
+#include <swf.h>
+
+/**
+ * Action Op Pair Profiler
+ *
+ * Counts how often each runtime op directly follows another, so new
+ * superinstructions can be justified with data. Only compiled in when
+ * SWF_OP_PAIR_PROFILE is defined, otherwise PROFILE_OP expands to nothing.
+ *
+ * Action Cycle Profiler
+ *
+ * Counts calls and accumulates cycles for every runtime function called
+ * from generated code, and for each way a variable is looked up. Only
+ * compiled in when SWF_OP_CYCLE_PROFILE is defined, in which case
+ * action.h wraps each call made by generated code in PROFILE_CALL.
+ * Inline fast paths are only counted when they fall back to the runtime.
+ *
+ * Cycles are TSC cycles on x86, timer ticks on ARM64 and nanoseconds
+ * anywhere else.
+ */
+
+typedef enum
+{
+	ACTION_OP_NONE,
+	ACTION_OP_PUSH,
+	ACTION_OP_POP,
+	ACTION_OP_ADD,
+	ACTION_OP_SUBTRACT,
+	ACTION_OP_MULTIPLY,
+	ACTION_OP_DIVIDE,
+	ACTION_OP_EQUALS,
+	ACTION_OP_LESS,
+	ACTION_OP_AND,
+	ACTION_OP_OR,
+	ACTION_OP_NOT,
+	ACTION_OP_IF,
+	ACTION_OP_STRING_EQUALS,
+	ACTION_OP_STRING_LENGTH,
+	ACTION_OP_STRING_ADD,
+	ACTION_OP_GET_VARIABLE,
+	ACTION_OP_SET_VARIABLE,
+	ACTION_OP_TRACE,
+	ACTION_OP_GET_TIME,
+	ACTION_OP_ADD_CONST,
+	ACTION_OP_INCREMENT_VAR,
+	ACTION_OP_COMPARE_VAR_CONST_BRANCH,
+	ACTION_OP_ID_COUNT
+} ActionOpId;
+
+// Every runtime function generated code calls, as id and function name
+#define ACTION_PROFILED_FUNCTIONS(X) \
+	X(ACTION_FN_PUSH_VAR, pushVar) \
+	X(ACTION_FN_ADD, actionAdd) \
+	X(ACTION_FN_SUBTRACT, actionSubtract) \
+	X(ACTION_FN_MULTIPLY, actionMultiply) \
+	X(ACTION_FN_DIVIDE, actionDivide) \
+	X(ACTION_FN_EQUALS, actionEquals) \
+	X(ACTION_FN_LESS, actionLess) \
+	X(ACTION_FN_AND, actionAnd) \
+	X(ACTION_FN_OR, actionOr) \
+	X(ACTION_FN_NOT, actionNot) \
+	X(ACTION_FN_EVALUATE_CONDITION, evaluateCondition) \
+	X(ACTION_FN_NUMERIC_OP, actionNumericOp) \
+	X(ACTION_FN_ADD_F32, actionAddF32) \
+	X(ACTION_FN_ADD_F64, actionAddF64) \
+	X(ACTION_FN_ADD_MIXED, actionAddMixed) \
+	X(ACTION_FN_ADD_STR_NUM, actionAddStrNum) \
+	X(ACTION_FN_SUBTRACT_F32, actionSubtractF32) \
+	X(ACTION_FN_SUBTRACT_F64, actionSubtractF64) \
+	X(ACTION_FN_SUBTRACT_MIXED, actionSubtractMixed) \
+	X(ACTION_FN_SUBTRACT_STR_NUM, actionSubtractStrNum) \
+	X(ACTION_FN_MULTIPLY_F32, actionMultiplyF32) \
+	X(ACTION_FN_MULTIPLY_F64, actionMultiplyF64) \
+	X(ACTION_FN_MULTIPLY_MIXED, actionMultiplyMixed) \
+	X(ACTION_FN_MULTIPLY_STR_NUM, actionMultiplyStrNum) \
+	X(ACTION_FN_DIVIDE_F32, actionDivideF32) \
+	X(ACTION_FN_DIVIDE_F64, actionDivideF64) \
+	X(ACTION_FN_DIVIDE_MIXED, actionDivideMixed) \
+	X(ACTION_FN_DIVIDE_STR_NUM, actionDivideStrNum) \
+	X(ACTION_FN_EQUALS_F32, actionEqualsF32) \
+	X(ACTION_FN_EQUALS_F64, actionEqualsF64) \
+	X(ACTION_FN_EQUALS_MIXED, actionEqualsMixed) \
+	X(ACTION_FN_EQUALS_STR_NUM, actionEqualsStrNum) \
+	X(ACTION_FN_LESS_F32, actionLessF32) \
+	X(ACTION_FN_LESS_F64, actionLessF64) \
+	X(ACTION_FN_LESS_MIXED, actionLessMixed) \
+	X(ACTION_FN_LESS_STR_NUM, actionLessStrNum) \
+	X(ACTION_FN_ADD_CONST, actionAddConst) \
+	X(ACTION_FN_ADD_CONST_F64, actionAddConstF64) \
+	X(ACTION_FN_INCREMENT_VAR_BY_ID, actionIncrementVarById) \
+	X(ACTION_FN_COMPARE_VAR_CONST_BRANCH, actionCompareVarConstBranch) \
+	X(ACTION_FN_STRING_EQUALS, actionStringEquals) \
+	X(ACTION_FN_STRING_LENGTH, actionStringLength) \
+	X(ACTION_FN_STRING_ADD, actionStringAdd) \
+	X(ACTION_FN_GET_VARIABLE, actionGetVariable) \
+	X(ACTION_FN_SET_VARIABLE, actionSetVariable) \
+	X(ACTION_FN_GET_VARIABLE_BY_ID, actionGetVariableById) \
+	X(ACTION_FN_SET_VARIABLE_BY_ID, actionSetVariableById) \
+	X(ACTION_FN_TRACE, actionTrace) \
+	X(ACTION_FN_GET_TIME, actionGetTime)
+
+typedef enum
+{
+#define ACTION_FN_ENUM(id, name) id,
+	ACTION_PROFILED_FUNCTIONS(ACTION_FN_ENUM)
+#undef ACTION_FN_ENUM
+	
+	// Variable lookup paths. Indexing var_array is only counted, since
+	// timing it would mostly time the cycle counter.
+	ACTION_LOOKUP_VAR_ARRAY,
+	ACTION_LOOKUP_INTERNED_ID,
+	ACTION_LOOKUP_BY_NAME,
+	
+	ACTION_FN_COUNT
+} ActionFnId;
+
+typedef struct ActionOpProfile
+{
+	ActionOpId last_op;
+	u64 op_counts[ACTION_OP_ID_COUNT];
+	u64 pair_counts[ACTION_OP_ID_COUNT][ACTION_OP_ID_COUNT];
+} ActionOpProfile;
+
+typedef struct ActionCycleProfile
+{
+	u64 call_start;
+	u64 calls[ACTION_FN_COUNT];
+	u64 cycles[ACTION_FN_COUNT];
+} ActionCycleProfile;
+
+#ifdef SWF_OP_PAIR_PROFILE
+#define PROFILE_OP(op) opProfileRecord(app_context, op);
+#define PROFILE_FRAME_BOUNDARY() app_context->op_profile->last_op = ACTION_OP_NONE;
+#else
+#define PROFILE_OP(op)
+#define PROFILE_FRAME_BOUNDARY()
+#endif
+
+// Runtime sources push and pop results internally, which would show up as
+// bogus pairs, so only generated code counts the stack macros
+#if defined(SWF_OP_PAIR_PROFILE) && !defined(SWF_RUNTIME_INTERNAL)
+#define PROFILE_STACK_OP(op) PROFILE_OP(op)
+#else
+#define PROFILE_STACK_OP(op)
+#endif
+
+#ifdef SWF_OP_CYCLE_PROFILE
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define readCycleCounter() __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define readCycleCounter() __rdtsc()
+#elif defined(__aarch64__)
+static inline u64 readCycleCounter()
+{
+	u64 ticks;
+	__asm__ volatile("mrs %0, cntvct_el0" : "=r" (ticks));
+	
+	return ticks;
+}
+#else
+#include <utils.h>
+#define readCycleCounter() get_elapsed_ns()
+#endif
+
+static inline void opCycleBegin(SWFAppContext* app_context)
+{
+	app_context->cycle_profile->call_start = readCycleCounter();
+}
+
+static inline void opCycleRecord(SWFAppContext* app_context, ActionFnId id, u64 start)
+{
+	ActionCycleProfile* profile = app_context->cycle_profile;
+	
+	profile->calls[id] += 1;
+	profile->cycles[id] += readCycleCounter() - start;
+}
+
+static inline void opCycleEnd(SWFAppContext* app_context, ActionFnId id)
+{
+	opCycleRecord(app_context, id, app_context->cycle_profile->call_start);
+}
+
+// The call is evaluated as an argument, so it's timed before this runs
+static inline int opCycleEndInt(SWFAppContext* app_context, ActionFnId id, int result)
+{
+	opCycleEnd(app_context, id);
+	
+	return result;
+}
+
+#define PROFILE_CALL(id, call) (opCycleBegin(app_context), call, opCycleEnd(app_context, id))
+#define PROFILE_CALL_INT(id, call) opCycleEndInt(app_context, id, (opCycleBegin(app_context), call))
+#define PROFILE_LOOKUP_COUNT(id) app_context->cycle_profile->calls[id] += 1;
+#define PROFILE_LOOKUP_START(start) u64 start = readCycleCounter();
+#define PROFILE_LOOKUP_END(id, start) opCycleRecord(app_context, id, start);
+#else
+#define PROFILE_LOOKUP_COUNT(id)
+#define PROFILE_LOOKUP_START(start)
+#define PROFILE_LOOKUP_END(id, start)
+#endif
+
+void opProfileInit(SWFAppContext* app_context);
+void opProfileRecord(SWFAppContext* app_context, ActionOpId op);
+
+/**
+ * Print op counts and the most frequent op pairs, then free the profile
+ *
+ * @param app_context Main app context
+ * @param out Stream to print the report to
+ * @param max_pairs Number of pairs to print, most frequent first
+ */
+void opProfileShutdown(SWFAppContext* app_context, FILE* out, size_t max_pairs);
+
+void opCycleProfileInit(SWFAppContext* app_context);
+
+/**
+ * Print calls and cycles per function, most cycles first, then free the
+ * profile
+ */
+void opCycleProfileShutdown(SWFAppContext* app_context, FILE* out);
\ No newline at end of file
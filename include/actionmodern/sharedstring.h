@@ -0,0 +1,88 @@
+#pragma once
+
+#include <common.h>
+#include <swf.h>
+
+/**
+ * Shared Strings
+ *
+ * Strings built at runtime are immutable, reference counted heap buffers
+ * shared by every variable holding them, so assigning one variable to
+ * another only bumps a count. The header sits just before the chars,
+ * which are always null-terminated, so a shared string is passed around
+ * as a plain char*.
+ *
+ * Only variables count as references. Stack slots and string list
+ * segments borrow the chars without counting, which keeps pushes and
+ * pops free. A string whose count drops to zero is therefore only queued,
+ * and freed once a scan of the live stack finds no slot still using it.
+ */
+
+typedef struct
+{
+	u32 refcount;
+	u32 capacity;
+} SharedStringHeader;
+
+// The top bits of refcount are flags used while a string is queued
+#define SHARED_STRING_COUNT_MASK 0x3FFFFFFFu
+#define SHARED_STRING_QUEUED 0x40000000u
+#define SHARED_STRING_ON_STACK 0x80000000u
+
+#define SHARED_STRING_HEADER(str) ((SharedStringHeader*) (str) - 1)
+
+void initSharedStrings(SWFAppContext* app_context);
+
+/**
+ * Free every queued string, whether or not the stack still uses it
+ *
+ * Called at shutdown, once every variable has released its strings.
+ */
+void freeSharedStrings(SWFAppContext* app_context);
+
+/**
+ * Allocate a shared string with a reference count of 1
+ *
+ * @param app_context Main app context
+ * @param capacity Bytes available for chars, including the terminator
+ * @return The chars
+ */
+char* allocSharedString(SWFAppContext* app_context, u32 capacity);
+
+/**
+ * Drop a reference, queueing the string to be freed if it was the last
+ */
+void releaseSharedString(SWFAppContext* app_context, char* str);
+
+/**
+ * Free queued strings that nothing references any more
+ */
+void reclaimSharedStrings(SWFAppContext* app_context);
+
+/**
+ * Check whether a string slot's chars are a shared string
+ *
+ * Every string the runtime places in the heap for a stack slot is a
+ * shared string. Constants, conversion buffers and inline strings in
+ * variables never live in the heap.
+ */
+static inline int isSharedString(SWFAppContext* app_context, const char* str)
+{
+	return str >= app_context->heap && str < app_context->heap + app_context->heap_size;
+}
+
+static inline void retainSharedString(char* str)
+{
+	SHARED_STRING_HEADER(str)->refcount += 1;
+}
+
+static inline u32 sharedStringCapacity(char* str)
+{
+	return SHARED_STRING_HEADER(str)->capacity;
+}
+
+// A string held by a single variable may be appended to in place
+static inline int isUniqueSharedString(char* str)
+{
+	return (SHARED_STRING_HEADER(str)->refcount & SHARED_STRING_COUNT_MASK) == 1;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <common.h>
+
+/**
+ * String Comparison
+ *
+ * Compares strings given as segment lists, the (pointer, length) pairs
+ * string lists store after their count. A plain string is a list of one
+ * segment. Bytes are compared with SIMD blocks (AVX2, SSE2 or NEON,
+ * whichever the target has) that run across segment boundaries, and
+ * never depend on null terminators.
+ */
+
+/**
+ * Compare two segmented strings
+ *
+ * @param a_segments Pointer and length pairs of the first string
+ * @param num_a Number of segments in the first string
+ * @param b_segments Pointer and length pairs of the second string
+ * @param num_b Number of segments in the second string
+ * @return Negative, zero or positive as with strcmp, bytes compared unsigned
+ */
+int compareStringSegments(const u64* a_segments, u64 num_a, const u64* b_segments, u64 num_b);
+
+/**
+ * Check two segmented strings for equality, rejecting on length first
+ *
+ * @param a_size Total length of the first string
+ * @param b_size Total length of the second string
+ * @return Nonzero if the strings are equal
+ */
+int equalStringSegments(const u64* a_segments, u64 num_a, u32 a_size, const u64* b_segments, u64 num_b, u32 b_size);
+
+/**
+ * Byte-at-a-time version of compareStringSegments, which
+ * tests/test_strcompare.c checks the SIMD one against
+ */
+int compareStringSegmentsScalar(const u64* a_segments, u64 num_a, const u64* b_segments, u64 num_b);
\ No newline at end of file
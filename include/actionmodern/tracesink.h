@@ -0,0 +1,109 @@
+#pragma once
+
+#include <common.h>
+#include <swf.h>
+
+/**
+ * Trace Sink
+ *
+ * Collects trace output in a lock-free ring buffer that a background
+ * writer thread drains, so a trace never blocks the frame on a write
+ * syscall or a slow pipe. Only the VM thread writes into the ring and
+ * only the writer thread reads from it; they meet through two atomic
+ * positions, and the writer sleeps until a flush is requested.
+ *
+ * If the writer thread can't be started, traces are written out as they
+ * come instead. When no sink has been set up, traces go straight to
+ * stdout as before.
+ */
+
+typedef enum
+{
+	TRACE_TO_STDOUT,
+	TRACE_TO_FILE,
+	TRACE_TO_CALLBACK,
+	
+	// Counts traces without formatting or writing anything
+	TRACE_COUNT_ONLY
+} TraceDestination;
+
+typedef enum
+{
+	// Hand buffered output to the writer at the end of every frame
+	TRACE_FLUSH_PER_FRAME,
+	
+	// Hand it over once flush_size bytes are pending
+	TRACE_FLUSH_BY_SIZE,
+	
+	// Only when the ring fills up, and at shutdown
+	TRACE_FLUSH_ON_EXIT
+} TraceFlushPolicy;
+
+/**
+ * Receives trace output on the writer thread, or on the VM thread if the
+ * writer couldn't be started
+ *
+ * @param data Output bytes, lines end with '\n' but aren't null-terminated
+ * @param size Number of bytes
+ * @param user User pointer from the config
+ */
+typedef void (*TraceCallback)(const char* data, size_t size, void* user);
+
+struct TraceSinkConfig
+{
+	TraceDestination destination;
+	TraceFlushPolicy flush_policy;
+	
+	// Pending bytes that trigger a flush with TRACE_FLUSH_BY_SIZE
+	u32 flush_size;
+	
+	// Ring size in bytes, rounded up to a power of two
+	u32 buffer_size;
+	
+	// File to append to with TRACE_TO_FILE
+	const char* path;
+	
+	TraceCallback callback;
+	void* user;
+};
+
+/**
+ * Start the sink and its writer thread
+ *
+ * @param app_context Main app context
+ * @param config Sink settings, or NULL for stdout flushed every frame
+ */
+void traceSinkInit(SWFAppContext* app_context, const TraceSinkConfig* config);
+
+/**
+ * Write out everything buffered, stop the writer thread and free the sink
+ */
+void traceSinkShutdown(SWFAppContext* app_context);
+
+void traceSinkWrite(SWFAppContext* app_context, const char* data, size_t size);
+
+/**
+ * End the current trace with a newline, counting it and applying the
+ * size flush policy
+ */
+void traceSinkEndLine(SWFAppContext* app_context);
+
+/**
+ * Apply the per-frame flush policy, called after each frame runs
+ */
+void traceSinkEndFrame(SWFAppContext* app_context);
+
+/**
+ * Hand everything buffered to the writer thread without waiting for it
+ */
+void traceSinkFlush(SWFAppContext* app_context);
+
+/**
+ * Number of traces seen since the sink started, in every mode
+ */
+u64 traceSinkCount(SWFAppContext* app_context);
+
+/**
+ * Check whether traces only need counting, so they can skip formatting
+ */
+int traceSinkCountsOnly(SWFAppContext* app_context);
\ No newline at end of file
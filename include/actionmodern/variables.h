@@ -4,32 +4,71 @@
 #include <swf.h>
 #include <stackvalue.h>
 
-typedef struct
+// Strings shorter than this are stored in the variable itself
+#define ACTION_VAR_INLINE_SIZE 16
+
+// A string variable holds its chars in one of three ways: borrowed from
+// a constant through value, as a reference to a shared string in
+// heap_ptr (owns_memory), or copied into inline_str (is_inline).
+// inline_borrowed is set once inline_str has been pushed, so overwriting
+// the variable only searches the stack for borrowers when there can be
+// some.
+typedef struct ActionVar
 {
 	ActionStackValueType type;
 	u32 str_size;
 	u32 string_id;
+	bool owns_memory;
+	bool is_inline;
+	bool inline_borrowed;
 	union
 	{
 		u64 value;
-		struct
-		{
-			char* heap_ptr;
-			bool owns_memory;
-		};
+		char* heap_ptr;
+		char inline_str[ACTION_VAR_INLINE_SIZE];
 	};
 } ActionVar;
 
-void initMap();
+void initMap(SWFAppContext* app_context);
 void freeMap(SWFAppContext* app_context);
 
-// Array-based variable storage for constant string IDs
-extern ActionVar** var_array;
-extern size_t var_array_size;
-
-void initVarArray(SWFAppContext* app_context, size_t max_string_id);
+// Array-based variable storage in app_context->var_array, indexed by
+// constant string IDs. Variables with dynamic names are stored in the
+// intern table. initVarArray returns 0 if the array couldn't be reserved.
+int initVarArray(SWFAppContext* app_context, size_t max_string_id);
 ActionVar* getVariableById(SWFAppContext* app_context, u32 string_id);
 
+/**
+ * Get a variable by a name without a string id, creating it if needed
+ *
+ * The name is interned the first time it's seen, and the variable is
+ * stored with it, so a lookup costs one probe of the intern table.
+ *
+ * @param app_context Main app context
+ * @param segments Pointer and length pairs of the name, as in string lists
+ * @param num_segments Number of segments
+ * @param length Total length of the name
+ * @param hash Hash of the name, as from hashStringSegments
+ * @return The variable
+ */
+ActionVar* getVariableBySegments(SWFAppContext* app_context, const u64* segments, u64 num_segments, u32 length, u32 hash);
+
 ActionVar* getVariable(SWFAppContext* app_context, char* var_name, size_t key_size);
+
+/**
+ * Delete a variable with a dynamic name, freeing its value
+ *
+ * @return Nonzero if the variable existed
+ */
+int deleteVariable(SWFAppContext* app_context, char* var_name, size_t key_size);
 char* materializeStringList(SWFAppContext* app_context);
+
+/**
+ * Drop a string variable's chars before the variable is overwritten
+ *
+ * Shared strings are released. Inline chars may still be borrowed by
+ * stack slots, which are moved to a copy first.
+ */
+void releaseVariableString(SWFAppContext* app_context, ActionVar* var);
+
 void setVariableWithValue(SWFAppContext* app_context, ActionVar* var);
\ No newline at end of file
@@ -5,7 +5,7 @@
 #include <common.h>
 #include <swf.h>
 
-typedef struct
+typedef struct FlashbangContext
 {
 	int width;
 	int height;
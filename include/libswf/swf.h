@@ -9,7 +9,6 @@
 
 #define STACK (app_context->stack)
 #define SP (app_context->sp)
-#define OLDSP (app_context->oldSP)
 
 typedef enum
 {
@@ -52,12 +51,68 @@ typedef void (*frame_func)(SWFAppContext* app_context);
 extern frame_func frame_funcs[];
 
 typedef struct O1HeapInstance O1HeapInstance;
+typedef struct ActionOpProfile ActionOpProfile;
+typedef struct ActionCycleProfile ActionCycleProfile;
+typedef struct InternTable InternTable;
+typedef struct TraceSink TraceSink;
+typedef struct TraceSinkConfig TraceSinkConfig;
+typedef struct ActionVar ActionVar;
+typedef struct FlashbangContext FlashbangContext;
+
+typedef enum
+{
+	SWF_STOP_QUIT,
+	SWF_STOP_END,
+	SWF_STOP_FRAME_BUDGET,
+	SWF_STOP_TIME_BUDGET,
+	SWF_STOP_CREATE_FAILED,
+} SWFStopReason;
+
+typedef struct SWFRunStats
+{
+	SWFStopReason stop_reason;
+	u64 frames;
+	u64 wall_ns;
+	u64 script_ns;
+	u64 allocs;
+	u64 frees;
+	u64 peak_heap_bytes;
+	u64 traces;
+} SWFRunStats;
 
 typedef struct SWFAppContext
 {
 	char* stack;
 	u32 sp;
-	u32 oldSP;
+	
+	// Frame being run, for overflow reports
+	size_t current_frame;
+	
+	int quit_swf;
+	int bad_poll;
+	size_t next_frame;
+	int manual_next_frame;
+	ActionVar* temp_val;
+	
+	// Variables with constant names, indexed by string id
+	ActionVar* var_array;
+	size_t var_array_size;
+	
+	Character* dictionary;
+	size_t dictionary_capacity;
+	size_t max_char_id;
+	DisplayObject* display_list;
+	size_t display_list_capacity;
+	size_t max_depth;
+	
+	FlashbangContext* flashbang;
+	
+	// Lowest committed stack offset where commits are done by hand
+	size_t stack_commit_offset;
+	
+	u64* str_list_arena;
+	u32 str_list_top;
+	u32 str_list_last;
 	
 	frame_func* frame_funcs;
 	
@@ -70,7 +125,56 @@ typedef struct SWFAppContext
 	char* heap;
 	size_t heap_size;
 	
+	u64 heap_allocs;
+	u64 heap_frees;
+	
+	ActionOpProfile* op_profile;
+	ActionCycleProfile* cycle_profile;
+	
 	size_t max_string_id;
+	u64* number_cache;
+	InternTable* intern_table;
+	
+	char** dead_strings;
+	u32 num_dead_strings;
+	u32 dead_strings_capacity;
+	
+	TraceSink* trace_sink;
+	
+	// Set before swfStart to change where traces go, NULL for stdout
+	const TraceSinkConfig* trace_config;
+	
+	// Set before swfCreate to draw only when the host calls swfRender
+	int host_renders;
+	
+	// Set before swfStart to record a timeline of frames to this file.
+	// With timeline_on_signal it's also written whenever the process
+	// gets SIGUSR1, which is only taken over if some instance asks.
+	const char* timeline_path;
+	int timeline_on_signal;
+	
+	// Set virtual_time before swfStart to drive getTimer by frame count,
+	// advancing virtual_frame_us per frame, for reproducible runs
+	int virtual_time;
+	u32 virtual_frame_us;
+	u64 clock_start_ns;
+	u64 frame_time_ns;
+	u64 clock_frames;
+	u32 clock_reads;
+	
+	// Headless runs only, set before swfStart. max_frames of 0 runs the
+	// default budget and SIZE_MAX runs until the movie quits, max_run_ms
+	// of 0 has no wall-clock limit. quiet drops the banners and frame
+	// headers, traces still go wherever trace_config says.
+	size_t max_frames;
+	u32 max_run_ms;
+	int quiet;
+	
+	// Set before swfStart to write run_stats as JSON to this file, or to
+	// stdout for "-". run_stats is filled in either way.
+	const char* stats_path;
+	SWFRunStats run_stats;
+	u64 run_start_ns;
 	
 	size_t bitmap_count;
 	size_t bitmap_highest_w;
@@ -96,13 +200,58 @@ typedef struct SWFAppContext
 	size_t cxform_data_size;
 } SWFAppContext;
 
-extern int quit_swf;
-extern size_t next_frame;
-extern int manual_next_frame;
+// Generated code still refers to these by the names they had as globals,
+// every frame function has app_context in scope
+#ifndef SWF_RUNTIME_INTERNAL
+#define quit_swf (app_context->quit_swf)
+#define next_frame (app_context->next_frame)
+#define manual_next_frame (app_context->manual_next_frame)
+#define temp_val (app_context->temp_val)
+#endif
+
+/**
+ * Run an instance until it quits, owning the calling thread until then
+ *
+ * With graphics this also runs the window's event loop and keeps showing
+ * the last frame until the window is closed.
+ */
+void swfStart(SWFAppContext* app_context);
+
+/**
+ * Set up an instance and run tagInit, without running any frames
+ *
+ * For hosts that run their own loop and pace frames themselves. Every
+ * field swfStart reads has to be set before this.
+ *
+ * @return Nonzero on success. On failure the address space for the
+ *         instance couldn't be reserved, nothing is left to destroy and
+ *         run_stats.stop_reason is SWF_STOP_CREATE_FAILED.
+ */
+int swfCreate(SWFAppContext* app_context);
 
-extern Character* dictionary;
+/**
+ * Run up to n frames and return how many ran
+ *
+ * Returns fewer than n only once the instance has quit, or without
+ * graphics has run out of budget, after which it runs nothing more.
+ * Instances can be stepped from any thread, one thread at a time.
+ * Nothing here polls window events, that's left to the host.
+ *
+ * @param app_context Instance created by swfCreate
+ * @param n Most frames to run
+ * @return Number of frames run
+ */
+size_t swfStepFrames(SWFAppContext* app_context, size_t n);
 
-extern DisplayObject* display_list;
-extern size_t max_depth;
+void swfDestroy(SWFAppContext* app_context);
 
-void swfStart(SWFAppContext* app_context);
\ No newline at end of file
+#ifndef NO_GRAPHICS
+/**
+ * Draw the display list as it stands
+ *
+ * ShowFrame tags already do this while frames run, unless host_renders
+ * was set before swfCreate, in which case the host calls this when it
+ * wants a frame drawn.
+ */
+void swfRender(SWFAppContext* app_context);
+#endif
\ No newline at end of file
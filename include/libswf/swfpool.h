@@ -0,0 +1,60 @@
+#pragma once
+
+#include <common.h>
+#include <swf.h>
+
+/**
+ * SWF Instance Pool
+ *
+ * Runs many headless instances on a fixed set of worker threads. Each
+ * worker has its own queue of waiting instances and runs one instance
+ * frame by frame until it stops, so it stays on one core with its data
+ * in cache. Then it moves on to the newest instance in its queue, and a
+ * worker whose queue is empty steals the instance that has waited
+ * longest in another worker's queue.
+ *
+ * An instance is only initialized the first time a worker runs it, and
+ * torn down as soon as it stops, so the number of heaps alive at once
+ * stays close to the number of workers however many are submitted.
+ * Budgets, quiet mode and stats come from each SWFAppContext as with
+ * swfStart. Console build only.
+ */
+
+typedef struct SWFPool SWFPool;
+
+/**
+ * Called on a worker thread once an instance has stopped and been torn
+ * down, with app_context->run_stats filled in. The pool doesn't touch
+ * app_context after this, so it can be freed or submitted again here.
+ */
+typedef void (*SWFDoneCallback)(SWFAppContext* app_context, void* user);
+
+/**
+ * Start the worker threads
+ *
+ * @param num_workers Number of workers, 0 for one per core
+ * @return The new pool
+ */
+SWFPool* swfPoolCreate(u32 num_workers);
+
+/**
+ * Queue an instance to run until it quits or runs out of budget
+ *
+ * @param pool Pool to run on
+ * @param app_context Instance to run, as it would be passed to swfStart
+ * @param done Called when the instance is done, can be NULL
+ * @param user Passed to done
+ */
+void swfPoolSubmit(SWFPool* pool, SWFAppContext* app_context, SWFDoneCallback done, void* user);
+
+/**
+ * Wait until every instance submitted so far is done
+ */
+void swfPoolWait(SWFPool* pool);
+
+/**
+ * Wait for every instance, then stop the workers and free the pool
+ */
+void swfPoolDestroy(SWFPool* pool);
+
+u32 swfPoolWorkerCount(SWFPool* pool);
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <common.h>
+#include <swf.h>
+
+/**
+ * Instance Snapshots
+ *
+ * Saves the state of an instance between frames to a compact image, and
+ * restores it into another instance of the same build, so hosts can skip
+ * a long scripted intro, fork many variants from one state, or roll back.
+ *
+ * The image holds the frame position, the clock, every variable, the
+ * interned strings, the action stack with its string lists, and the
+ * dictionary and display list. Each heap allocation is an instance's own,
+ * and one heap's addresses mean nothing in another, so the image isn't a
+ * copy of the heap arena. Strings in the heap are written once each with
+ * their reference counts and allocated again on restore. Pointers are
+ * written as offsets: into a shared string, a variable's inline chars, or
+ * from a fixed address in the executable for constant strings, which
+ * moves together with them when the executable is loaded elsewhere.
+ *
+ * Trace output, profiles, run stats and GPU state aren't part of an image.
+ */
+
+/**
+ * Save an instance's state
+ *
+ * Call between frames, never from inside a frame function. Strings that
+ * nothing uses any more are freed first, nothing else is changed.
+ *
+ * @param app_context Instance created by swfCreate
+ * @param image Set to the image, which the caller frees with free()
+ * @return Size of the image in bytes, or 0 if it couldn't be made
+ */
+size_t swfSnapshot(SWFAppContext* app_context, char** image);
+
+/**
+ * Restore a saved state into a new instance
+ *
+ * The instance has to be from the same executable as the one the image
+ * was taken from, just created by swfCreate with no frames run. Budgets,
+ * run stats and tracing stay the instance's own.
+ *
+ * @param app_context Instance created by swfCreate
+ * @param image Image from swfSnapshot
+ * @param size Size of the image in bytes
+ * @return Nonzero on success. On failure the instance is left
+ *         partly restored and should only be destroyed.
+ */
+int swfRestore(SWFAppContext* app_context, const char* image, size_t size);
\ No newline at end of file
@@ -5,12 +5,13 @@
 
 // Core tag functions - always available
 void tagInit(SWFAppContext* app_context);
-void tagSetBackgroundColor(u8 red, u8 green, u8 blue);
+void tagSetBackgroundColor(SWFAppContext* app_context, u8 red, u8 green, u8 blue);
 void tagShowFrame(SWFAppContext* app_context);
 
 // Graphics-only tag functions
+void tagDrawFrame(SWFAppContext* app_context);
 void tagDefineShape(SWFAppContext* app_context, CharacterType type, size_t char_id, size_t shape_offset, size_t shape_size);
 void tagDefineText(SWFAppContext* app_context, size_t char_id, size_t text_start, size_t text_size, u32 transform_start, u32 cxform_id);
 void tagPlaceObject2(SWFAppContext* app_context, size_t depth, size_t char_id, u32 transform_id);
-void defineBitmap(size_t offset, size_t size, u32 width, u32 height);
-void finalizeBitmaps();
\ No newline at end of file
+void defineBitmap(SWFAppContext* app_context, size_t offset, size_t size, u32 width, u32 height);
+void finalizeBitmaps(SWFAppContext* app_context);
\ No newline at end of file
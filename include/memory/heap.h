@@ -16,8 +16,9 @@
  *
  * @param app_context Main app context
  * @param size Heap size in bytes
+ * @return Nonzero on success, 0 if the address space couldn't be reserved
  */
-void heap_init(SWFAppContext* app_context, size_t size);
+int heap_init(SWFAppContext* app_context, size_t size);
 
 /**
  * Allocate memory from the heap
@@ -38,6 +39,15 @@ void* heap_alloc(SWFAppContext* app_context, size_t size);
  */
 void heap_free(SWFAppContext* app_context, void* ptr);
 
+/**
+ * Get the most heap memory that has been allocated at once, including
+ * allocator overhead
+ *
+ * @param app_context Main app context
+ * @return Peak allocated bytes since heap_init()
+ */
+size_t heap_peak_allocated(SWFAppContext* app_context);
+
 /**
  * Shutdown the heap system
  *
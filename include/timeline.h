@@ -0,0 +1,75 @@
+#pragma once
+
+#include <common.h>
+
+/**
+ * Timeline
+ *
+ * Records how long frames and runtime phases take, as complete events
+ * written in the Chrome trace event format, which chrome://tracing and
+ * Perfetto open directly. Each thread records into its own ring of the
+ * most recent TIMELINE_BUFFER_EVENTS events, so recording never takes a
+ * lock and a long run keeps its latest frames.
+ *
+ * The file is written when the last user stops the timeline, and on
+ * POSIX, for users that ask for it, also whenever the process gets
+ * SIGUSR1, at the next frame boundary. While stopped, a span costs one
+ * well-predicted branch.
+ */
+
+#define TIMELINE_BUFFER_EVENTS 65536
+
+extern int timeline_enabled;
+
+u64 timelineNow();
+
+/**
+ * Start recording, or add a user if already recording
+ *
+ * @param path File the trace JSON is written to
+ * @param write_on_signal Nonzero to also write the file on SIGUSR1. This
+ *        takes over SIGUSR1 for the process until the last user stops,
+ *        then puts back whatever handled it before.
+ */
+void timelineStart(const char* path, int write_on_signal);
+
+/**
+ * Drop a user, writing the file and freeing every buffer with the last
+ */
+void timelineStop();
+
+/**
+ * Write the file now, with everything recorded so far
+ */
+void timelineWrite();
+
+/**
+ * Write the file if a signal asked for it, called between frames
+ */
+void timelinePoll();
+
+/**
+ * Record a span that started at start
+ *
+ * @param name Static string naming the span
+ * @param start Value of timelineBegin() when the span started
+ * @param arg Shown as the span's argument, like a frame number
+ */
+void timelineRecord(const char* name, u64 start, u64 arg);
+
+static inline u64 timelineBegin()
+{
+	return timeline_enabled ? timelineNow() : 0;
+}
+
+// A span begun before recording started isn't recorded
+static inline void timelineEnd(const char* name, u64 start, u64 arg)
+{
+	if (start != 0)
+	{
+		timelineRecord(name, start, arg);
+	}
+}
+
+#define TIMELINE_BEGIN(start) u64 start = timelineBegin();
+#define TIMELINE_END(start, name) timelineEnd(name, start, 0);
\ No newline at end of file
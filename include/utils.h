@@ -12,8 +12,14 @@
 
 void grow_ptr(SWFAppContext* app_context, char** ptr, size_t* capacity_ptr, size_t elem_size);
 
-u32 get_elapsed_ms();
+u64 get_elapsed_ns();
 int getpagesize();
 
+/**
+ * Reserve zeroed address space whose pages are only backed once touched
+ *
+ * @param size Bytes to reserve
+ * @return The region, or NULL if it couldn't be reserved
+ */
 char* vmem_reserve(size_t size);
 void vmem_release(char* addr, size_t size);
\ No newline at end of file
@@ -6,33 +6,107 @@
 #include <time.h>
 
 #include <recomp.h>
+#include <number.h>
+#include <strcompare.h>
+#include <intern.h>
+#include <sharedstring.h>
+#include <tracesink.h>
+#include <frameclock.h>
 #include <utils.h>
+#include <heap.h>
 
-u32 start_time;
+static inline double numberToF64(ActionStackValueType type, u64 value)
+{
+	return type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &value) : VAL(double, &value);
+}
 
-void initTime()
+// Numbers are short, so a list is joined on the stack unless it's long
+#define LIST_NUMBER_BUFFER_SIZE 64
+
+static double stringListToF64(SWFAppContext* app_context, const u64* str_list, u32 length)
 {
-	start_time = get_elapsed_ms();
+	char buffer[LIST_NUMBER_BUFFER_SIZE];
+	char* chars = buffer;
+	
+	if (length >= LIST_NUMBER_BUFFER_SIZE)
+	{
+		chars = (char*) HALLOC(length + 1);
+	}
+	
+	char* dest = chars;
+	
+	for (u64 i = 0; i < 2*str_list[0]; i += 2)
+	{
+		memcpy(dest, (char*) str_list[i + 1], str_list[i + 2]);
+		dest += str_list[i + 2];
+	}
+	
+	*dest = '\0';
+	
+	double value = stringToNumber(chars);
+	
+	if (chars != buffer)
+	{
+		FREE(chars);
+	}
+	
+	return value;
 }
 
-ActionStackValueType convertString(SWFAppContext* app_context, char* var_str)
+static inline double slotToF64(SWFAppContext* app_context, u32 sp)
 {
-	if (STACK_TOP_TYPE == ACTION_STACK_VALUE_F32)
+	u64 value = VAL(u64, &STACK[sp + 8]);
+	
+	if (STACK[sp] == ACTION_STACK_VALUE_STRING)
+	{
+		return stringIdToNumber(app_context, (char*) value, VAL(u32, &STACK[sp + 4]), VAL(u32, &STACK[sp]) >> 8);
+	}
+	
+	if (STACK[sp] == ACTION_STACK_VALUE_STR_LIST)
+	{
+		return stringListToF64(app_context, (u64*) value, VAL(u32, &STACK[sp + 4]));
+	}
+	
+	return numberToF64(STACK[sp], value);
+}
+
+static void convertSlotToString(SWFAppContext* app_context, u32 sp, char* var_str)
+{
+	u8 type = STACK[sp];
+	
+	if (type == ACTION_STACK_VALUE_F32 || type == ACTION_STACK_VALUE_F64)
 	{
-		STACK_TOP_TYPE = ACTION_STACK_VALUE_STRING;
-		VAL(u64, &STACK_TOP_VALUE) = (u64) var_str;
-		snprintf(var_str, 17, "%.15g", VAL(float, &STACK_TOP_VALUE));
+		char str[NUMBER_STRING_MAX_SIZE];
+		u32 length = numberToString(numberToF64(type, VAL(u64, &STACK[sp + 8])), str);
+		
+		// Generated code only reserves CONVERT_STRING_SIZE bytes
+		if (length > CONVERT_STRING_SIZE - 1)
+		{
+			length = CONVERT_STRING_SIZE - 1;
+		}
+		
+		memcpy(var_str, str, length);
+		var_str[length] = '\0';
+		
+		VAL(u32, &STACK[sp]) = ACTION_STACK_VALUE_STRING;
+		VAL(u32, &STACK[sp + 4]) = length;
+		VAL(u64, &STACK[sp + 8]) = (u64) var_str;
 	}
+}
+
+ActionStackValueType convertString(SWFAppContext* app_context, char* var_str)
+{
+	convertSlotToString(app_context, SP, var_str);
 	
 	return ACTION_STACK_VALUE_STRING;
 }
 
 ActionStackValueType convertFloat(SWFAppContext* app_context)
 {
-	if (STACK_TOP_TYPE == ACTION_STACK_VALUE_STRING)
+	if (STACK_TOP_TYPE == ACTION_STACK_VALUE_STRING || STACK_TOP_TYPE == ACTION_STACK_VALUE_STR_LIST)
 	{
-		double temp = atof((char*) VAL(u64, &STACK_TOP_VALUE));
-		STACK_TOP_TYPE = ACTION_STACK_VALUE_F64;
+		double temp = slotToF64(app_context, SP);
+		VAL(u32, &STACK[SP]) = ACTION_STACK_VALUE_F64;
 		VAL(u64, &STACK_TOP_VALUE) = VAL(u64, &temp);
 		
 		return ACTION_STACK_VALUE_F64;
@@ -67,8 +141,16 @@ void pushVar(SWFAppContext* app_context, ActionVar* var)
 		
 		case ACTION_STACK_VALUE_STRING:
 		{
-			// Use heap pointer if variable owns memory, otherwise use value as pointer
-			char* str_ptr = var->owns_memory ? var->heap_ptr : (char*) var->value;
+			// The stack borrows the variable's chars, shared strings without
+			// taking a reference (see sharedstring.h) and inline ones until
+			// the variable is overwritten (see releaseVariableString)
+			char* str_ptr = (char*) var->value;
+			
+			if (var->is_inline)
+			{
+				str_ptr = var->inline_str;
+				var->inline_borrowed = true;
+			}
 			
 			PUSH_STR_ID(str_ptr, var->str_size, var->string_id);
 			
@@ -81,32 +163,14 @@ void peekVar(SWFAppContext* app_context, ActionVar* var)
 {
 	var->type = STACK_TOP_TYPE;
 	var->str_size = STACK_TOP_N;
-	
-	if (STACK_TOP_TYPE == ACTION_STACK_VALUE_STR_LIST)
-	{
-		var->value = (u64) &STACK_TOP_VALUE;
-	}
-	
-	else
-	{
-		var->value = VAL(u64, &STACK_TOP_VALUE);
-	}
+	var->value = STACK_TOP_VALUE;
 }
 
 void peekSecondVar(SWFAppContext* app_context, ActionVar* var)
 {
 	var->type = STACK_SECOND_TOP_TYPE;
 	var->str_size = STACK_SECOND_TOP_N;
-	
-	if (STACK_SECOND_TOP_TYPE == ACTION_STACK_VALUE_STR_LIST)
-	{
-		var->value = (u64) &STACK_SECOND_TOP_VALUE;
-	}
-	
-	else
-	{
-		var->value = VAL(u64, &STACK_SECOND_TOP_VALUE);
-	}
+	var->value = STACK_SECOND_TOP_VALUE;
 }
 
 void popVar(SWFAppContext* app_context, ActionVar* var)
@@ -116,125 +180,51 @@ void popVar(SWFAppContext* app_context, ActionVar* var)
 	POP();
 }
 
-void actionAdd(SWFAppContext* app_context)
+// Result kernels, called with the operands already popped (b is the
+// second-to-top value, a is the top value, and the result is b op a)
+
+static void pushAddF32(SWFAppContext* app_context, float b, float a)
 {
-	convertFloat(app_context);
-	ActionVar a;
-	popVar(app_context, &a);
-	
-	convertFloat(app_context);
-	ActionVar b;
-	popVar(app_context, &b);
-	
-	if (a.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = VAL(double, &a.value);
-		double b_val = b.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &b.value) : VAL(double, &b.value);
-		
-		double c = b_val + a_val;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-	}
-	
-	else if (b.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = a.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &a.value) : VAL(double, &a.value);
-		double b_val = VAL(double, &b.value);
-		
-		double c = b_val + a_val;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-	}
-	
-	else
-	{
-		float c = VAL(float, &b.value) + VAL(float, &a.value);
-		PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
-	}
+	float c = b + a;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
 }
 
-void actionSubtract(SWFAppContext* app_context)
+static void pushAddF64(SWFAppContext* app_context, double b, double a)
 {
-	convertFloat(app_context);
-	ActionVar a;
-	popVar(app_context, &a);
-	
-	convertFloat(app_context);
-	ActionVar b;
-	popVar(app_context, &b);
-	
-	if (a.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = VAL(double, &a.value);
-		double b_val = b.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &b.value) : VAL(double, &b.value);
-		
-		double c = b_val - a_val;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-	}
-	
-	else if (b.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = a.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &a.value) : VAL(double, &a.value);
-		double b_val = VAL(double, &b.value);
-		
-		double c = b_val - a_val;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-	}
-	
-	else
-	{
-		float c = VAL(float, &b.value) - VAL(float, &a.value);
-		PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
-	}
+	double c = b + a;
+	PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
 }
 
-void actionMultiply(SWFAppContext* app_context)
+static void pushSubtractF32(SWFAppContext* app_context, float b, float a)
 {
-	convertFloat(app_context);
-	ActionVar a;
-	popVar(app_context, &a);
-	
-	convertFloat(app_context);
-	ActionVar b;
-	popVar(app_context, &b);
-	
-	if (a.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = VAL(double, &a.value);
-		double b_val = b.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &b.value) : VAL(double, &b.value);
-		
-		double c = b_val*a_val;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-	}
-	
-	else if (b.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = a.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &a.value) : VAL(double, &a.value);
-		double b_val = VAL(double, &b.value);
-		
-		double c = b_val*a_val;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-	}
-	
-	else
-	{
-		float c = VAL(float, &b.value)*VAL(float, &a.value);
-		PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
-	}
+	float c = b - a;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
 }
 
-void actionDivide(SWFAppContext* app_context)
+static void pushSubtractF64(SWFAppContext* app_context, double b, double a)
 {
-	convertFloat(app_context);
-	ActionVar a;
-	popVar(app_context, &a);
-	
-	convertFloat(app_context);
-	ActionVar b;
-	popVar(app_context, &b);
-	
-	if (VAL(float, &a.value) == 0.0f)
+	double c = b - a;
+	PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
+}
+
+static void pushMultiplyF32(SWFAppContext* app_context, float b, float a)
+{
+	float c = b*a;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+static void pushMultiplyF64(SWFAppContext* app_context, double b, double a)
+{
+	double c = b*a;
+	PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
+}
+
+static void pushDivideF32(SWFAppContext* app_context, float b, float a)
+{
+	if (a == 0.0f)
 	{
 		// SWF 4:
-		PUSH_STR("#ERROR#", 8);
+		PUSH_STR("#ERROR#", 7);
 		
 		// SWF 5:
 		//~ if (a->value == 0.0f)
@@ -251,38 +241,112 @@ void actionDivide(SWFAppContext* app_context)
 		//~ {
 			//~ float c = -INFINITY;
 		//~ }
+		
+		return;
 	}
 	
-	else
+	float c = b/a;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+static void pushDivideF64(SWFAppContext* app_context, double b, double a)
+{
+	if (a == 0.0)
 	{
-		if (a.type == ACTION_STACK_VALUE_F64)
-		{
-			double a_val = VAL(double, &a.value);
-			double b_val = b.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &b.value) : VAL(double, &b.value);
-			
-			double c = b_val/a_val;
-			PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-		}
-		
-		else if (b.type == ACTION_STACK_VALUE_F64)
-		{
-			double a_val = a.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &a.value) : VAL(double, &a.value);
-			double b_val = VAL(double, &b.value);
-			
-			double c = b_val/a_val;
-			PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-		}
+		// SWF 4:
+		PUSH_STR("#ERROR#", 7);
 		
-		else
-		{
-			float c = VAL(float, &b.value)/VAL(float, &a.value);
-			PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
-		}
+		return;
 	}
+	
+	double c = b/a;
+	PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
 }
 
-void actionEquals(SWFAppContext* app_context)
+static void pushEqualsF32(SWFAppContext* app_context, float b, float a)
 {
+	float c = b == a ? 1.0f : 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+static void pushEqualsF64(SWFAppContext* app_context, double b, double a)
+{
+	float c = b == a ? 1.0f : 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+static void pushLessF32(SWFAppContext* app_context, float b, float a)
+{
+	float c = b < a ? 1.0f : 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+static void pushLessF64(SWFAppContext* app_context, double b, double a)
+{
+	float c = b < a ? 1.0f : 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+static void pushAndF32(SWFAppContext* app_context, float b, float a)
+{
+	float c = b != 0.0f && a != 0.0f ? 1.0f : 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+static void pushAndF64(SWFAppContext* app_context, double b, double a)
+{
+	float c = b != 0.0 && a != 0.0 ? 1.0f : 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+static void pushOrF32(SWFAppContext* app_context, float b, float a)
+{
+	float c = b != 0.0f || a != 0.0f ? 1.0f : 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+static void pushOrF64(SWFAppContext* app_context, double b, double a)
+{
+	float c = b != 0.0 || a != 0.0 ? 1.0f : 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+}
+
+typedef struct
+{
+	void (*f32)(SWFAppContext* app_context, float b, float a);
+	void (*f64)(SWFAppContext* app_context, double b, double a);
+} NumericKernels;
+
+#ifdef SWF_OP_PAIR_PROFILE
+static const ActionOpId numeric_op_ids[ACTION_NUMERIC_OP_COUNT] =
+{
+	[ACTION_NUMERIC_OP_ADD] = ACTION_OP_ADD,
+	[ACTION_NUMERIC_OP_SUBTRACT] = ACTION_OP_SUBTRACT,
+	[ACTION_NUMERIC_OP_MULTIPLY] = ACTION_OP_MULTIPLY,
+	[ACTION_NUMERIC_OP_DIVIDE] = ACTION_OP_DIVIDE,
+	[ACTION_NUMERIC_OP_EQUALS] = ACTION_OP_EQUALS,
+	[ACTION_NUMERIC_OP_LESS] = ACTION_OP_LESS,
+	[ACTION_NUMERIC_OP_AND] = ACTION_OP_AND,
+	[ACTION_NUMERIC_OP_OR] = ACTION_OP_OR,
+};
+#endif
+
+static const NumericKernels numeric_kernels[ACTION_NUMERIC_OP_COUNT] =
+{
+	[ACTION_NUMERIC_OP_ADD] = { pushAddF32, pushAddF64 },
+	[ACTION_NUMERIC_OP_SUBTRACT] = { pushSubtractF32, pushSubtractF64 },
+	[ACTION_NUMERIC_OP_MULTIPLY] = { pushMultiplyF32, pushMultiplyF64 },
+	[ACTION_NUMERIC_OP_DIVIDE] = { pushDivideF32, pushDivideF64 },
+	[ACTION_NUMERIC_OP_EQUALS] = { pushEqualsF32, pushEqualsF64 },
+	[ACTION_NUMERIC_OP_LESS] = { pushLessF32, pushLessF64 },
+	[ACTION_NUMERIC_OP_AND] = { pushAndF32, pushAndF64 },
+	[ACTION_NUMERIC_OP_OR] = { pushOrF32, pushOrF64 },
+};
+
+void actionNumericOp(SWFAppContext* app_context, ActionNumericOp op)
+{
+	PROFILE_OP(numeric_op_ids[op]);
+	
 	convertFloat(app_context);
 	ActionVar a;
 	popVar(app_context, &a);
@@ -291,350 +355,347 @@ void actionEquals(SWFAppContext* app_context)
 	ActionVar b;
 	popVar(app_context, &b);
 	
-	if (a.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = VAL(double, &a.value);
-		double b_val = b.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &b.value) : VAL(double, &b.value);
-		
-		float c = b_val == a_val ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
-	}
+	const NumericKernels* kernels = &numeric_kernels[op];
 	
-	else if (b.type == ACTION_STACK_VALUE_F64)
+	if (a.type == ACTION_STACK_VALUE_F32 && b.type == ACTION_STACK_VALUE_F32)
 	{
-		double a_val = a.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &a.value) : VAL(double, &a.value);
-		double b_val = VAL(double, &b.value);
-		
-		float c = b_val == a_val ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+		kernels->f32(app_context, VAL(float, &b.value), VAL(float, &a.value));
 	}
 	
 	else
 	{
-		float c = VAL(float, &b.value) == VAL(float, &a.value) ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+		kernels->f64(app_context, numberToF64(b.type, b.value), numberToF64(a.type, a.value));
 	}
 }
 
+// Type-specialized entry points. These trust the operand types the
+// recompiler proved statically and skip the conversion and dispatch
+// done by actionNumericOp.
+#define DEFINE_NUMERIC_VARIANTS(name, op_id) \
+	void action##name##F32(SWFAppContext* app_context) \
+	{ \
+		PROFILE_OP(op_id); \
+		float a = VAL(float, &STACK_TOP_VALUE); \
+		float b = VAL(float, &STACK_SECOND_TOP_VALUE); \
+		POP_2(); \
+		push##name##F32(app_context, b, a); \
+	} \
+	\
+	void action##name##F64(SWFAppContext* app_context) \
+	{ \
+		PROFILE_OP(op_id); \
+		double a = VAL(double, &STACK_TOP_VALUE); \
+		double b = VAL(double, &STACK_SECOND_TOP_VALUE); \
+		POP_2(); \
+		push##name##F64(app_context, b, a); \
+	} \
+	\
+	void action##name##Mixed(SWFAppContext* app_context) \
+	{ \
+		PROFILE_OP(op_id); \
+		double a = numberToF64(STACK_TOP_TYPE, STACK_TOP_VALUE); \
+		double b = numberToF64(STACK_SECOND_TOP_TYPE, STACK_SECOND_TOP_VALUE); \
+		POP_2(); \
+		push##name##F64(app_context, b, a); \
+	} \
+	\
+	void action##name##StrNum(SWFAppContext* app_context) \
+	{ \
+		PROFILE_OP(op_id); \
+		double a = slotToF64(app_context, SP); \
+		double b = slotToF64(app_context, SP_SECOND_TOP); \
+		POP_2(); \
+		push##name##F64(app_context, b, a); \
+	}
+
+DEFINE_NUMERIC_VARIANTS(Add, ACTION_OP_ADD)
+DEFINE_NUMERIC_VARIANTS(Subtract, ACTION_OP_SUBTRACT)
+DEFINE_NUMERIC_VARIANTS(Multiply, ACTION_OP_MULTIPLY)
+DEFINE_NUMERIC_VARIANTS(Divide, ACTION_OP_DIVIDE)
+DEFINE_NUMERIC_VARIANTS(Equals, ACTION_OP_EQUALS)
+DEFINE_NUMERIC_VARIANTS(Less, ACTION_OP_LESS)
+
+void actionAdd(SWFAppContext* app_context)
+{
+	actionNumericOp(app_context, ACTION_NUMERIC_OP_ADD);
+}
+
+void actionSubtract(SWFAppContext* app_context)
+{
+	actionNumericOp(app_context, ACTION_NUMERIC_OP_SUBTRACT);
+}
+
+void actionMultiply(SWFAppContext* app_context)
+{
+	actionNumericOp(app_context, ACTION_NUMERIC_OP_MULTIPLY);
+}
+
+void actionDivide(SWFAppContext* app_context)
+{
+	actionNumericOp(app_context, ACTION_NUMERIC_OP_DIVIDE);
+}
+
+void actionEquals(SWFAppContext* app_context)
+{
+	actionNumericOp(app_context, ACTION_NUMERIC_OP_EQUALS);
+}
+
 void actionLess(SWFAppContext* app_context)
 {
-	ActionVar a;
-	convertFloat(app_context);
-	popVar(app_context, &a);
-	
-	ActionVar b;
-	convertFloat(app_context);
-	popVar(app_context, &b);
-	
-	if (a.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = VAL(double, &a.value);
-		double b_val = b.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &b.value) : VAL(double, &b.value);
-		
-		float c = b_val < a_val ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-	}
-	
-	else if (b.type == ACTION_STACK_VALUE_F64)
+	actionNumericOp(app_context, ACTION_NUMERIC_OP_LESS);
+}
+
+void actionAnd(SWFAppContext* app_context)
+{
+	actionNumericOp(app_context, ACTION_NUMERIC_OP_AND);
+}
+
+void actionOr(SWFAppContext* app_context)
+{
+	actionNumericOp(app_context, ACTION_NUMERIC_OP_OR);
+}
+
+static inline double varToF64(SWFAppContext* app_context, ActionVar* var)
+{
+	if (var->type == ACTION_STACK_VALUE_STRING)
 	{
-		double a_val = a.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &a.value) : VAL(double, &a.value);
-		double b_val = VAL(double, &b.value);
+		if (var->is_inline)
+		{
+			return stringToNumber(var->inline_str);
+		}
 		
-		float c = b_val < a_val ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
+		// A variable can share a buffer another one has appended to since
+		return stringIdToNumber(app_context, var->heap_ptr, var->str_size, var->string_id);
 	}
 	
-	else
-	{
-		float c = VAL(float, &b.value) < VAL(float, &a.value) ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
-	}
+	return numberToF64(var->type, var->value);
 }
 
-void actionAnd(SWFAppContext* app_context)
+void actionAddConst(SWFAppContext* app_context, float c)
 {
-	ActionVar a;
-	convertFloat(app_context);
-	popVar(app_context, &a);
-	
-	ActionVar b;
-	convertFloat(app_context);
-	popVar(app_context, &b);
+	PROFILE_OP(ACTION_OP_ADD_CONST);
 	
-	if (a.type == ACTION_STACK_VALUE_F64)
+	if (STACK_TOP_TYPE == ACTION_STACK_VALUE_F32)
 	{
-		double a_val = VAL(double, &a.value);
-		double b_val = b.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &b.value) : VAL(double, &b.value);
+		float result = VAL(float, &STACK_TOP_VALUE) + c;
+		STACK_TOP_VALUE = VAL(u32, &result);
 		
-		float c = b_val != 0.0 && a_val != 0.0 ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
+		return;
 	}
 	
-	else if (b.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = a.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &a.value) : VAL(double, &a.value);
-		double b_val = VAL(double, &b.value);
-		
-		float c = b_val != 0.0 && a_val != 0.0 ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-	}
+	double result = slotToF64(app_context, SP) + (double) c;
+	VAL(u32, &STACK[SP]) = ACTION_STACK_VALUE_F64;
+	STACK_TOP_VALUE = VAL(u64, &result);
+}
+
+void actionAddConstF64(SWFAppContext* app_context, double c)
+{
+	PROFILE_OP(ACTION_OP_ADD_CONST);
 	
-	else
-	{
-		float c = VAL(float, &b.value) != 0.0f && VAL(float, &a.value) != 0.0f ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
-	}
+	double result = slotToF64(app_context, SP) + c;
+	VAL(u32, &STACK[SP]) = ACTION_STACK_VALUE_F64;
+	STACK_TOP_VALUE = VAL(u64, &result);
 }
 
-void actionOr(SWFAppContext* app_context)
+void actionIncrementVarById(SWFAppContext* app_context, u32 string_id)
 {
-	ActionVar a;
-	convertFloat(app_context);
-	popVar(app_context, &a);
+	PROFILE_OP(ACTION_OP_INCREMENT_VAR);
 	
-	ActionVar b;
-	convertFloat(app_context);
-	popVar(app_context, &b);
+	ActionVar* var = getVariableById(app_context, string_id);
 	
-	if (a.type == ACTION_STACK_VALUE_F64)
+	switch (var->type)
 	{
-		double a_val = VAL(double, &a.value);
-		double b_val = b.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &b.value) : VAL(double, &b.value);
+		case ACTION_STACK_VALUE_F32:
+		{
+			float result = VAL(float, &var->value) + 1.0f;
+			var->value = VAL(u32, &result);
+			
+			break;
+		}
 		
-		float c = b_val != 0.0 || a_val != 0.0 ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
-	}
-	
-	else if (b.type == ACTION_STACK_VALUE_F64)
-	{
-		double a_val = a.type == ACTION_STACK_VALUE_F32 ? (double) VAL(float, &a.value) : VAL(double, &a.value);
-		double b_val = VAL(double, &b.value);
+		case ACTION_STACK_VALUE_F64:
+		{
+			double result = VAL(double, &var->value) + 1.0;
+			var->value = VAL(u64, &result);
+			
+			break;
+		}
 		
-		float c = b_val != 0.0 || a_val != 0.0 ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F64, VAL(u64, &c));
+		default:
+		{
+			double result = varToF64(app_context, var) + 1.0;
+			
+			releaseVariableString(app_context, var);
+			
+			var->type = ACTION_STACK_VALUE_F64;
+			var->string_id = 0;
+			var->value = VAL(u64, &result);
+			
+			break;
+		}
 	}
+}
+
+int actionCompareVarConstBranch(SWFAppContext* app_context, u32 string_id, float c)
+{
+	PROFILE_OP(ACTION_OP_COMPARE_VAR_CONST_BRANCH);
 	
-	else
+	ActionVar* var = getVariableById(app_context, string_id);
+	
+	if (var->type == ACTION_STACK_VALUE_F32)
 	{
-		float c = VAL(float, &b.value) != 0.0f || VAL(float, &a.value) != 0.0f ? 1.0f : 0.0f;
-		PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &c));
+		return VAL(float, &var->value) < c;
 	}
+	
+	return varToF64(app_context, var) < (double) c;
 }
 
 void actionNot(SWFAppContext* app_context)
 {
+	PROFILE_OP(ACTION_OP_NOT);
+	
 	ActionVar v;
 	convertFloat(app_context);
 	popVar(app_context, &v);
 	
-	float result = v.value == 0.0f ? 1.0f : 0.0f;
-	PUSH(ACTION_STACK_VALUE_F32, VAL(u64, &result));
+	// NaN is false, like zero
+	double value = numberToF64(v.type, v.value);
+	float result = value == 0.0 || value != value ? 1.0f : 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &result));
 }
 
 int evaluateCondition(SWFAppContext* app_context)
 {
+	PROFILE_OP(ACTION_OP_IF);
+	
 	ActionVar v;
 	convertFloat(app_context);
 	popVar(app_context, &v);
 	
-	return v.value != 0.0f;
+	double value = numberToF64(v.type, v.value);
+	
+	return value != 0.0 && value == value;
 }
 
-int strcmp_list_a_list_b(u64 a_value, u64 b_value)
+// String lists live in the arena in the same LIFO order as the stack slots
+// that own them. Each list is preceded by a header of three words: the
+// offset of the previous list, the SP of the owning slot, and the hash of
+// the concatenated string if it's known (see slotStringHash). A list is
+// dead once its owning slot has been popped or overwritten, so dead lists
+// are trimmed off the top of the arena before each new allocation. This
+// relies on every list having exactly one owning slot that never moves.
+// The header size is STR_LIST_HEADER_SIZE, in action.h.
+
+// Strings up to this long are hashed on the spot when concatenated, so
+// names like "item" + i arrive at the variable store with their hash.
+// Longer ones would make concatenation O(n), so their lists go unhashed.
+#define EAGER_HASH_MAX_LENGTH 64
+
+// Hash of the string in a slot, if it's available without reading the
+// whole string: string lists carry it in their header, and constant and
+// interned strings have it cached by id
+static int slotStringHash(SWFAppContext* app_context, u32 sp, u32* hash)
 {
-	char** a_list = (char**) a_value;
-	char** b_list = (char**) b_value;
-	
-	u64 num_a_strings = (u64) a_list[0];
-	u64 num_b_strings = (u64) b_list[0];
-	
-	u64 a_str_i = 0;
-	u64 b_str_i = 0;
+	u64 value = VAL(u64, &STACK[sp + 8]);
 	
-	u64 a_i = 0;
-	u64 b_i = 0;
-	
-	u64 min_count = (num_a_strings < num_b_strings) ? num_a_strings : num_b_strings;
-	
-	while (1)
+	if (STACK[sp] == ACTION_STACK_VALUE_STR_LIST)
 	{
-		char c_a = a_list[a_str_i + 1][a_i];
-		char c_b = b_list[b_str_i + 1][b_i];
-		
-		if (c_a == 0)
-		{
-			if (a_str_i + 1 != min_count)
-			{
-				a_str_i += 1;
-				a_i = 0;
-				continue;
-			}
-			
-			else
-			{
-				return c_a - c_b;
-			}
-		}
-		
-		if (c_b == 0)
-		{
-			if (b_str_i + 1 != min_count)
-			{
-				b_str_i += 1;
-				b_i = 0;
-				continue;
-			}
-			
-			else
-			{
-				return c_a - c_b;
-			}
-		}
-		
-		if (c_a != c_b)
-		{
-			return c_a - c_b;
-		}
+		u64 hash_word = ((u64*) value)[-1];
+		*hash = (u32) hash_word;
 		
-		a_i += 1;
-		b_i += 1;
+		return (hash_word & STRING_HASH_KNOWN) != 0;
 	}
 	
-	EXC("um how lol\n");
-	return 0;
-}
-
-int strcmp_list_a_not_b(u64 a_value, u64 b_value)
-{
-	char** a_list = (char**) a_value;
-	char* b_str = (char*) b_value;
+	u32 string_id = VAL(u32, &STACK[sp]) >> 8;
 	
-	u64 num_a_strings = (u64) a_list[0];
-	
-	u64 a_str_i = 0;
-	
-	u64 a_i = 0;
-	u64 b_i = 0;
-	
-	while (1)
+	if (STACK[sp] == ACTION_STACK_VALUE_STRING && string_id != 0)
 	{
-		char c_a = a_list[a_str_i + 1][a_i];
-		char c_b = b_str[b_i];
-		
-		if (c_a == 0)
-		{
-			if (a_str_i + 1 != num_a_strings)
-			{
-				a_str_i += 1;
-				a_i = 0;
-				continue;
-			}
-			
-			else
-			{
-				return c_a - c_b;
-			}
-		}
+		*hash = getStringIdHash(app_context, (char*) value, VAL(u32, &STACK[sp + 4]), string_id);
 		
-		if (c_a != c_b)
-		{
-			return c_a - c_b;
-		}
-		
-		a_i += 1;
-		b_i += 1;
+		return 1;
 	}
 	
-	EXC("um how lol\n");
 	return 0;
 }
 
-int strcmp_not_a_list_b(u64 a_value, u64 b_value)
+// Plain strings are compared as a string list with a single segment
+static const u64* stringSegments(ActionVar* v, u64 single[2], u64* num_segments)
 {
-	char* a_str = (char*) a_value;
-	char** b_list = (char**) b_value;
-	
-	u64 num_b_strings = (u64) b_list[0];
-	
-	u64 b_str_i = 0;
-	
-	u64 a_i = 0;
-	u64 b_i = 0;
-	
-	while (1)
+	if (v->type == ACTION_STACK_VALUE_STR_LIST)
 	{
-		char c_a = a_str[a_i];
-		char c_b = b_list[b_str_i + 1][b_i];
+		u64* str_list = (u64*) v->value;
+		*num_segments = str_list[0];
 		
-		if (c_b == 0)
-		{
-			if (b_str_i + 1 != num_b_strings)
-			{
-				b_str_i += 1;
-				b_i = 0;
-				continue;
-			}
-			
-			else
-			{
-				return c_a - c_b;
-			}
-		}
-		
-		if (c_a != c_b)
-		{
-			return c_a - c_b;
-		}
-		
-		a_i += 1;
-		b_i += 1;
+		return str_list + 1;
 	}
 	
-	EXC("um how lol\n");
-	return 0;
+	single[0] = v->value;
+	single[1] = v->str_size;
+	*num_segments = 1;
+	
+	return single;
 }
 
 void actionStringEquals(SWFAppContext* app_context, char* a_str, char* b_str)
 {
+	PROFILE_OP(ACTION_OP_STRING_EQUALS);
+	
 	ActionVar a;
 	convertString(app_context, a_str);
-	popVar(app_context, &a);
+	peekVar(app_context, &a);
 	
 	ActionVar b;
-	convertString(app_context, b_str);
-	popVar(app_context, &b);
+	convertSlotToString(app_context, SP_SECOND_TOP, b_str);
+	peekSecondVar(app_context, &b);
 	
-	int cmp_result;
+	u32 a_id = STACK_TOP_ID;
+	u32 b_id = STACK_SECOND_TOP_ID;
+	u32 a_hash;
+	u32 b_hash;
+	int equal;
 	
-	int a_is_list = a.type == ACTION_STACK_VALUE_STR_LIST;
-	int b_is_list = b.type == ACTION_STACK_VALUE_STR_LIST;
-	
-	if (a_is_list && b_is_list)
+	// Matching ids settle it without reading either string, and so do
+	// differing lengths or known hashes
+	if (a_id != 0 && a_id == b_id)
 	{
-		cmp_result = strcmp_list_a_list_b(a.value, b.value);
+		equal = 1;
 	}
 	
-	else if (a_is_list && !b_is_list)
+	else if (a.str_size != b.str_size)
 	{
-		cmp_result = strcmp_list_a_not_b(a.value, b.value);
+		equal = 0;
 	}
 	
-	else if (!a_is_list && b_is_list)
+	else if (slotStringHash(app_context, SP, &a_hash) &&
+	         slotStringHash(app_context, SP_SECOND_TOP, &b_hash) &&
+	         a_hash != b_hash)
 	{
-		cmp_result = strcmp_not_a_list_b(a.value, b.value);
+		equal = 0;
 	}
 	
 	else
 	{
-		cmp_result = strcmp((char*) a.value, (char*) b.value);
+		u64 a_single[2];
+		u64 num_a_segments;
+		const u64* a_segments = stringSegments(&a, a_single, &num_a_segments);
+		
+		u64 b_single[2];
+		u64 num_b_segments;
+		const u64* b_segments = stringSegments(&b, b_single, &num_b_segments);
+		
+		equal = equalStringSegments(a_segments, num_a_segments, a.str_size, b_segments, num_b_segments, b.str_size);
 	}
 	
-	float result = cmp_result == 0 ? 1.0f : 0.0f;
+	POP_2();
+	
+	float result = equal ? 1.0f : 0.0f;
 	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &result));
 }
 
 void actionStringLength(SWFAppContext* app_context, char* v_str)
 {
+	PROFILE_OP(ACTION_OP_STRING_LENGTH);
+	
 	ActionVar v;
 	convertString(app_context, v_str);
 	popVar(app_context, &v);
@@ -643,77 +704,116 @@ void actionStringLength(SWFAppContext* app_context, char* v_str)
 	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &str_size));
 }
 
+void reclaimStrLists(SWFAppContext* app_context)
+{
+	u64* arena = app_context->str_list_arena;
+	
+	while (app_context->str_list_top != 0)
+	{
+		u32 last = app_context->str_list_last;
+		u32 owner_sp = (u32) arena[last + 1];
+		
+		if (owner_sp >= SP &&
+		    STACK[owner_sp] == ACTION_STACK_VALUE_STR_LIST &&
+		    VAL(u64*, &STACK[owner_sp + 8]) == &arena[last + STR_LIST_HEADER_SIZE])
+		{
+			break;
+		}
+		
+		app_context->str_list_top = last;
+		app_context->str_list_last = (u32) arena[last];
+	}
+}
+
 void actionStringAdd(SWFAppContext* app_context, char* a_str, char* b_str)
 {
+	PROFILE_OP(ACTION_OP_STRING_ADD);
+	
 	ActionVar a;
 	convertString(app_context, a_str);
 	peekVar(app_context, &a);
 	
 	ActionVar b;
-	convertString(app_context, b_str);
+	convertSlotToString(app_context, SP_SECOND_TOP, b_str);
 	peekSecondVar(app_context, &b);
 	
-	u64 num_a_strings;
-	u64 num_b_strings;
-	u64 num_strings = 0;
+	// Hash the result now if both halves are cheap to hash
+	u32 a_hash;
+	u32 b_hash;
+	int a_hash_known = slotStringHash(app_context, SP, &a_hash);
+	int b_hash_known = slotStringHash(app_context, SP_SECOND_TOP, &b_hash);
 	
-	if (b.type == ACTION_STACK_VALUE_STR_LIST)
+	if (!a_hash_known && a.type == ACTION_STACK_VALUE_STRING && a.str_size <= EAGER_HASH_MAX_LENGTH)
 	{
-		num_b_strings = *((u64*) b.value);
+		u64 segment[2] = { a.value, a.str_size };
+		a_hash = hashStringSegments(segment, 1);
+		a_hash_known = 1;
 	}
 	
-	else
+	if (!b_hash_known && b.type == ACTION_STACK_VALUE_STRING && b.str_size <= EAGER_HASH_MAX_LENGTH)
 	{
-		num_b_strings = 1;
+		u64 segment[2] = { b.value, b.str_size };
+		b_hash = hashStringSegments(segment, 1);
+		b_hash_known = 1;
 	}
 	
-	num_strings += num_b_strings;
+	u64 hash_word = 0;
 	
-	if (a.type == ACTION_STACK_VALUE_STR_LIST)
+	if (a_hash_known && b_hash_known)
 	{
-		num_a_strings = *((u64*) a.value);
+		hash_word = STRING_HASH_KNOWN | combineStringHashes(b_hash, a_hash, a.str_size);
 	}
 	
-	else
-	{
-		num_a_strings = 1;
-	}
+	reclaimStrLists(app_context);
 	
-	num_strings += num_a_strings;
+	u64* arena = app_context->str_list_arena;
 	
-	PUSH_STR_LIST(b.str_size + a.str_size, (u32) sizeof(u64)*(2*num_strings + 1));
+	int a_is_list = a.type == ACTION_STACK_VALUE_STR_LIST;
+	int b_is_list = b.type == ACTION_STACK_VALUE_STR_LIST;
 	
-	u64* str_list = (u64*) &STACK_TOP_VALUE;
-	str_list[0] = num_strings;
+	u64 num_a_strings = a_is_list ? *((u64*) a.value) : 1;
+	u64 num_b_strings = b_is_list ? *((u64*) b.value) : 1;
+	u64 num_strings = num_b_strings + num_a_strings;
+	
+	// Both operand lists die with this op, so if they sit on top of
+	// the arena the result is built over them instead of above them.
+	// This keeps long concat chains linear in arena space.
+	u32 base = app_context->str_list_top;
+	u32 prev_last = app_context->str_list_last;
 	
-	if (b.type == ACTION_STACK_VALUE_STR_LIST)
+	if (a_is_list && a.value != b.value &&
+	    (u64*) a.value - STR_LIST_HEADER_SIZE == &arena[prev_last])
 	{
-		u64* b_list = (u64*) b.value;
+		base = prev_last;
+		prev_last = (u32) arena[base];
 		
-		for (u64 i = 0; i < num_b_strings; ++i)
+		if (b_is_list && (u64*) b.value - STR_LIST_HEADER_SIZE == &arena[prev_last])
 		{
-			u64 str_i = 2*i;
-			str_list[str_i + 1] = b_list[str_i + 1];
-			str_list[str_i + 2] = b_list[str_i + 2];
+			base = prev_last;
+			prev_last = (u32) arena[base];
 		}
 	}
 	
-	else
+	else if (b_is_list && (u64*) b.value - STR_LIST_HEADER_SIZE == &arena[prev_last])
 	{
-		str_list[1] = b.value;
-		str_list[2] = b.str_size;
+		base = prev_last;
+		prev_last = (u32) arena[base];
 	}
 	
-	if (a.type == ACTION_STACK_VALUE_STR_LIST)
+	u64 top = base + STR_LIST_HEADER_SIZE + 1 + 2*num_strings;
+	
+	if (top > STR_LIST_ARENA_SIZE/sizeof(u64))
 	{
-		u64* a_list = (u64*) a.value;
-		
-		for (u64 i = 0; i < num_a_strings; ++i)
-		{
-			u64 str_i = 2*i;
-			str_list[str_i + 1 + 2*num_b_strings] = a_list[str_i + 1];
-			str_list[str_i + 2 + 2*num_b_strings] = a_list[str_i + 2];
-		}
+		EXC("String list arena overflow\n");
+	}
+	
+	u64* str_list = &arena[base + STR_LIST_HEADER_SIZE];
+	
+	// a's segments are placed first since the result may overlap
+	// them, b's segments can then only ever move down onto themselves
+	if (a_is_list)
+	{
+		memmove(&str_list[1 + 2*num_b_strings], (u64*) a.value + 1, 2*num_a_strings*sizeof(u64));
 	}
 	
 	else
@@ -721,78 +821,129 @@ void actionStringAdd(SWFAppContext* app_context, char* a_str, char* b_str)
 		str_list[1 + 2*num_b_strings] = a.value;
 		str_list[1 + 2*num_b_strings + 1] = a.str_size;
 	}
+	
+	if (b_is_list)
+	{
+		memmove(&str_list[1], (u64*) b.value + 1, 2*num_b_strings*sizeof(u64));
+	}
+	
+	else
+	{
+		str_list[1] = b.value;
+		str_list[2] = b.str_size;
+	}
+	
+	str_list[0] = num_strings;
+	
+	POP_2();
+	PUSH_STR_LIST(b.str_size + a.str_size, str_list);
+	
+	arena[base] = prev_last;
+	arena[base + 1] = SP;
+	arena[base + 2] = hash_word;
+	
+	app_context->str_list_last = base;
+	app_context->str_list_top = (u32) top;
 }
 
 void actionTrace(SWFAppContext* app_context)
 {
+	PROFILE_OP(ACTION_OP_TRACE);
+	
 	ActionStackValueType type = STACK_TOP_TYPE;
 	
+	if (traceSinkCountsOnly(app_context))
+	{
+		traceSinkEndLine(app_context);
+		POP();
+		
+		return;
+	}
+	
 	switch (type)
 	{
 		case ACTION_STACK_VALUE_STRING:
 		{
-			printf("%s\n", (char*) STACK_TOP_VALUE);
+			traceSinkWrite(app_context, (char*) STACK_TOP_VALUE, STACK_TOP_N);
 			break;
 		}
 		
 		case ACTION_STACK_VALUE_STR_LIST:
 		{
-			u64* str_list = (u64*) &STACK_TOP_VALUE;
+			u64* str_list = (u64*) STACK_TOP_VALUE;
 			
 			for (u64 i = 0; i < 2*str_list[0]; i += 2)
 			{
-				printf("%s", (char*) str_list[i + 1]);
+				traceSinkWrite(app_context, (char*) str_list[i + 1], str_list[i + 2]);
 			}
 			
-			printf("\n");
-			
 			break;
 		}
 		
 		case ACTION_STACK_VALUE_F32:
-		{
-			printf("%.15g\n", VAL(float, &STACK_TOP_VALUE));
-			break;
-		}
-		
 		case ACTION_STACK_VALUE_F64:
 		{
-			printf("%.15g\n", VAL(double, &STACK_TOP_VALUE));
+			char str[NUMBER_STRING_MAX_SIZE + 1];
+			u32 length = numberToString(numberToF64(type, STACK_TOP_VALUE), str);
+			
+			traceSinkWrite(app_context, str, length);
 			break;
 		}
 	}
 	
-	fflush(stdout);
+	traceSinkEndLine(app_context);
 	
 	POP();
 }
 
-void actionGetVariable(SWFAppContext* app_context)
+// Constant names use their string id directly. Names built at runtime,
+// string lists and numbers are interned, which gives them an id as well.
+static ActionVar* getVariableByName(SWFAppContext* app_context, u32 sp)
 {
-	// Read variable name info from stack
-	u32 string_id = STACK_TOP_ID;
-	char* var_name = (char*) STACK_TOP_VALUE;
-	u32 var_name_len = STACK_TOP_N;
+	ActionVar name;
+	name.type = STACK[sp];
+	name.str_size = VAL(u32, &STACK[sp + 4]);
+	name.value = VAL(u64, &STACK[sp + 8]);
 	
-	// Pop variable name
-	POP();
+	u32 string_id = VAL(u32, &STACK[sp]) >> 8;
+	
+	if (name.type == ACTION_STACK_VALUE_STRING && string_id != 0)
+	{
+		return getVariableById(app_context, string_id);
+	}
 	
-	// Get variable (fast path for constant strings)
-	ActionVar* var = NULL;
+	u32 hash;
+	int hash_known = slotStringHash(app_context, sp, &hash);
 	
-	if (string_id != 0)
+	char str[NUMBER_STRING_MAX_SIZE];
+	
+	if (name.type == ACTION_STACK_VALUE_F32 || name.type == ACTION_STACK_VALUE_F64)
 	{
-		// Constant string - use array (O(1))
-		var = getVariableById(app_context, string_id);
+		name.str_size = numberToString(numberToF64(name.type, name.value), str);
+		name.type = ACTION_STACK_VALUE_STRING;
+		name.value = (u64) str;
 	}
 	
-	else
+	u64 single[2];
+	u64 num_segments;
+	const u64* segments = stringSegments(&name, single, &num_segments);
+	
+	if (!hash_known)
 	{
-		// Dynamic string - use hashmap (O(n))
-		var = getVariable(app_context, var_name, var_name_len);
+		hash = hashStringSegments(segments, num_segments);
 	}
 	
-	assert(var != NULL);
+	return getVariableBySegments(app_context, segments, num_segments, name.str_size, hash);
+}
+
+void actionGetVariable(SWFAppContext* app_context)
+{
+	PROFILE_OP(ACTION_OP_GET_VARIABLE);
+	
+	ActionVar* var = getVariableByName(app_context, SP);
+	
+	// Pop variable name
+	POP();
 	
 	// Push variable value to stack
 	PUSH_VAR(var);
@@ -800,41 +951,45 @@ void actionGetVariable(SWFAppContext* app_context)
 
 void actionSetVariable(SWFAppContext* app_context)
 {
+	PROFILE_OP(ACTION_OP_SET_VARIABLE);
+	
 	// Stack layout: [value] [name] <- sp
 	// We need value at top, name at second
+	ActionVar* var = getVariableByName(app_context, SP_SECOND_TOP);
 	
-	// Read variable name info
-	u32 string_id = STACK_SECOND_TOP_ID;
-	char* var_name = (char*) STACK_SECOND_TOP_VALUE;
-	u32 var_name_len = STACK_SECOND_TOP_N;
+	// Set variable value (uses existing string materialization!)
+	setVariableWithValue(app_context, var);
 	
-	// Get variable (fast path for constant strings)
-	ActionVar* var = NULL;
+	// Pop both value and name
+	POP_2();
+}
+
+void actionGetVariableById(SWFAppContext* app_context, u32 string_id)
+{
+	PROFILE_OP(ACTION_OP_GET_VARIABLE);
 	
-	if (string_id != 0)
-	{
-		// Constant string - use array (O(1))
-		var = getVariableById(app_context, string_id);
-	}
+	ActionVar* var = getVariableById(app_context, string_id);
 	
-	else
-	{
-		// Dynamic string - use hashmap (O(n))
-		var = getVariable(app_context, var_name, var_name_len);
-	}
+	PUSH_VAR(var);
+}
+
+void actionSetVariableById(SWFAppContext* app_context, u32 string_id)
+{
+	PROFILE_OP(ACTION_OP_SET_VARIABLE);
 	
-	assert(var != NULL);
+	// Stack layout: [value] <- sp, the name is known statically
+	ActionVar* var = getVariableById(app_context, string_id);
 	
-	// Set variable value (uses existing string materialization!)
 	setVariableWithValue(app_context, var);
 	
-	// Pop both value and name
-	POP_2();
+	POP();
 }
 
 void actionGetTime(SWFAppContext* app_context)
 {
-	u32 delta_ms = get_elapsed_ms() - start_time;
+	PROFILE_OP(ACTION_OP_GET_TIME);
+	
+	u32 delta_ms = frameClockGetTimer(app_context);
 	float delta_ms_f32 = (float) delta_ms;
 	
 	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &delta_ms_f32));
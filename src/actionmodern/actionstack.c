@@ -0,0 +1,239 @@
+#include <string.h>
+
+#include <actionstack.h>
+#include <action.h>
+#include <utils.h>
+
+#if defined(_MSC_VER)
+#include <io.h>
+#define THREAD_LOCAL __declspec(thread)
+#define writeStderr(buffer, length) _write(2, buffer, (unsigned int) (length))
+#else
+#include <unistd.h>
+#define THREAD_LOCAL __thread
+#define writeStderr(buffer, length) write(2, buffer, length)
+#endif
+
+static THREAD_LOCAL SWFAppContext* bound_context;
+
+// Runs inside the fault handler, where stdio isn't safe to call, so the
+// message is put together by hand and written straight to stderr
+
+static char* appendText(char* out, const char* text)
+{
+	while (*text != '\0')
+	{
+		*out++ = *text++;
+	}
+	
+	return out;
+}
+
+static char* appendNumber(char* out, size_t number)
+{
+	char digits[20];
+	int count = 0;
+	
+	do
+	{
+		digits[count++] = (char) ('0' + number%10);
+		number /= 10;
+	} while (number != 0);
+	
+	while (count > 0)
+	{
+		*out++ = digits[--count];
+	}
+	
+	return out;
+}
+
+static void reportOverflow(SWFAppContext* app_context)
+{
+	char message[128];
+	char* out = message;
+	
+	out = appendText(out, "Action stack overflow in frame_");
+	out = appendNumber(out, app_context->current_frame);
+	out = appendText(out, ", ");
+	out = appendNumber(out, (INITIAL_SP - SP)/STACK_SLOT_SIZE);
+	out = appendText(out, " values deep\n");
+	
+	writeStderr(message, out - message);
+}
+
+#if defined(_MSC_VER)
+// Microsoft
+
+#include <windows.h>
+
+// Committed below the lowest committed page when a push faults there
+#define STACK_COMMIT_CHUNK 65536
+
+static INIT_ONCE handler_once = INIT_ONCE_STATIC_INIT;
+
+static LONG WINAPI onAccessViolation(EXCEPTION_POINTERS* info)
+{
+	SWFAppContext* app_context = bound_context;
+	
+	if (info->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || app_context == NULL)
+	{
+		return EXCEPTION_CONTINUE_SEARCH;
+	}
+	
+	char* addr = (char*) info->ExceptionRecord->ExceptionInformation[1];
+	
+	if (addr < STACK || addr >= STACK + app_context->stack_commit_offset)
+	{
+		return EXCEPTION_CONTINUE_SEARCH;
+	}
+	
+	if (addr < STACK + ACTION_STACK_GUARD_SIZE)
+	{
+		reportOverflow(app_context);
+		return EXCEPTION_CONTINUE_SEARCH;
+	}
+	
+	size_t offset = (addr - STACK) & ~((size_t) STACK_COMMIT_CHUNK - 1);
+	VirtualAlloc(STACK + offset, app_context->stack_commit_offset - offset, MEM_COMMIT, PAGE_READWRITE);
+	app_context->stack_commit_offset = offset;
+	
+	return EXCEPTION_CONTINUE_EXECUTION;
+}
+
+static BOOL CALLBACK installHandler(PINIT_ONCE once, PVOID param, PVOID* ctx)
+{
+	AddVectoredExceptionHandler(1, onAccessViolation);
+	return TRUE;
+}
+
+int initActionStack(SWFAppContext* app_context)
+{
+	InitOnceExecuteOnce(&handler_once, installHandler, NULL, NULL);
+	
+	// Windows doesn't back reserved pages on touch, so the handler above
+	// commits them as pushes reach them
+	STACK = VirtualAlloc(NULL, INITIAL_STACK_SIZE, MEM_RESERVE, PAGE_NOACCESS);
+	
+	if (STACK == NULL)
+	{
+		return 0;
+	}
+	
+	app_context->stack_commit_offset = INITIAL_STACK_SIZE - STACK_COMMIT_CHUNK;
+	
+	if (VirtualAlloc(STACK + app_context->stack_commit_offset, STACK_COMMIT_CHUNK, MEM_COMMIT, PAGE_READWRITE) == NULL)
+	{
+		freeActionStack(app_context);
+		return 0;
+	}
+	
+	SP = INITIAL_SP;
+	
+	bindActionStack(app_context);
+	
+	return 1;
+}
+
+void freeActionStack(SWFAppContext* app_context)
+{
+	VirtualFree(STACK, 0, MEM_RELEASE);
+	STACK = NULL;
+}
+
+#else
+// POSIX
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+static pthread_once_t handler_once = PTHREAD_ONCE_INIT;
+static struct sigaction previous_segv;
+static struct sigaction previous_bus;
+
+static void onFault(int sig, siginfo_t* info, void* ucontext)
+{
+	SWFAppContext* app_context = bound_context;
+	char* addr = (char*) info->si_addr;
+	
+	if (app_context != NULL && STACK != NULL && addr >= STACK && addr < STACK + ACTION_STACK_GUARD_SIZE)
+	{
+		reportOverflow(app_context);
+	}
+	
+	// Faults that aren't ours go wherever they went before this handler
+	// was installed, and so does an overflow once it's been reported
+	struct sigaction* previous = (sig == SIGBUS) ? &previous_bus : &previous_segv;
+	
+	if (previous->sa_flags & SA_SIGINFO)
+	{
+		previous->sa_sigaction(sig, info, ucontext);
+		return;
+	}
+	
+	if (previous->sa_handler != SIG_DFL && previous->sa_handler != SIG_IGN)
+	{
+		previous->sa_handler(sig);
+		return;
+	}
+	
+	// The process is going down, so only this signal is put back to the
+	// default, and the faulting access crashes as usual when it runs again
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = SIG_DFL;
+	sigemptyset(&action.sa_mask);
+	sigaction(sig, &action, NULL);
+}
+
+static void installHandler()
+{
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = onFault;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	
+	sigaction(SIGSEGV, &action, &previous_segv);
+	sigaction(SIGBUS, &action, &previous_bus);
+}
+
+int initActionStack(SWFAppContext* app_context)
+{
+	pthread_once(&handler_once, installHandler);
+	
+	// Anonymous pages are only backed once touched
+	STACK = vmem_reserve(INITIAL_STACK_SIZE);
+	
+	if (STACK == NULL)
+	{
+		return 0;
+	}
+	
+	// Without the guard an overflow would run into whatever is mapped below
+	if (mprotect(STACK, ACTION_STACK_GUARD_SIZE, PROT_NONE) != 0)
+	{
+		freeActionStack(app_context);
+		return 0;
+	}
+	
+	SP = INITIAL_SP;
+	
+	bindActionStack(app_context);
+	
+	return 1;
+}
+
+void freeActionStack(SWFAppContext* app_context)
+{
+	vmem_release(STACK, INITIAL_STACK_SIZE);
+	STACK = NULL;
+}
+
+#endif
+
+void bindActionStack(SWFAppContext* app_context)
+{
+	bound_context = app_context;
+}
\ No newline at end of file
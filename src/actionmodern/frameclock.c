@@ -0,0 +1,73 @@
+#include <frameclock.h>
+#include <utils.h>
+
+#define CLOCK_RESAMPLE_READS 64
+
+// 24 fps, the default frame rate of a new movie
+#define DEFAULT_VIRTUAL_FRAME_US 41667
+
+void initFrameClock(SWFAppContext* app_context)
+{
+	if (app_context->virtual_frame_us == 0)
+	{
+		app_context->virtual_frame_us = DEFAULT_VIRTUAL_FRAME_US;
+	}
+	
+	app_context->clock_start_ns = app_context->virtual_time ? 0 : get_elapsed_ns();
+	app_context->frame_time_ns = 0;
+	app_context->clock_frames = 0;
+	app_context->clock_reads = 0;
+}
+
+void frameClockBeginFrame(SWFAppContext* app_context)
+{
+	// Virtual time moves on a frame from wherever the last one left it,
+	// so time added by extra reads isn't taken back and stays monotonic
+	if (app_context->virtual_time)
+	{
+		if (app_context->clock_frames != 0)
+		{
+			app_context->frame_time_ns += (u64) app_context->virtual_frame_us*1000;
+		}
+	}
+	
+	else
+	{
+		app_context->frame_time_ns = get_elapsed_ns() - app_context->clock_start_ns;
+	}
+	
+	app_context->clock_frames += 1;
+	app_context->clock_reads = 0;
+}
+
+u32 frameClockGetTimer(SWFAppContext* app_context)
+{
+	app_context->clock_reads += 1;
+	
+	if (app_context->clock_reads > CLOCK_RESAMPLE_READS)
+	{
+		// Virtual time can't sample anything, so each extra read moves it
+		// forward a millisecond, which is just as reproducible
+		if (app_context->virtual_time)
+		{
+			app_context->frame_time_ns += 1000000;
+		}
+		
+		else
+		{
+			app_context->frame_time_ns = get_elapsed_ns() - app_context->clock_start_ns;
+		}
+	}
+	
+	return (u32) (app_context->frame_time_ns/1000000);
+}
+
+u64 frameClockNowNs(SWFAppContext* app_context)
+{
+	if (app_context->virtual_time)
+	{
+		return app_context->frame_time_ns;
+	}
+	
+	return get_elapsed_ns() - app_context->clock_start_ns;
+}
\ No newline at end of file
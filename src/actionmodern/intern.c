@@ -0,0 +1,747 @@
+#include <string.h>
+
+#include <intern.h>
+#include <strcompare.h>
+#include <sharedstring.h>
+#include <heap.h>
+#include <utils.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INTERN_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define INTERN_NEON
+#endif
+
+#define INTERN_INITIAL_CAPACITY 256
+#define INTERN_BLOCK_SIZE 65536
+
+#define INTERN_SLAB_SHIFT 8
+#define INTERN_SLAB_SIZE (1 << INTERN_SLAB_SHIFT)
+
+// Old index slots moved over per operation while resizing, enough to
+// finish well before the new index fills up
+#define INTERN_MIGRATE_STEP 64
+
+#define HASH_MULTIPLIER 16777619u
+
+// The index is open addressing with SwissTable-style control bytes. A
+// slot's control byte is CTRL_EMPTY or the low 7 bits of its hash (H2),
+// and probing runs linearly from the home slot given by the rest of the
+// hash (H1), a group of 16 control bytes at a time. The control array
+// has GROUP_WIDTH extra bytes mirroring the first group, so a group can
+// be loaded at any slot without wrapping.
+#define GROUP_WIDTH 16
+#define CTRL_EMPTY 0x80
+
+#define H1(hash) (mixHash(hash) >> 7)
+#define H2(hash) ((u8) ((hash) & 0x7F))
+
+// capacity is the most chars the storage holds, terminator included, so
+// a reused entry can keep it for a name up to that long
+typedef struct
+{
+	u32 hash;
+	u32 length;
+	u32 capacity;
+	char chars[];
+} InternedString;
+
+// Entries live in slabs that never move, so ids and ActionVar pointers
+// stay valid when the index is resized. A removed entry is on the free
+// list, linked by next_free, and keeps its string's storage for reuse.
+typedef struct
+{
+	InternedString* string;
+	ActionVar var;
+	bool removed;
+	u32 next_free;
+} InternEntry;
+
+typedef struct
+{
+	u8* ctrl;
+	u32* entries;
+	u32 capacity;
+} InternIndex;
+
+struct InternTable
+{
+	InternIndex index;
+	u32 count;
+	
+	// While resizing, slots of the previous index below migrate_pos
+	// have been moved over, and lookups check both indexes
+	InternIndex old_index;
+	u32 migrate_pos;
+	
+	u32 first_id;
+	InternEntry** slabs;
+	u32 slabs_capacity;
+	u32 num_entries;
+	
+	// Entry index + 1 of the removed entry reused next, 0 if none
+	u32 free_head;
+	
+	// Hashes of constant strings by id, filled on first use
+	u64* constant_hashes;
+	
+	// Strings are packed into blocks that never move, each starting
+	// with a pointer to the previous block
+	char* block;
+	u32 block_used;
+	u32 block_size;
+};
+
+static inline u32 mixHash(u32 h)
+{
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	
+	return h;
+}
+
+// Group masks have a bit per matching slot, GROUP_MASK_SHIFT bits apart
+#ifdef INTERN_NEON
+#define GROUP_MASK_SHIFT 2
+
+static inline u64 groupMask(uint8x16_t matches)
+{
+	// Narrow each byte to a nibble so the mask fits in 64 bits
+	uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+	
+	return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull;
+}
+
+static inline u64 matchByte(const u8* ctrl, u8 byte)
+{
+	return groupMask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(byte)));
+}
+
+static inline u64 matchEmpty(const u8* ctrl)
+{
+	return matchByte(ctrl, CTRL_EMPTY);
+}
+#else
+#define GROUP_MASK_SHIFT 0
+
+static inline u64 matchByte(const u8* ctrl, u8 byte)
+{
+#ifdef INTERN_SSE2
+	__m128i group = _mm_loadu_si128((const __m128i*) ctrl);
+	
+	return (u64) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) byte)));
+#else
+	u64 mask = 0;
+	
+	for (u32 i = 0; i < GROUP_WIDTH; ++i)
+	{
+		mask |= (u64) (ctrl[i] == byte) << i;
+	}
+	
+	return mask;
+#endif
+}
+
+static inline u64 matchEmpty(const u8* ctrl)
+{
+#ifdef INTERN_SSE2
+	// Only empty slots have the high bit set
+	return (u64) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) ctrl));
+#else
+	return matchByte(ctrl, CTRL_EMPTY);
+#endif
+}
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+
+static inline u32 firstMatch(u64 mask)
+{
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	
+	return (u32) index >> GROUP_MASK_SHIFT;
+}
+#else
+#define firstMatch(mask) ((u32) __builtin_ctzll(mask) >> GROUP_MASK_SHIFT)
+#endif
+
+static inline InternEntry* getEntry(InternTable* table, u32 entry_index)
+{
+	return &table->slabs[entry_index >> INTERN_SLAB_SHIFT][entry_index & (INTERN_SLAB_SIZE - 1)];
+}
+
+static void allocateIndex(SWFAppContext* app_context, InternIndex* index, u32 capacity)
+{
+	index->capacity = capacity;
+	index->ctrl = (u8*) HALLOC(capacity + GROUP_WIDTH);
+	index->entries = (u32*) HALLOC(capacity*sizeof(u32));
+	memset(index->ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH);
+}
+
+static void freeIndex(SWFAppContext* app_context, InternIndex* index)
+{
+	FREE(index->ctrl);
+	FREE(index->entries);
+	
+	index->ctrl = NULL;
+	index->entries = NULL;
+	index->capacity = 0;
+}
+
+static inline void setCtrl(InternIndex* index, u32 slot, u8 ctrl)
+{
+	index->ctrl[slot] = ctrl;
+	
+	if (slot < GROUP_WIDTH)
+	{
+		index->ctrl[index->capacity + slot] = ctrl;
+	}
+}
+
+// Returns the slot holding the string, or -1 with the first empty slot
+// of its probe sequence in empty_slot
+static s64 findSlot(InternTable* table, InternIndex* index, const u64* segments, u64 num_segments, u32 length, u32 hash, u32* empty_slot)
+{
+	u32 mask = index->capacity - 1;
+	u32 pos = H1(hash) & mask;
+	u8 h2 = H2(hash);
+	
+	while (1)
+	{
+		const u8* group = &index->ctrl[pos];
+		u64 empty = matchEmpty(group);
+		u64 candidates = matchByte(group, h2);
+		
+		// The string can't be past the first empty slot
+		if (empty != 0)
+		{
+			candidates &= (empty & (0 - empty)) - 1;
+		}
+		
+		while (candidates != 0)
+		{
+			u32 slot = (pos + firstMatch(candidates)) & mask;
+			InternEntry* entry = getEntry(table, index->entries[slot]);
+			InternedString* interned = entry->string;
+			u64 interned_segment[2] = { (u64) interned->chars, interned->length };
+			
+			if (interned->hash == hash && interned->length == length &&
+			    compareStringSegments(interned_segment, 1, segments, num_segments) == 0)
+			{
+				return slot;
+			}
+			
+			candidates &= candidates - 1;
+		}
+		
+		if (empty != 0)
+		{
+			*empty_slot = (pos + firstMatch(empty)) & mask;
+			return -1;
+		}
+		
+		pos = (pos + GROUP_WIDTH) & mask;
+	}
+}
+
+static void insertIntoIndex(InternIndex* index, u32 slot, u32 entry_index, u32 hash)
+{
+	index->entries[slot] = entry_index;
+	setCtrl(index, slot, H2(hash));
+}
+
+static u32 findEmptySlot(InternIndex* index, u32 hash)
+{
+	u32 mask = index->capacity - 1;
+	u32 pos = H1(hash) & mask;
+	u64 empty;
+	
+	while ((empty = matchEmpty(&index->ctrl[pos])) == 0)
+	{
+		pos = (pos + GROUP_WIDTH) & mask;
+	}
+	
+	return (pos + firstMatch(empty)) & mask;
+}
+
+// Empties a slot without a tombstone, by moving later entries of the
+// probe run back into the gap wherever their home slot allows
+static void removeFromIndex(InternTable* table, InternIndex* index, u32 slot)
+{
+	u32 mask = index->capacity - 1;
+	u32 hole = slot;
+	
+	for (u32 i = (slot + 1) & mask; index->ctrl[i] != CTRL_EMPTY; i = (i + 1) & mask)
+	{
+		u32 home = H1(getEntry(table, index->entries[i])->string->hash) & mask;
+		
+		// Entries whose home slot is cyclically after the hole stay put
+		if (((i - home) & mask) >= ((i - hole) & mask))
+		{
+			index->entries[hole] = index->entries[i];
+			setCtrl(index, hole, index->ctrl[i]);
+			hole = i;
+		}
+	}
+	
+	setCtrl(index, hole, CTRL_EMPTY);
+}
+
+static void migrateIndex(SWFAppContext* app_context, InternTable* table, u32 num_slots)
+{
+	InternIndex* old_index = &table->old_index;
+	
+	if (old_index->ctrl == NULL)
+	{
+		return;
+	}
+	
+	u32 end = table->migrate_pos + num_slots;
+	
+	if (end > old_index->capacity)
+	{
+		end = old_index->capacity;
+	}
+	
+	for (u32 i = table->migrate_pos; i < end; ++i)
+	{
+		if (old_index->ctrl[i] == CTRL_EMPTY)
+		{
+			continue;
+		}
+		
+		u32 entry_index = old_index->entries[i];
+		u32 hash = getEntry(table, entry_index)->string->hash;
+		
+		insertIntoIndex(&table->index, findEmptySlot(&table->index, hash), entry_index, hash);
+	}
+	
+	table->migrate_pos = end;
+	
+	if (end == old_index->capacity)
+	{
+		freeIndex(app_context, old_index);
+	}
+}
+
+// Returns the entry index of the string, or -1 with the slot to insert
+// it at in empty_slot
+static s64 findEntry(InternTable* table, const u64* segments, u64 num_segments, u32 length, u32 hash, u32* empty_slot)
+{
+	s64 slot = findSlot(table, &table->index, segments, num_segments, length, hash, empty_slot);
+	
+	if (slot >= 0)
+	{
+		return table->index.entries[slot];
+	}
+	
+	// Not migrated yet, or already migrated and the old slot not freed
+	if (table->old_index.ctrl != NULL)
+	{
+		u32 unused;
+		slot = findSlot(table, &table->old_index, segments, num_segments, length, hash, &unused);
+		
+		if (slot >= 0)
+		{
+			return table->old_index.entries[slot];
+		}
+	}
+	
+	return -1;
+}
+
+// Doubles the index, leaving the entries to be moved over a few slots
+// per operation instead of all at once
+static void startResize(SWFAppContext* app_context, InternTable* table)
+{
+	// Only one resize runs at a time. The previous one is normally long
+	// done by now, since migration outpaces the growth that triggers one.
+	migrateIndex(app_context, table, table->old_index.capacity);
+	
+	table->old_index = table->index;
+	table->migrate_pos = 0;
+	
+	allocateIndex(app_context, &table->index, 2*table->old_index.capacity);
+}
+
+void initInternTable(SWFAppContext* app_context)
+{
+	InternTable* table = (InternTable*) HALLOC(sizeof(InternTable));
+	memset(table, 0, sizeof(InternTable));
+	
+	allocateIndex(app_context, &table->index, INTERN_INITIAL_CAPACITY);
+	
+	table->first_id = (u32) app_context->max_string_id + 1;
+	
+	table->constant_hashes = (u64*) HALLOC(table->first_id*sizeof(u64));
+	memset(table->constant_hashes, 0, table->first_id*sizeof(u64));
+	
+	app_context->intern_table = table;
+}
+
+void freeInternTable(SWFAppContext* app_context)
+{
+	InternTable* table = app_context->intern_table;
+	
+	if (table == NULL)
+	{
+		return;
+	}
+	
+	for (u32 i = 0; i < table->num_entries; ++i)
+	{
+		ActionVar* var = &getEntry(table, i)->var;
+		
+		if (var->type == ACTION_STACK_VALUE_STRING && var->owns_memory)
+		{
+			releaseSharedString(app_context, var->heap_ptr);
+		}
+	}
+	
+	for (u32 i = 0; i < table->num_entries; i += INTERN_SLAB_SIZE)
+	{
+		vmem_release((char*) table->slabs[i >> INTERN_SLAB_SHIFT], INTERN_SLAB_SIZE*sizeof(InternEntry));
+	}
+	
+	char* block = table->block;
+	
+	while (block != NULL)
+	{
+		char* prev = *((char**) block);
+		FREE(block);
+		block = prev;
+	}
+	
+	if (table->old_index.ctrl != NULL)
+	{
+		freeIndex(app_context, &table->old_index);
+	}
+	
+	if (table->slabs != NULL)
+	{
+		FREE(table->slabs);
+	}
+	
+	freeIndex(app_context, &table->index);
+	FREE(table->constant_hashes);
+	FREE(table);
+	
+	app_context->intern_table = NULL;
+}
+
+u32 hashStringSegments(const u64* segments, u64 num_segments)
+{
+	u32 h = 0;
+	
+	for (u64 i = 0; i < 2*num_segments; i += 2)
+	{
+		const u8* str = (const u8*) segments[i];
+		u64 length = segments[i + 1];
+		
+		for (u64 j = 0; j < length; ++j)
+		{
+			h = h*HASH_MULTIPLIER + str[j];
+		}
+	}
+	
+	return h;
+}
+
+u32 combineStringHashes(u32 left_hash, u32 right_hash, u32 right_length)
+{
+	// left_hash*HASH_MULTIPLIER^right_length, by repeated squaring
+	u32 power = HASH_MULTIPLIER;
+	
+	for (u32 e = right_length; e != 0; e >>= 1)
+	{
+		if (e & 1)
+		{
+			left_hash *= power;
+		}
+		
+		power *= power;
+	}
+	
+	return left_hash + right_hash;
+}
+
+u32 getStringIdHash(SWFAppContext* app_context, const char* str, u32 length, u32 string_id)
+{
+	InternTable* table = app_context->intern_table;
+	
+	if (string_id >= table->first_id)
+	{
+		return getEntry(table, string_id - table->first_id)->string->hash;
+	}
+	
+	u64* entry = &table->constant_hashes[string_id];
+	
+	if (*entry == 0)
+	{
+		u64 segment[2] = { (u64) str, length };
+		*entry = STRING_HASH_KNOWN | hashStringSegments(segment, 1);
+	}
+	
+	return (u32) *entry;
+}
+
+static char* allocateString(SWFAppContext* app_context, InternTable* table, u32 size)
+{
+	// Keep every string 8-byte aligned
+	size = (size + 7) & ~7u;
+	
+	if (table->block == NULL || table->block_used + size > table->block_size)
+	{
+		u32 block_size = sizeof(char*) + size > INTERN_BLOCK_SIZE ? sizeof(char*) + size : INTERN_BLOCK_SIZE;
+		char* block = (char*) HALLOC(block_size);
+		
+		*((char**) block) = table->block;
+		table->block = block;
+		table->block_used = sizeof(char*);
+		table->block_size = block_size;
+	}
+	
+	char* str = table->block + table->block_used;
+	table->block_used += size;
+	
+	return str;
+}
+
+static u32 allocateEntry(SWFAppContext* app_context, InternTable* table)
+{
+	u32 entry_index = table->num_entries;
+	u32 slab = entry_index >> INTERN_SLAB_SHIFT;
+	
+	if ((entry_index & (INTERN_SLAB_SIZE - 1)) == 0)
+	{
+		if (slab == table->slabs_capacity)
+		{
+			u32 capacity = table->slabs_capacity == 0 ? 16 : 2*table->slabs_capacity;
+			InternEntry** slabs = (InternEntry**) HALLOC(capacity*sizeof(InternEntry*));
+			
+			if (table->slabs != NULL)
+			{
+				memcpy(slabs, table->slabs, table->slabs_capacity*sizeof(InternEntry*));
+				FREE(table->slabs);
+			}
+			
+			table->slabs = slabs;
+			table->slabs_capacity = capacity;
+		}
+		
+		// Mapped outside the heap, since the stack can point at inline
+		// strings in variables and isSharedString goes by address
+		table->slabs[slab] = (InternEntry*) vmem_reserve(INTERN_SLAB_SIZE*sizeof(InternEntry));
+		
+		if (table->slabs[slab] == NULL)
+		{
+			EXC("Out of memory for interned strings\n");
+		}
+	}
+	
+	table->num_entries += 1;
+	
+	return entry_index;
+}
+
+u32 internStringSegments(SWFAppContext* app_context, const u64* segments, u64 num_segments, u32 length, u32 hash)
+{
+	InternTable* table = app_context->intern_table;
+	
+	migrateIndex(app_context, table, INTERN_MIGRATE_STEP);
+	
+	u32 slot;
+	s64 found = findEntry(table, segments, num_segments, length, hash, &slot);
+	
+	if (found >= 0)
+	{
+		return table->first_id + (u32) found;
+	}
+	
+	// New string, reusing a removed entry and its id if there is one
+	u32 entry_index;
+	InternedString* interned = NULL;
+	
+	if (table->free_head != 0)
+	{
+		entry_index = table->free_head - 1;
+		
+		InternEntry* entry = getEntry(table, entry_index);
+		table->free_head = entry->next_free;
+		entry->removed = false;
+		
+		if (entry->string != NULL && length + 1 <= entry->string->capacity)
+		{
+			interned = entry->string;
+		}
+	}
+	
+	else
+	{
+		entry_index = allocateEntry(app_context, table);
+	}
+	
+	// Copy it into owned storage. A name too long for a reused entry's
+	// storage leaves that behind in its block, but every entry's storage
+	// only ever grows, so this is bounded by the longest name per entry.
+	if (interned == NULL)
+	{
+		u32 size = (sizeof(InternedString) + length + 1 + 7) & ~7u;
+		interned = (InternedString*) allocateString(app_context, table, size);
+		interned->capacity = size - sizeof(InternedString);
+	}
+	
+	interned->hash = hash;
+	interned->length = length;
+	
+	char* dest = interned->chars;
+	for (u64 j = 0; j < 2*num_segments; j += 2)
+	{
+		memcpy(dest, (const char*) segments[j], segments[j + 1]);
+		dest += segments[j + 1];
+	}
+	*dest = '\0';
+	
+	getEntry(table, entry_index)->string = interned;
+	
+	insertIntoIndex(&table->index, slot, entry_index, hash);
+	table->count += 1;
+	
+	// Keep at least one empty slot per group on average
+	if (8*table->count > 7*table->index.capacity)
+	{
+		startResize(app_context, table);
+	}
+	
+	return table->first_id + entry_index;
+}
+
+u32 internString(SWFAppContext* app_context, const char* str, u32 length)
+{
+	u64 segment[2] = { (u64) str, length };
+	
+	return internStringSegments(app_context, segment, 1, length, hashStringSegments(segment, 1));
+}
+
+ActionVar* getInternedVariable(SWFAppContext* app_context, u32 string_id)
+{
+	InternTable* table = app_context->intern_table;
+	
+	return &getEntry(table, string_id - table->first_id)->var;
+}
+
+static void pushFreeEntry(InternTable* table, u32 entry_index)
+{
+	InternEntry* entry = getEntry(table, entry_index);
+	entry->removed = true;
+	entry->next_free = table->free_head;
+	
+	table->free_head = entry_index + 1;
+}
+
+ActionVar* removeInternedString(SWFAppContext* app_context, const u64* segments, u64 num_segments, u32 length, u32 hash)
+{
+	InternTable* table = app_context->intern_table;
+	
+	// The entry can be reused by the next string interned, so no copy of
+	// it may be left in the old index. Finishing a resize here costs one
+	// pass over the old index, at most once per resize.
+	migrateIndex(app_context, table, table->old_index.capacity);
+	
+	u32 unused;
+	s64 slot = findSlot(table, &table->index, segments, num_segments, length, hash, &unused);
+	
+	if (slot < 0)
+	{
+		return NULL;
+	}
+	
+	u32 entry_index = table->index.entries[slot];
+	
+	removeFromIndex(table, &table->index, (u32) slot);
+	table->count -= 1;
+	
+	pushFreeEntry(table, entry_index);
+	
+	return &getEntry(table, entry_index)->var;
+}
+
+u32 internedStringCount(SWFAppContext* app_context)
+{
+	return app_context->intern_table->num_entries;
+}
+
+const char* getInternedString(SWFAppContext* app_context, u32 string_id, u32* length)
+{
+	InternTable* table = app_context->intern_table;
+	InternEntry* entry = getEntry(table, string_id - table->first_id);
+	
+	if (entry->removed)
+	{
+		*length = 0;
+		return NULL;
+	}
+	
+	*length = entry->string->length;
+	
+	return entry->string->chars;
+}
+
+u32 nextFreeInternedId(SWFAppContext* app_context, u32 string_id)
+{
+	InternTable* table = app_context->intern_table;
+	u32 next = string_id == 0 ? table->free_head : getEntry(table, string_id - table->first_id)->next_free;
+	
+	return next == 0 ? 0 : table->first_id + next - 1;
+}
+
+u32 reserveInternedId(SWFAppContext* app_context)
+{
+	InternTable* table = app_context->intern_table;
+	u32 entry_index = allocateEntry(app_context, table);
+	
+	getEntry(table, entry_index)->removed = true;
+	
+	return table->first_id + entry_index;
+}
+
+void freeInternedId(SWFAppContext* app_context, u32 string_id)
+{
+	InternTable* table = app_context->intern_table;
+	
+	pushFreeEntry(table, string_id - table->first_id);
+}
+
+u32 findInternedVariable(SWFAppContext* app_context, const char* ptr)
+{
+	InternTable* table = app_context->intern_table;
+	
+	for (u32 i = 0; i < table->num_entries; i += INTERN_SLAB_SIZE)
+	{
+		const char* slab = (const char*) table->slabs[i >> INTERN_SLAB_SHIFT];
+		
+		if (ptr < slab || ptr >= slab + INTERN_SLAB_SIZE*sizeof(InternEntry))
+		{
+			continue;
+		}
+		
+		u32 entry_index = i + (u32) ((ptr - slab)/sizeof(InternEntry));
+		const char* var = (const char*) &getEntry(table, entry_index)->var;
+		
+		if (entry_index < table->num_entries && ptr >= var && ptr < var + sizeof(ActionVar))
+		{
+			return table->first_id + entry_index;
+		}
+		
+		return 0;
+	}
+	
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,796 @@
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <number.h>
+#include <heap.h>
+
+// Flash formats every Number with this many significant digits
+#define FLASH_PRECISION 15
+
+// Digits are generated with Grisu in counted mode (Loitsch, "Printing
+// Floating-Point Numbers Quickly and Accurately with Integers", 2010),
+// following double-conversion's FastDtoa. It yields the correctly rounded
+// leading digits for all but about 0.5% of doubles and detects the ones
+// it can't guarantee, which then go through snprintf instead.
+
+typedef struct
+{
+	u64 f;
+	int e;
+} DiyFp;
+
+typedef struct
+{
+	u64 significand;
+	s16 binary_exponent;
+	s16 decimal_exponent;
+} CachedPower;
+
+#define CACHED_POWERS_OFFSET 348
+#define CACHED_POWERS_DECIMAL_DISTANCE 8
+
+#define MIN_TARGET_EXPONENT -60
+
+// Normalized 10^k for k = -348, -340, ..., 340
+static const CachedPower cached_powers[] =
+{
+	{ 0xFA8FD5A0081C0288ULL, -1220, -348 },
+	{ 0xBAAEE17FA23EBF76ULL, -1193, -340 },
+	{ 0x8B16FB203055AC76ULL, -1166, -332 },
+	{ 0xCF42894A5DCE35EAULL, -1140, -324 },
+	{ 0x9A6BB0AA55653B2DULL, -1113, -316 },
+	{ 0xE61ACF033D1A45DFULL, -1087, -308 },
+	{ 0xAB70FE17C79AC6CAULL, -1060, -300 },
+	{ 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+	{ 0xBE5691EF416BD60CULL, -1007, -284 },
+	{ 0x8DD01FAD907FFC3CULL, -980, -276 },
+	{ 0xD3515C2831559A83ULL, -954, -268 },
+	{ 0x9D71AC8FADA6C9B5ULL, -927, -260 },
+	{ 0xEA9C227723EE8BCBULL, -901, -252 },
+	{ 0xAECC49914078536DULL, -874, -244 },
+	{ 0x823C12795DB6CE57ULL, -847, -236 },
+	{ 0xC21094364DFB5637ULL, -821, -228 },
+	{ 0x9096EA6F3848984FULL, -794, -220 },
+	{ 0xD77485CB25823AC7ULL, -768, -212 },
+	{ 0xA086CFCD97BF97F4ULL, -741, -204 },
+	{ 0xEF340A98172AACE5ULL, -715, -196 },
+	{ 0xB23867FB2A35B28EULL, -688, -188 },
+	{ 0x84C8D4DFD2C63F3BULL, -661, -180 },
+	{ 0xC5DD44271AD3CDBAULL, -635, -172 },
+	{ 0x936B9FCEBB25C996ULL, -608, -164 },
+	{ 0xDBAC6C247D62A584ULL, -582, -156 },
+	{ 0xA3AB66580D5FDAF6ULL, -555, -148 },
+	{ 0xF3E2F893DEC3F126ULL, -529, -140 },
+	{ 0xB5B5ADA8AAFF80B8ULL, -502, -132 },
+	{ 0x87625F056C7C4A8BULL, -475, -124 },
+	{ 0xC9BCFF6034C13053ULL, -449, -116 },
+	{ 0x964E858C91BA2655ULL, -422, -108 },
+	{ 0xDFF9772470297EBDULL, -396, -100 },
+	{ 0xA6DFBD9FB8E5B88FULL, -369, -92 },
+	{ 0xF8A95FCF88747D94ULL, -343, -84 },
+	{ 0xB94470938FA89BCFULL, -316, -76 },
+	{ 0x8A08F0F8BF0F156BULL, -289, -68 },
+	{ 0xCDB02555653131B6ULL, -263, -60 },
+	{ 0x993FE2C6D07B7FACULL, -236, -52 },
+	{ 0xE45C10C42A2B3B06ULL, -210, -44 },
+	{ 0xAA242499697392D3ULL, -183, -36 },
+	{ 0xFD87B5F28300CA0EULL, -157, -28 },
+	{ 0xBCE5086492111AEBULL, -130, -20 },
+	{ 0x8CBCCC096F5088CCULL, -103, -12 },
+	{ 0xD1B71758E219652CULL, -77, -4 },
+	{ 0x9C40000000000000ULL, -50, 4 },
+	{ 0xE8D4A51000000000ULL, -24, 12 },
+	{ 0xAD78EBC5AC620000ULL, 3, 20 },
+	{ 0x813F3978F8940984ULL, 30, 28 },
+	{ 0xC097CE7BC90715B3ULL, 56, 36 },
+	{ 0x8F7E32CE7BEA5C70ULL, 83, 44 },
+	{ 0xD5D238A4ABE98068ULL, 109, 52 },
+	{ 0x9F4F2726179A2245ULL, 136, 60 },
+	{ 0xED63A231D4C4FB27ULL, 162, 68 },
+	{ 0xB0DE65388CC8ADA8ULL, 189, 76 },
+	{ 0x83C7088E1AAB65DBULL, 216, 84 },
+	{ 0xC45D1DF942711D9AULL, 242, 92 },
+	{ 0x924D692CA61BE758ULL, 269, 100 },
+	{ 0xDA01EE641A708DEAULL, 295, 108 },
+	{ 0xA26DA3999AEF774AULL, 322, 116 },
+	{ 0xF209787BB47D6B85ULL, 348, 124 },
+	{ 0xB454E4A179DD1877ULL, 375, 132 },
+	{ 0x865B86925B9BC5C2ULL, 402, 140 },
+	{ 0xC83553C5C8965D3DULL, 428, 148 },
+	{ 0x952AB45CFA97A0B3ULL, 455, 156 },
+	{ 0xDE469FBD99A05FE3ULL, 481, 164 },
+	{ 0xA59BC234DB398C25ULL, 508, 172 },
+	{ 0xF6C69A72A3989F5CULL, 534, 180 },
+	{ 0xB7DCBF5354E9BECEULL, 561, 188 },
+	{ 0x88FCF317F22241E2ULL, 588, 196 },
+	{ 0xCC20CE9BD35C78A5ULL, 614, 204 },
+	{ 0x98165AF37B2153DFULL, 641, 212 },
+	{ 0xE2A0B5DC971F303AULL, 667, 220 },
+	{ 0xA8D9D1535CE3B396ULL, 694, 228 },
+	{ 0xFB9B7CD9A4A7443CULL, 720, 236 },
+	{ 0xBB764C4CA7A44410ULL, 747, 244 },
+	{ 0x8BAB8EEFB6409C1AULL, 774, 252 },
+	{ 0xD01FEF10A657842CULL, 800, 260 },
+	{ 0x9B10A4E5E9913129ULL, 827, 268 },
+	{ 0xE7109BFBA19C0C9DULL, 853, 276 },
+	{ 0xAC2820D9623BF429ULL, 880, 284 },
+	{ 0x80444B5E7AA7CF85ULL, 907, 292 },
+	{ 0xBF21E44003ACDD2DULL, 933, 300 },
+	{ 0x8E679C2F5E44FF8FULL, 960, 308 },
+	{ 0xD433179D9C8CB841ULL, 986, 316 },
+	{ 0x9E19DB92B4E31BA9ULL, 1013, 324 },
+	{ 0xEB96BF6EBADF77D9ULL, 1039, 332 },
+	{ 0xAF87023B9BF0EE6BULL, 1066, 340 }
+};
+
+static const u32 small_powers_of_ten[] =
+{
+	0, 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static DiyFp multiplyDiyFp(DiyFp x, DiyFp y)
+{
+	u64 a = x.f >> 32;
+	u64 b = x.f & 0xFFFFFFFF;
+	u64 c = y.f >> 32;
+	u64 d = y.f & 0xFFFFFFFF;
+	
+	u64 ac = a*c;
+	u64 bc = b*c;
+	u64 ad = a*d;
+	u64 bd = b*d;
+	
+	// Round the dropped low half
+	u64 tmp = (bd >> 32) + (ad & 0xFFFFFFFF) + (bc & 0xFFFFFFFF);
+	tmp += 1U << 31;
+	
+	DiyFp result;
+	result.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+	result.e = x.e + y.e + 64;
+	
+	return result;
+}
+
+static DiyFp toNormalizedDiyFp(double value)
+{
+	u64 bits;
+	memcpy(&bits, &value, sizeof(u64));
+	
+	u64 fraction = bits & 0x000FFFFFFFFFFFFF;
+	int biased_exponent = (int) ((bits >> 52) & 0x7FF);
+	
+	DiyFp w;
+	
+	if (biased_exponent == 0)
+	{
+		// Denormal
+		w.f = fraction;
+		w.e = 1 - 1075;
+	}
+	
+	else
+	{
+		w.f = fraction | 0x0010000000000000;
+		w.e = biased_exponent - 1075;
+	}
+	
+	while ((w.f & 0x8000000000000000) == 0)
+	{
+		w.f <<= 1;
+		w.e -= 1;
+	}
+	
+	return w;
+}
+
+static CachedPower getCachedPower(int min_exponent)
+{
+	// ceil((min_exponent + 63)*log10(2)) without pulling in libm
+	double k_estimate = (min_exponent + 63)*0.30102999566398114;
+	int k = (int) k_estimate;
+	
+	if (k < k_estimate)
+	{
+		k += 1;
+	}
+	
+	int index = (CACHED_POWERS_OFFSET + k - 1)/CACHED_POWERS_DECIMAL_DISTANCE + 1;
+	
+	return cached_powers[index];
+}
+
+static bool roundWeedCounted(char* digits, int length, u64 rest, u64 ten_kappa, u64 unit, int* kappa)
+{
+	// The error interval is too wide to decide either way
+	if (unit >= ten_kappa || ten_kappa - unit <= unit)
+	{
+		return false;
+	}
+	
+	// Rounding down is safe
+	if (ten_kappa - rest > rest && ten_kappa - 2*rest >= 2*unit)
+	{
+		return true;
+	}
+	
+	// Rounding up is safe
+	if (rest > unit && ten_kappa - (rest - unit) <= rest - unit)
+	{
+		digits[length - 1] += 1;
+		
+		for (int i = length - 1; i > 0; --i)
+		{
+			if (digits[i] != '0' + 10)
+			{
+				break;
+			}
+			
+			digits[i] = '0';
+			digits[i - 1] += 1;
+		}
+		
+		if (digits[0] == '0' + 10)
+		{
+			digits[0] = '1';
+			*kappa += 1;
+		}
+		
+		return true;
+	}
+	
+	return false;
+}
+
+static bool digitGenCounted(DiyFp w, int requested_digits, char* digits, int* length, int* kappa)
+{
+	u64 w_error = 1;
+	
+	u64 one_f = ((u64) 1) << -w.e;
+	u32 integrals = (u32) (w.f >> -w.e);
+	u64 fractionals = w.f & (one_f - 1);
+	
+	// Biggest power of ten that is <= integrals
+	int integral_bits = 64 + w.e;
+	int exponent_plus_one = ((integral_bits + 1)*1233 >> 12) + 1;
+	
+	if (integrals < small_powers_of_ten[exponent_plus_one])
+	{
+		exponent_plus_one -= 1;
+	}
+	
+	u32 divisor = small_powers_of_ten[exponent_plus_one];
+	
+	*kappa = exponent_plus_one;
+	*length = 0;
+	
+	while (*kappa > 0)
+	{
+		digits[*length] = (char) ('0' + integrals/divisor);
+		*length += 1;
+		requested_digits -= 1;
+		integrals %= divisor;
+		*kappa -= 1;
+		
+		if (requested_digits == 0)
+		{
+			break;
+		}
+		
+		divisor /= 10;
+	}
+	
+	if (requested_digits == 0)
+	{
+		u64 rest = ((u64) integrals << -w.e) + fractionals;
+		
+		return roundWeedCounted(digits, *length, rest, (u64) divisor << -w.e, w_error, kappa);
+	}
+	
+	while (requested_digits > 0 && fractionals > w_error)
+	{
+		fractionals *= 10;
+		w_error *= 10;
+		
+		digits[*length] = (char) ('0' + (fractionals >> -w.e));
+		*length += 1;
+		requested_digits -= 1;
+		fractionals &= one_f - 1;
+		*kappa -= 1;
+	}
+	
+	if (requested_digits != 0)
+	{
+		return false;
+	}
+	
+	return roundWeedCounted(digits, *length, fractionals, one_f, w_error, kappa);
+}
+
+// Writes the leading FLASH_PRECISION digits of a positive value, which
+// equals 0.digits*10^point
+static int generateDigits(double value, char* digits, int* point)
+{
+	DiyFp w = toNormalizedDiyFp(value);
+	CachedPower power = getCachedPower(MIN_TARGET_EXPONENT - (w.e + 64));
+	
+	DiyFp ten_mk;
+	ten_mk.f = power.significand;
+	ten_mk.e = power.binary_exponent;
+	
+	int length;
+	int kappa;
+	
+	if (digitGenCounted(multiplyDiyFp(w, ten_mk), FLASH_PRECISION, digits, &length, &kappa))
+	{
+		*point = length - power.decimal_exponent + kappa;
+		
+		return length;
+	}
+	
+	// Grisu couldn't guarantee correct rounding, only the digit
+	// characters are read back so the locale's decimal point is fine
+	char temp[32];
+	snprintf(temp, sizeof(temp), "%.*e", FLASH_PRECISION - 1, value);
+	
+	char* c = temp;
+	length = 0;
+	
+	for (; *c != 'e'; ++c)
+	{
+		if (*c >= '0' && *c <= '9')
+		{
+			digits[length] = *c;
+			length += 1;
+		}
+	}
+	
+	*point = atoi(c + 1) + 1;
+	
+	return length;
+}
+
+static char* writeUnsigned(char* out, u64 value)
+{
+	char temp[20];
+	int n = 0;
+	
+	do
+	{
+		temp[n] = (char) ('0' + value%10);
+		n += 1;
+		value /= 10;
+	} while (value != 0);
+	
+	while (n > 0)
+	{
+		n -= 1;
+		*out = temp[n];
+		out += 1;
+	}
+	
+	return out;
+}
+
+u32 numberToString(double value, char* buffer)
+{
+	char* out = buffer;
+	
+	if (value != value)
+	{
+		memcpy(buffer, "NaN", 4);
+		return 3;
+	}
+	
+	if (value < 0.0)
+	{
+		*out = '-';
+		out += 1;
+		value = -value;
+	}
+	
+	if (value > DBL_MAX)
+	{
+		memcpy(out, "Infinity", 9);
+		return (u32) (out - buffer) + 8;
+	}
+	
+	// Integers are by far the most common case and need no rounding
+	if (value < 1e15)
+	{
+		u64 integer = (u64) value;
+		
+		if ((double) integer == value)
+		{
+			out = writeUnsigned(out, integer);
+			*out = '\0';
+			
+			return (u32) (out - buffer);
+		}
+	}
+	
+	char digits[FLASH_PRECISION + 1];
+	int point;
+	int length = generateDigits(value, digits, &point);
+	
+	while (length > 1 && digits[length - 1] == '0')
+	{
+		length -= 1;
+	}
+	
+	int exponent = point - 1;
+	
+	if (exponent < -5 || exponent >= FLASH_PRECISION)
+	{
+		// d.ddde+x
+		*out = digits[0];
+		out += 1;
+		
+		if (length > 1)
+		{
+			*out = '.';
+			memcpy(out + 1, digits + 1, length - 1);
+			out += length;
+		}
+		
+		*out = 'e';
+		out[1] = exponent < 0 ? '-' : '+';
+		out = writeUnsigned(out + 2, exponent < 0 ? -exponent : exponent);
+	}
+	
+	else if (point <= 0)
+	{
+		// 0.000ddd
+		memcpy(out, "0.", 2);
+		out += 2;
+		memset(out, '0', -point);
+		out += -point;
+		memcpy(out, digits, length);
+		out += length;
+	}
+	
+	else if (point >= length)
+	{
+		// ddd000
+		memcpy(out, digits, length);
+		out += length;
+		memset(out, '0', point - length);
+		out += point - length;
+	}
+	
+	else
+	{
+		// ddd.ddd
+		memcpy(out, digits, point);
+		out[point] = '.';
+		memcpy(out + point + 1, digits + point, length - point);
+		out += length + 1;
+	}
+	
+	*out = '\0';
+	
+	return (u32) (out - buffer);
+}
+
+// Powers of ten that are exactly representable as doubles
+static const double exact_powers_of_ten[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+	1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+	1e21, 1e22,
+};
+
+#define MAX_EXACT_POWER_OF_TEN 22
+#define MAX_EXACT_MANTISSA (1ull << 53)
+
+// Enough digits to round any decimal string correctly, with one more
+// slot for the sticky digit standing in for the ones cut off
+#define MAX_SIGNIFICANT_DIGITS 768
+
+static inline int isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline int isWhitespace(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline int hexDigitValue(char c)
+{
+	if (isDigit(c))
+	{
+		return c - '0';
+	}
+	
+	c |= 0x20;
+	
+	if (c >= 'a' && c <= 'f')
+	{
+		return c - 'a' + 10;
+	}
+	
+	return -1;
+}
+
+static const char* parseHex(const char* s, double* value)
+{
+	double result = 0.0;
+	const char* start = s;
+	
+	for (int digit = hexDigitValue(*s); digit >= 0; digit = hexDigitValue(*s))
+	{
+		result = 16.0*result + digit;
+		s += 1;
+	}
+	
+	*value = result;
+	
+	return s == start ? NULL : s;
+}
+
+static const char* parseDecimal(const char* s, double* value)
+{
+	const char* int_digits = s;
+	
+	while (isDigit(*s))
+	{
+		s += 1;
+	}
+	
+	size_t int_count = s - int_digits;
+	
+	const char* frac_digits = s;
+	size_t frac_count = 0;
+	
+	if (*s == '.')
+	{
+		s += 1;
+		frac_digits = s;
+		
+		while (isDigit(*s))
+		{
+			s += 1;
+		}
+		
+		frac_count = s - frac_digits;
+	}
+	
+	if (int_count + frac_count == 0)
+	{
+		return NULL;
+	}
+	
+	int exponent = 0;
+	
+	if (*s == 'e' || *s == 'E')
+	{
+		const char* exponent_start = s;
+		s += 1;
+		
+		int exponent_negative = *s == '-';
+		
+		if (*s == '-' || *s == '+')
+		{
+			s += 1;
+		}
+		
+		// An exponent without digits isn't part of the number
+		if (!isDigit(*s))
+		{
+			s = exponent_start;
+		}
+		
+		for (; isDigit(*s); ++s)
+		{
+			// Anything past this over- or underflows anyway
+			if (exponent < 100000)
+			{
+				exponent = 10*exponent + (*s - '0');
+			}
+		}
+		
+		if (exponent_negative)
+		{
+			exponent = -exponent;
+		}
+	}
+	
+	// Gather the significant digits, so the value is digits*10^exponent
+	char digits[MAX_SIGNIFICANT_DIGITS + 16];
+	int count = 0;
+	int truncated = 0;
+	
+	for (size_t i = 0; i < int_count + frac_count; ++i)
+	{
+		int in_fraction = i >= int_count;
+		char c = in_fraction ? frac_digits[i - int_count] : int_digits[i];
+		
+		if (count == 0 && c == '0')
+		{
+			exponent -= in_fraction;
+		}
+		
+		else if (count < MAX_SIGNIFICANT_DIGITS)
+		{
+			digits[count] = c;
+			count += 1;
+			exponent -= in_fraction;
+		}
+		
+		else
+		{
+			truncated |= c != '0';
+			exponent += !in_fraction;
+		}
+	}
+	
+	while (count > 0 && digits[count - 1] == '0')
+	{
+		count -= 1;
+		exponent += 1;
+	}
+	
+	if (count == 0)
+	{
+		*value = 0.0;
+		return s;
+	}
+	
+	if (count <= 19 && !truncated)
+	{
+		u64 mantissa = 0;
+		
+		for (int i = 0; i < count; ++i)
+		{
+			mantissa = 10*mantissa + (digits[i] - '0');
+		}
+		
+		// Both operands are exact, so a single rounding gives the
+		// correctly rounded result (Clinger's fast path)
+		if (mantissa <= MAX_EXACT_MANTISSA &&
+		    exponent >= -MAX_EXACT_POWER_OF_TEN && exponent <= MAX_EXACT_POWER_OF_TEN)
+		{
+			*value = exponent < 0 ?
+				(double) mantissa/exact_powers_of_ten[-exponent] :
+				(double) mantissa*exact_powers_of_ten[exponent];
+			
+			return s;
+		}
+	}
+	
+	// Rare long or extreme inputs go through strtod. The digits are passed
+	// without a decimal point, which is the only part strtod reads from
+	// the locale.
+	if (truncated)
+	{
+		digits[count] = '1';
+		count += 1;
+		exponent -= 1;
+	}
+	
+	snprintf(digits + count, 16, "e%d", exponent);
+	*value = strtod(digits, NULL);
+	
+	return s;
+}
+
+double stringToNumber(const char* str)
+{
+	const char* s = str;
+	
+	while (isWhitespace(*s))
+	{
+		s += 1;
+	}
+	
+	int negative = *s == '-';
+	
+	if (*s == '-' || *s == '+')
+	{
+		s += 1;
+	}
+	
+	double value;
+	
+	if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+	{
+		s = parseHex(s + 2, &value);
+	}
+	
+	else if (strncmp(s, "Infinity", 8) == 0)
+	{
+		value = INFINITY;
+		s += 8;
+	}
+	
+	else
+	{
+		s = parseDecimal(s, &value);
+	}
+	
+	if (s == NULL)
+	{
+		return 0.0;
+	}
+	
+	return negative ? -value : value;
+}
+
+// Bit pattern marking string ids that haven't been parsed yet. It's a
+// signaling NaN, which stringToNumber never returns.
+#define NUMBER_CACHE_EMPTY 0x7FF0000000000001ull
+
+void initNumberCache(SWFAppContext* app_context, size_t max_string_id)
+{
+	app_context->number_cache = (u64*) HALLOC((max_string_id + 1)*sizeof(u64));
+	
+	for (size_t i = 0; i <= max_string_id; ++i)
+	{
+		app_context->number_cache[i] = NUMBER_CACHE_EMPTY;
+	}
+}
+
+void freeNumberCache(SWFAppContext* app_context)
+{
+	FREE(app_context->number_cache);
+	app_context->number_cache = NULL;
+}
+
+// A slot can borrow the start of a variable's buffer that s = s + x has
+// since appended to in place, so its chars are only terminated at its
+// length if nothing was appended. Numbers are short, so the copy usually
+// fits on the stack.
+#define BOUNDED_NUMBER_BUFFER_SIZE 64
+
+static double boundedStringToNumber(SWFAppContext* app_context, const char* str, u32 length)
+{
+	if (str[length] == '\0')
+	{
+		return stringToNumber(str);
+	}
+	
+	char buffer[BOUNDED_NUMBER_BUFFER_SIZE];
+	char* chars = buffer;
+	
+	if (length >= BOUNDED_NUMBER_BUFFER_SIZE)
+	{
+		chars = (char*) HALLOC(length + 1);
+	}
+	
+	memcpy(chars, str, length);
+	chars[length] = '\0';
+	
+	double value = stringToNumber(chars);
+	
+	if (chars != buffer)
+	{
+		FREE(chars);
+	}
+	
+	return value;
+}
+
+double stringIdToNumber(SWFAppContext* app_context, const char* str, u32 length, u32 string_id)
+{
+	if (string_id == 0 || string_id > app_context->max_string_id)
+	{
+		return boundedStringToNumber(app_context, str, length);
+	}
+	
+	u64* entry = &app_context->number_cache[string_id];
+	double value;
+	
+	if (*entry == NUMBER_CACHE_EMPTY)
+	{
+		value = stringToNumber(str);
+		memcpy(entry, &value, sizeof(double));
+		
+		return value;
+	}
+	
+	memcpy(&value, entry, sizeof(double));
+	
+	return value;
+}
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include <string.h>
+
+#include <opprofile.h>
+#include <heap.h>
+
+static const char* op_names[ACTION_OP_ID_COUNT] =
+{
+	[ACTION_OP_NONE] = "(frame start)",
+	[ACTION_OP_PUSH] = "Push",
+	[ACTION_OP_POP] = "Pop",
+	[ACTION_OP_ADD] = "Add",
+	[ACTION_OP_SUBTRACT] = "Subtract",
+	[ACTION_OP_MULTIPLY] = "Multiply",
+	[ACTION_OP_DIVIDE] = "Divide",
+	[ACTION_OP_EQUALS] = "Equals",
+	[ACTION_OP_LESS] = "Less",
+	[ACTION_OP_AND] = "And",
+	[ACTION_OP_OR] = "Or",
+	[ACTION_OP_NOT] = "Not",
+	[ACTION_OP_IF] = "If",
+	[ACTION_OP_STRING_EQUALS] = "StringEquals",
+	[ACTION_OP_STRING_LENGTH] = "StringLength",
+	[ACTION_OP_STRING_ADD] = "StringAdd",
+	[ACTION_OP_GET_VARIABLE] = "GetVariable",
+	[ACTION_OP_SET_VARIABLE] = "SetVariable",
+	[ACTION_OP_TRACE] = "Trace",
+	[ACTION_OP_GET_TIME] = "GetTime",
+	[ACTION_OP_ADD_CONST] = "AddConst",
+	[ACTION_OP_INCREMENT_VAR] = "IncrementVarById",
+	[ACTION_OP_COMPARE_VAR_CONST_BRANCH] = "CompareVarConstBranch",
+};
+
+static const char* fn_names[ACTION_FN_COUNT] =
+{
+#define ACTION_FN_NAME(id, name) [id] = #name,
+	ACTION_PROFILED_FUNCTIONS(ACTION_FN_NAME)
+#undef ACTION_FN_NAME
+	[ACTION_LOOKUP_VAR_ARRAY] = "(lookup) var_array",
+	[ACTION_LOOKUP_INTERNED_ID] = "(lookup) intern table by id",
+	[ACTION_LOOKUP_BY_NAME] = "(lookup) intern table by name",
+};
+
+typedef struct
+{
+	u64 count;
+	u16 first;
+	u16 second;
+} OpPair;
+
+typedef struct
+{
+	u64 cycles;
+	u16 fn;
+} FnCycles;
+
+void opProfileInit(SWFAppContext* app_context)
+{
+	app_context->op_profile = (ActionOpProfile*) HALLOC(sizeof(ActionOpProfile));
+	memset(app_context->op_profile, 0, sizeof(ActionOpProfile));
+}
+
+void opProfileRecord(SWFAppContext* app_context, ActionOpId op)
+{
+	ActionOpProfile* profile = app_context->op_profile;
+	
+	profile->op_counts[op] += 1;
+	profile->pair_counts[profile->last_op][op] += 1;
+	profile->last_op = op;
+}
+
+static int compare_pairs(const void* a, const void* b)
+{
+	u64 count_a = ((const OpPair*) a)->count;
+	u64 count_b = ((const OpPair*) b)->count;
+	
+	return (count_a < count_b) - (count_a > count_b);
+}
+
+void opProfileShutdown(SWFAppContext* app_context, FILE* out, size_t max_pairs)
+{
+	ActionOpProfile* profile = app_context->op_profile;
+	
+	if (profile == NULL)
+	{
+		return;
+	}
+	
+	fprintf(out, "=== Action op counts ===\n");
+	
+	for (size_t i = 1; i < ACTION_OP_ID_COUNT; ++i)
+	{
+		if (profile->op_counts[i] != 0)
+		{
+			fprintf(out, "%12llu  %s\n", (unsigned long long) profile->op_counts[i], op_names[i]);
+		}
+	}
+	
+	OpPair* pairs = (OpPair*) HALLOC(ACTION_OP_ID_COUNT*ACTION_OP_ID_COUNT*sizeof(OpPair));
+	size_t num_pairs = 0;
+	
+	for (size_t first = 0; first < ACTION_OP_ID_COUNT; ++first)
+	{
+		for (size_t second = 0; second < ACTION_OP_ID_COUNT; ++second)
+		{
+			u64 count = profile->pair_counts[first][second];
+			
+			if (count != 0)
+			{
+				pairs[num_pairs].count = count;
+				pairs[num_pairs].first = (u16) first;
+				pairs[num_pairs].second = (u16) second;
+				num_pairs += 1;
+			}
+		}
+	}
+	
+	qsort(pairs, num_pairs, sizeof(OpPair), compare_pairs);
+	
+	fprintf(out, "=== Most frequent action op pairs ===\n");
+	
+	for (size_t i = 0; i < num_pairs && i < max_pairs; ++i)
+	{
+		fprintf(out, "%12llu  %s -> %s\n", (unsigned long long) pairs[i].count, op_names[pairs[i].first], op_names[pairs[i].second]);
+	}
+	
+	FREE(pairs);
+	FREE(profile);
+	
+	app_context->op_profile = NULL;
+}
+
+void opCycleProfileInit(SWFAppContext* app_context)
+{
+	app_context->cycle_profile = (ActionCycleProfile*) HALLOC(sizeof(ActionCycleProfile));
+	memset(app_context->cycle_profile, 0, sizeof(ActionCycleProfile));
+}
+
+static int compare_fns(const void* a, const void* b)
+{
+	u64 cycles_a = ((const FnCycles*) a)->cycles;
+	u64 cycles_b = ((const FnCycles*) b)->cycles;
+	
+	return (cycles_a < cycles_b) - (cycles_a > cycles_b);
+}
+
+void opCycleProfileShutdown(SWFAppContext* app_context, FILE* out)
+{
+	ActionCycleProfile* profile = app_context->cycle_profile;
+	
+	if (profile == NULL)
+	{
+		return;
+	}
+	
+	FnCycles fns[ACTION_FN_COUNT];
+	size_t num_fns = 0;
+	u64 total_cycles = 0;
+	
+	for (size_t i = 0; i < ACTION_FN_COUNT; ++i)
+	{
+		if (profile->calls[i] != 0)
+		{
+			fns[num_fns].cycles = profile->cycles[i];
+			fns[num_fns].fn = (u16) i;
+			num_fns += 1;
+		}
+		
+		// Lookups happen inside the functions, so they'd be counted twice
+		if (i < ACTION_LOOKUP_VAR_ARRAY)
+		{
+			total_cycles += profile->cycles[i];
+		}
+	}
+	
+	qsort(fns, num_fns, sizeof(FnCycles), compare_fns);
+	
+	fprintf(out, "=== Action function cycles ===\n");
+	fprintf(out, "%12s  %14s  %10s  %6s  %s\n", "calls", "cycles", "per call", "%", "function");
+	
+	for (size_t i = 0; i < num_fns; ++i)
+	{
+		u64 calls = profile->calls[fns[i].fn];
+		u64 cycles = fns[i].cycles;
+		
+		fprintf(out, "%12llu  %14llu  %10.1f  %6.2f  %s\n",
+		        (unsigned long long) calls, (unsigned long long) cycles,
+		        (double) cycles/calls, total_cycles != 0 ? 100.0*cycles/total_cycles : 0.0,
+		        fn_names[fns[i].fn]);
+	}
+	
+	FREE(profile);
+	
+	app_context->cycle_profile = NULL;
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include <string.h>
+
+#include <sharedstring.h>
+#include <action.h>
+#include <heap.h>
+
+#define INITIAL_DEAD_STRINGS_CAPACITY 256
+
+void initSharedStrings(SWFAppContext* app_context)
+{
+	app_context->dead_strings = (char**) HALLOC(INITIAL_DEAD_STRINGS_CAPACITY*sizeof(char*));
+	app_context->num_dead_strings = 0;
+	app_context->dead_strings_capacity = INITIAL_DEAD_STRINGS_CAPACITY;
+}
+
+void freeSharedStrings(SWFAppContext* app_context)
+{
+	for (u32 i = 0; i < app_context->num_dead_strings; ++i)
+	{
+		char* str = app_context->dead_strings[i];
+		
+		if ((SHARED_STRING_HEADER(str)->refcount & SHARED_STRING_COUNT_MASK) == 0)
+		{
+			FREE(SHARED_STRING_HEADER(str));
+		}
+	}
+	
+	FREE(app_context->dead_strings);
+	app_context->dead_strings = NULL;
+	app_context->num_dead_strings = 0;
+	app_context->dead_strings_capacity = 0;
+}
+
+char* allocSharedString(SWFAppContext* app_context, u32 capacity)
+{
+	SharedStringHeader* header = (SharedStringHeader*) HALLOC(sizeof(SharedStringHeader) + capacity);
+	header->refcount = 1;
+	header->capacity = capacity;
+	
+	return (char*) (header + 1);
+}
+
+void releaseSharedString(SWFAppContext* app_context, char* str)
+{
+	SharedStringHeader* header = SHARED_STRING_HEADER(str);
+	header->refcount -= 1;
+	
+	// A string retained and released again while queued is queued once
+	if ((header->refcount & SHARED_STRING_COUNT_MASK) != 0 || (header->refcount & SHARED_STRING_QUEUED))
+	{
+		return;
+	}
+	
+	header->refcount |= SHARED_STRING_QUEUED;
+	
+	if (app_context->num_dead_strings == app_context->dead_strings_capacity)
+	{
+		reclaimSharedStrings(app_context);
+	}
+	
+	// Everything queued is still on the stack, so make room
+	if (app_context->num_dead_strings == app_context->dead_strings_capacity)
+	{
+		u32 capacity = 2*app_context->dead_strings_capacity;
+		char** dead_strings = (char**) HALLOC(capacity*sizeof(char*));
+		memcpy(dead_strings, app_context->dead_strings, app_context->num_dead_strings*sizeof(char*));
+		FREE(app_context->dead_strings);
+		
+		app_context->dead_strings = dead_strings;
+		app_context->dead_strings_capacity = capacity;
+	}
+	
+	app_context->dead_strings[app_context->num_dead_strings] = str;
+	app_context->num_dead_strings += 1;
+}
+
+static inline void markString(SWFAppContext* app_context, char* str, int on_stack)
+{
+	if (!isSharedString(app_context, str))
+	{
+		return;
+	}
+	
+	if (on_stack)
+	{
+		SHARED_STRING_HEADER(str)->refcount |= SHARED_STRING_ON_STACK;
+	}
+	
+	else
+	{
+		SHARED_STRING_HEADER(str)->refcount &= ~SHARED_STRING_ON_STACK;
+	}
+}
+
+// Flags or unflags every shared string used by a live stack slot,
+// directly or as a segment of a string list
+static void markStackStrings(SWFAppContext* app_context, int on_stack)
+{
+	for (u32 sp = SP; sp < INITIAL_SP; sp += STACK_SLOT_SIZE)
+	{
+		u64 value = VAL(u64, &STACK[sp + 8]);
+		
+		if (STACK[sp] == ACTION_STACK_VALUE_STRING)
+		{
+			markString(app_context, (char*) value, on_stack);
+		}
+		
+		else if (STACK[sp] == ACTION_STACK_VALUE_STR_LIST)
+		{
+			u64* str_list = (u64*) value;
+			
+			for (u64 i = 0; i < 2*str_list[0]; i += 2)
+			{
+				markString(app_context, (char*) str_list[i + 1], on_stack);
+			}
+		}
+	}
+}
+
+void reclaimSharedStrings(SWFAppContext* app_context)
+{
+	markStackStrings(app_context, 1);
+	
+	u32 num_kept = 0;
+	
+	for (u32 i = 0; i < app_context->num_dead_strings; ++i)
+	{
+		char* str = app_context->dead_strings[i];
+		SharedStringHeader* header = SHARED_STRING_HEADER(str);
+		
+		// Stored into a variable again straight from the stack, it will be
+		// queued again if released
+		if ((header->refcount & SHARED_STRING_COUNT_MASK) != 0)
+		{
+			header->refcount &= ~SHARED_STRING_QUEUED;
+			continue;
+		}
+		
+		if (header->refcount & SHARED_STRING_ON_STACK)
+		{
+			app_context->dead_strings[num_kept] = str;
+			num_kept += 1;
+			
+			continue;
+		}
+		
+		FREE(header);
+	}
+	
+	app_context->num_dead_strings = num_kept;
+	
+	markStackStrings(app_context, 0);
+}
\ No newline at end of file
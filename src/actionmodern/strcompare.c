@@ -0,0 +1,182 @@
+#include <string.h>
+
+#include <strcompare.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define STRCOMPARE_AVX2
+#define STRCOMPARE_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STRCOMPARE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define STRCOMPARE_NEON
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+
+static inline u32 countTrailingZeros(u32 x)
+{
+	unsigned long index;
+	_BitScanForward(&index, x);
+	
+	return (u32) index;
+}
+
+static inline u32 countTrailingZeros64(u64 x)
+{
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	
+	return (u32) index;
+}
+#else
+#define countTrailingZeros(x) ((u32) __builtin_ctz(x))
+#define countTrailingZeros64(x) ((u32) __builtin_ctzll(x))
+#endif
+
+// Index of the first byte where a and b differ, or n if they don't
+static size_t findMismatch(const u8* a, const u8* b, size_t n)
+{
+	size_t i = 0;
+
+#ifdef STRCOMPARE_AVX2
+	for (; i + 32 <= n; i += 32)
+	{
+		__m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+		u32 equal = (u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+		
+		if (equal != 0xFFFFFFFF)
+		{
+			return i + countTrailingZeros(~equal);
+		}
+	}
+#endif
+
+#if defined(STRCOMPARE_SSE2)
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+		u32 equal = (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+		
+		if (equal != 0xFFFF)
+		{
+			return i + countTrailingZeros(~equal);
+		}
+	}
+#elif defined(STRCOMPARE_NEON)
+	for (; i + 16 <= n; i += 16)
+	{
+		uint8x16_t diff = veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+		
+		if (vmaxvq_u8(diff) != 0)
+		{
+			// Narrow each byte to a nibble so the mask fits in 64 bits
+			uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(vtstq_u8(diff, diff)), 4);
+			u64 mask = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+			
+			return i + countTrailingZeros64(mask)/4;
+		}
+	}
+#endif
+	
+	// Remaining tail, or the whole string without SIMD
+	for (; i + 8 <= n; i += 8)
+	{
+		u64 wa;
+		u64 wb;
+		memcpy(&wa, a + i, 8);
+		memcpy(&wb, b + i, 8);
+		
+		if (wa != wb)
+		{
+			break;
+		}
+	}
+	
+	for (; i < n; ++i)
+	{
+		if (a[i] != b[i])
+		{
+			return i;
+		}
+	}
+	
+	return n;
+}
+
+// Walks both segment lists together in chunks that end at whichever
+// segment boundary comes first, so each chunk is a flat compare
+#define DEFINE_COMPARE_SEGMENTS(name, find_mismatch) \
+	int name(const u64* a_segments, u64 num_a, const u64* b_segments, u64 num_b) \
+	{ \
+		u64 a_seg = 0; \
+		u64 b_seg = 0; \
+		u64 a_offset = 0; \
+		u64 b_offset = 0; \
+		\
+		while (1) \
+		{ \
+			while (a_seg < num_a && a_offset == a_segments[2*a_seg + 1]) \
+			{ \
+				a_seg += 1; \
+				a_offset = 0; \
+			} \
+			\
+			while (b_seg < num_b && b_offset == b_segments[2*b_seg + 1]) \
+			{ \
+				b_seg += 1; \
+				b_offset = 0; \
+			} \
+			\
+			if (a_seg == num_a || b_seg == num_b) \
+			{ \
+				return (b_seg == num_b) - (a_seg == num_a); \
+			} \
+			\
+			const u8* a = (const u8*) a_segments[2*a_seg] + a_offset; \
+			const u8* b = (const u8*) b_segments[2*b_seg] + b_offset; \
+			u64 a_left = a_segments[2*a_seg + 1] - a_offset; \
+			u64 b_left = b_segments[2*b_seg + 1] - b_offset; \
+			u64 n = a_left < b_left ? a_left : b_left; \
+			\
+			size_t i = find_mismatch(a, b, n); \
+			\
+			if (i != n) \
+			{ \
+				return (int) a[i] - (int) b[i]; \
+			} \
+			\
+			a_offset += n; \
+			b_offset += n; \
+		} \
+	}
+
+static size_t findMismatchScalar(const u8* a, const u8* b, size_t n)
+{
+	size_t i = 0;
+	
+	while (i < n && a[i] == b[i])
+	{
+		i += 1;
+	}
+	
+	return i;
+}
+
+DEFINE_COMPARE_SEGMENTS(compareStringSegments, findMismatch)
+DEFINE_COMPARE_SEGMENTS(compareStringSegmentsScalar, findMismatchScalar)
+
+int equalStringSegments(const u64* a_segments, u64 num_a, u32 a_size, const u64* b_segments, u64 num_b, u32 b_size)
+{
+	if (a_size != b_size)
+	{
+		return 0;
+	}
+	
+	return compareStringSegments(a_segments, num_a, b_segments, num_b) == 0;
+}
\ No newline at end of file
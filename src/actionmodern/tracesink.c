@@ -0,0 +1,444 @@
+#include <string.h>
+
+#include <tracesink.h>
+#include <heap.h>
+
+#define DEFAULT_BUFFER_SIZE 65536
+#define DEFAULT_FLUSH_SIZE 4096
+
+#if defined(_MSC_VER)
+// Microsoft
+
+#include <windows.h>
+
+typedef HANDLE TraceThread;
+typedef CRITICAL_SECTION TraceMutex;
+typedef CONDITION_VARIABLE TraceCond;
+
+#define THREAD_FUNC(name) static DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN return 0;
+
+#define LOAD_ACQUIRE(p) ((u64) InterlockedCompareExchange64((volatile LONG64*) (p), 0, 0))
+#define STORE_RELEASE(p, v) InterlockedExchange64((volatile LONG64*) (p), (LONG64) (v));
+
+#define mutexInit(m) InitializeCriticalSection(m);
+#define mutexDestroy(m) DeleteCriticalSection(m);
+#define mutexLock(m) EnterCriticalSection(m);
+#define mutexUnlock(m) LeaveCriticalSection(m);
+#define condInit(c) InitializeConditionVariable(c);
+#define condDestroy(c)
+#define condWait(c, m) SleepConditionVariableCS(c, m, INFINITE);
+#define condSignal(c) WakeConditionVariable(c);
+#define condBroadcast(c) WakeAllConditionVariable(c);
+#define threadStart(t, func, arg) ((*(t) = CreateThread(NULL, 0, func, arg, 0, NULL)) != NULL)
+#define threadJoin(t) WaitForSingleObject(t, INFINITE); CloseHandle(t);
+
+#else
+// POSIX
+
+#include <pthread.h>
+
+typedef pthread_t TraceThread;
+typedef pthread_mutex_t TraceMutex;
+typedef pthread_cond_t TraceCond;
+
+#define THREAD_FUNC(name) static void* name(void* arg)
+#define THREAD_RETURN return NULL;
+
+#define LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE);
+
+#define mutexInit(m) pthread_mutex_init(m, NULL);
+#define mutexDestroy(m) pthread_mutex_destroy(m);
+#define mutexLock(m) pthread_mutex_lock(m);
+#define mutexUnlock(m) pthread_mutex_unlock(m);
+#define condInit(c) pthread_cond_init(c, NULL);
+#define condDestroy(c) pthread_cond_destroy(c);
+#define condWait(c, m) pthread_cond_wait(c, m);
+#define condSignal(c) pthread_cond_signal(c);
+#define condBroadcast(c) pthread_cond_broadcast(c);
+#define threadStart(t, func, arg) (pthread_create(t, NULL, func, arg) == 0)
+#define threadJoin(t) pthread_join(t, NULL);
+
+#endif
+
+struct TraceSink
+{
+	TraceSinkConfig config;
+	FILE* out;
+	
+	char* ring;
+	u64 ring_size;
+	
+	// Positions only grow, and index the ring masked by ring_size - 1.
+	// write_pos is only touched by the VM thread and read_pos is only
+	// stored by the writer. flush_pos is how far the writer may read.
+	u64 write_pos;
+	u64 flush_pos;
+	u64 read_pos;
+	
+	u64 count;
+	
+	// Only for sleeping and waking, the positions above carry the data
+	TraceMutex mutex;
+	TraceCond flush_requested;
+	TraceCond space_freed;
+	int stopping;
+	
+	TraceThread thread;
+	
+	// Set if the writer thread couldn't be started. There's no ring then,
+	// and traces are written out on the VM thread as they come.
+	int synchronous;
+};
+
+static void writeOut(TraceSink* sink, const char* data, size_t size)
+{
+	if (sink->config.destination == TRACE_TO_CALLBACK)
+	{
+		sink->config.callback(data, size, sink->config.user);
+	}
+	
+	else
+	{
+		fwrite(data, 1, size, sink->out);
+	}
+}
+
+THREAD_FUNC(writerMain)
+{
+	TraceSink* sink = (TraceSink*) arg;
+	
+	while (1)
+	{
+		mutexLock(&sink->mutex);
+		
+		while (!sink->stopping && LOAD_ACQUIRE(&sink->flush_pos) == sink->read_pos)
+		{
+			condWait(&sink->flush_requested, &sink->mutex);
+		}
+		
+		int stopping = sink->stopping;
+		
+		mutexUnlock(&sink->mutex);
+		
+		u64 start = sink->read_pos;
+		u64 end = LOAD_ACQUIRE(&sink->flush_pos);
+		
+		if (start == end)
+		{
+			// Shutdown always flushes before stopping, so this is the end
+			if (stopping)
+			{
+				break;
+			}
+			
+			continue;
+		}
+		
+		u64 offset = start & (sink->ring_size - 1);
+		u64 size = end - start;
+		u64 first = size < sink->ring_size - offset ? size : sink->ring_size - offset;
+		
+		writeOut(sink, sink->ring + offset, first);
+		
+		if (size > first)
+		{
+			writeOut(sink, sink->ring, size - first);
+		}
+		
+		if (sink->out != NULL)
+		{
+			fflush(sink->out);
+		}
+		
+		STORE_RELEASE(&sink->read_pos, end);
+		
+		mutexLock(&sink->mutex);
+		condBroadcast(&sink->space_freed);
+		mutexUnlock(&sink->mutex);
+	}
+	
+	THREAD_RETURN
+}
+
+static void requestFlush(TraceSink* sink)
+{
+	if (sink->flush_pos == sink->write_pos)
+	{
+		return;
+	}
+	
+	STORE_RELEASE(&sink->flush_pos, sink->write_pos);
+	
+	mutexLock(&sink->mutex);
+	condSignal(&sink->flush_requested);
+	mutexUnlock(&sink->mutex);
+}
+
+// Only reached when traces outrun the destination by a whole ring
+static void waitForSpace(TraceSink* sink)
+{
+	requestFlush(sink);
+	
+	mutexLock(&sink->mutex);
+	
+	while (sink->write_pos - LOAD_ACQUIRE(&sink->read_pos) == sink->ring_size)
+	{
+		condWait(&sink->space_freed, &sink->mutex);
+	}
+	
+	mutexUnlock(&sink->mutex);
+}
+
+void traceSinkInit(SWFAppContext* app_context, const TraceSinkConfig* config)
+{
+	TraceSink* sink = (TraceSink*) HALLOC(sizeof(TraceSink));
+	memset(sink, 0, sizeof(TraceSink));
+	
+	if (config != NULL)
+	{
+		sink->config = *config;
+	}
+	
+	else
+	{
+		sink->config.destination = TRACE_TO_STDOUT;
+		sink->config.flush_policy = TRACE_FLUSH_PER_FRAME;
+	}
+	
+	app_context->trace_sink = sink;
+	
+	if (sink->config.destination == TRACE_COUNT_ONLY)
+	{
+		return;
+	}
+	
+	if (sink->config.destination == TRACE_TO_FILE)
+	{
+		sink->out = fopen(sink->config.path, "ab");
+		
+		if (sink->out == NULL)
+		{
+			fprintf(stderr, "Couldn't open trace file %s, tracing to stdout\n", sink->config.path);
+			sink->config.destination = TRACE_TO_STDOUT;
+		}
+	}
+	
+	if (sink->config.destination == TRACE_TO_STDOUT)
+	{
+		sink->out = stdout;
+	}
+	
+	if (sink->config.flush_size == 0)
+	{
+		sink->config.flush_size = DEFAULT_FLUSH_SIZE;
+	}
+	
+	sink->ring_size = DEFAULT_BUFFER_SIZE;
+	
+	while (sink->ring_size < sink->config.buffer_size)
+	{
+		sink->ring_size *= 2;
+	}
+	
+	sink->ring = (char*) HALLOC(sink->ring_size);
+	
+	mutexInit(&sink->mutex);
+	condInit(&sink->flush_requested);
+	condInit(&sink->space_freed);
+	
+	if (!threadStart(&sink->thread, writerMain, sink))
+	{
+		fprintf(stderr, "Couldn't start the trace writer thread, tracing synchronously\n");
+		
+		condDestroy(&sink->space_freed);
+		condDestroy(&sink->flush_requested);
+		mutexDestroy(&sink->mutex);
+		
+		FREE(sink->ring);
+		sink->ring = NULL;
+		sink->synchronous = 1;
+	}
+}
+
+void traceSinkShutdown(SWFAppContext* app_context)
+{
+	TraceSink* sink = app_context->trace_sink;
+	
+	if (sink == NULL)
+	{
+		return;
+	}
+	
+	if (sink->ring != NULL)
+	{
+		requestFlush(sink);
+		
+		mutexLock(&sink->mutex);
+		sink->stopping = 1;
+		condSignal(&sink->flush_requested);
+		mutexUnlock(&sink->mutex);
+		
+		threadJoin(sink->thread);
+		
+		condDestroy(&sink->space_freed);
+		condDestroy(&sink->flush_requested);
+		mutexDestroy(&sink->mutex);
+		
+		FREE(sink->ring);
+	}
+	
+	if (sink->config.destination == TRACE_TO_FILE)
+	{
+		fclose(sink->out);
+	}
+	
+	else if (sink->synchronous)
+	{
+		fflush(sink->out);
+	}
+	
+	FREE(sink);
+	app_context->trace_sink = NULL;
+}
+
+void traceSinkWrite(SWFAppContext* app_context, const char* data, size_t size)
+{
+	TraceSink* sink = app_context->trace_sink;
+	
+	if (sink == NULL)
+	{
+		fwrite(data, 1, size, stdout);
+		return;
+	}
+	
+	if (sink->synchronous)
+	{
+		writeOut(sink, data, size);
+		return;
+	}
+	
+	if (sink->ring == NULL)
+	{
+		return;
+	}
+	
+	while (size != 0)
+	{
+		u64 space = sink->ring_size - (sink->write_pos - LOAD_ACQUIRE(&sink->read_pos));
+		
+		if (space == 0)
+		{
+			waitForSpace(sink);
+			continue;
+		}
+		
+		u64 offset = sink->write_pos & (sink->ring_size - 1);
+		u64 chunk = sink->ring_size - offset;
+		
+		if (chunk > space)
+		{
+			chunk = space;
+		}
+		
+		if (chunk > size)
+		{
+			chunk = size;
+		}
+		
+		memcpy(sink->ring + offset, data, chunk);
+		
+		sink->write_pos += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+void traceSinkEndLine(SWFAppContext* app_context)
+{
+	TraceSink* sink = app_context->trace_sink;
+	
+	if (sink == NULL)
+	{
+		putchar('\n');
+		fflush(stdout);
+		
+		return;
+	}
+	
+	sink->count += 1;
+	
+	if (sink->synchronous)
+	{
+		writeOut(sink, "\n", 1);
+		return;
+	}
+	
+	if (sink->ring == NULL)
+	{
+		return;
+	}
+	
+	traceSinkWrite(app_context, "\n", 1);
+	
+	if (sink->config.flush_policy == TRACE_FLUSH_BY_SIZE &&
+	    sink->write_pos - sink->flush_pos >= sink->config.flush_size)
+	{
+		requestFlush(sink);
+	}
+}
+
+void traceSinkEndFrame(SWFAppContext* app_context)
+{
+	TraceSink* sink = app_context->trace_sink;
+	
+	if (sink == NULL || sink->config.flush_policy != TRACE_FLUSH_PER_FRAME)
+	{
+		return;
+	}
+	
+	if (sink->ring != NULL)
+	{
+		requestFlush(sink);
+	}
+	
+	else if (sink->synchronous && sink->out != NULL)
+	{
+		fflush(sink->out);
+	}
+}
+
+void traceSinkFlush(SWFAppContext* app_context)
+{
+	TraceSink* sink = app_context->trace_sink;
+	
+	if (sink == NULL)
+	{
+		return;
+	}
+	
+	if (sink->ring != NULL)
+	{
+		requestFlush(sink);
+	}
+	
+	else if (sink->synchronous && sink->out != NULL)
+	{
+		fflush(sink->out);
+	}
+}
+
+u64 traceSinkCount(SWFAppContext* app_context)
+{
+	TraceSink* sink = app_context->trace_sink;
+	
+	return sink != NULL ? sink->count : 0;
+}
+
+int traceSinkCountsOnly(SWFAppContext* app_context)
+{
+	TraceSink* sink = app_context->trace_sink;
+	
+	return sink != NULL && sink->config.destination == TRACE_COUNT_ONLY;
+}
\ No newline at end of file
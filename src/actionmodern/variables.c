@@ -1,82 +1,242 @@
 #include <string.h>
 
-#include <map.h>
 #include <common.h>
 #include <action.h>
 #include <variables.h>
+#include <intern.h>
+#include <sharedstring.h>
 #include <heap.h>
+#include <utils.h>
 
 #define VAL(type, x) *((type*) x)
 
-hashmap* var_map = NULL;
-ActionVar** var_array = NULL;
-size_t var_array_size = 0;
+void initMap(SWFAppContext* app_context)
+{
+	initInternTable(app_context);
+	initSharedStrings(app_context);
+}
+
+int initVarArray(SWFAppContext* app_context, size_t max_string_id)
+{
+	// Most constant strings never name a variable, so instead of one
+	// allocation per id this maps a single zeroed block, whose pages are
+	// only backed by memory once a variable on them is first written
+	app_context->var_array_size = max_string_id + 1;
+	app_context->var_array = (ActionVar*) vmem_reserve(app_context->var_array_size*sizeof(ActionVar));
+	
+	return app_context->var_array != NULL;
+}
+
+ActionVar* getVariableById(SWFAppContext* app_context, u32 string_id)
+{
+	if (string_id < app_context->var_array_size)
+	{
+		PROFILE_LOOKUP_COUNT(ACTION_LOOKUP_VAR_ARRAY);
+		return &app_context->var_array[string_id];
+	}
+	
+	PROFILE_LOOKUP_START(start);
+	ActionVar* var = getInternedVariable(app_context, string_id);
+	PROFILE_LOOKUP_END(ACTION_LOOKUP_INTERNED_ID, start);
+	
+	return var;
+}
+
+ActionVar* getVariableBySegments(SWFAppContext* app_context, const u64* segments, u64 num_segments, u32 length, u32 hash)
+{
+	PROFILE_LOOKUP_START(start);
+	
+	u32 string_id = internStringSegments(app_context, segments, num_segments, length, hash);
+	ActionVar* var = getInternedVariable(app_context, string_id);
+	
+	PROFILE_LOOKUP_END(ACTION_LOOKUP_BY_NAME, start);
+	
+	return var;
+}
 
-void initMap()
+ActionVar* getVariable(SWFAppContext* app_context, char* var_name, size_t key_size)
 {
-	var_map = hashmap_create();
+	u64 segment[2] = { (u64) var_name, key_size };
+	
+	return getVariableBySegments(app_context, segment, 1, (u32) key_size, hashStringSegments(segment, 1));
 }
 
-void initVarArray(SWFAppContext* app_context, size_t max_string_id)
+int deleteVariable(SWFAppContext* app_context, char* var_name, size_t key_size)
 {
-	var_array_size = max_string_id + 1;
-	var_array = (ActionVar**) HALLOC(var_array_size*sizeof(ActionVar*));
+	u64 segment[2] = { (u64) var_name, key_size };
+	ActionVar* var = removeInternedString(app_context, segment, 1, (u32) key_size, hashStringSegments(segment, 1));
 	
-	for (size_t i = 1; i < var_array_size; ++i)
+	if (var == NULL)
 	{
-		var_array[i] = (ActionVar*) HALLOC(sizeof(ActionVar));
+		return 0;
 	}
+	
+	releaseVariableString(app_context, var);
+	memset(var, 0, sizeof(ActionVar));
+	
+	return 1;
 }
 
-static int free_variable_callback(const void* key, size_t ksize, uintptr_t value, void* app_context_void)
+static void concatStringList(const u64* str_list, char* dest)
 {
-	SWFAppContext* app_context = (SWFAppContext*) app_context_void;
-	ActionVar* var = (ActionVar*) value;
+	u64 num_strings = str_list[0];
 	
-	// Free heap-allocated strings
-	if (var->type == ACTION_STACK_VALUE_STRING && var->owns_memory)
+	for (u64 i = 0; i < 2*num_strings; i += 2)
 	{
-		FREE(var->heap_ptr);
+		char* src = (char*) str_list[i + 1];
+		u64 len = str_list[i + 2];
+		memcpy(dest, src, len);
+		dest += len;
 	}
+	*dest = '\0';
+}
+
+char* materializeStringList(SWFAppContext* app_context)
+{
+	// Allocate a shared string for the concatenated result
+	char* result = allocSharedString(app_context, STACK_TOP_N + 1);
+	concatStringList((u64*) STACK_TOP_VALUE, result);
 	
-	FREE(var);
-	return 0;
+	return result;
 }
 
-ActionVar* getVariableById(SWFAppContext* app_context, u32 string_id)
+static int ownsString(ActionVar* var)
 {
-	return var_array[string_id];
+	return var->type == ACTION_STACK_VALUE_STRING && var->owns_memory;
 }
 
-ActionVar* getVariable(SWFAppContext* app_context, char* var_name, size_t key_size)
+static char* copyToSharedString(SWFAppContext* app_context, const char* str, u32 length)
 {
-	ActionVar* var;
+	char* copy = allocSharedString(app_context, length + 1);
+	memcpy(copy, str, length);
+	copy[length] = '\0';
 	
-	if (hashmap_get(var_map, var_name, key_size, (uintptr_t*) &var))
+	return copy;
+}
+
+static inline int borrowsInlineString(ActionVar* var, u64 str)
+{
+	return str >= (u64) var->inline_str && str < (u64) var->inline_str + ACTION_VAR_INLINE_SIZE;
+}
+
+// Stack slots from first_sp down borrowing the variable's inline chars,
+// directly or as list segments, are moved to a shared copy. It's
+// released right away, so it's freed once they've all been popped.
+static void evacuateInlineString(SWFAppContext* app_context, ActionVar* var, u32 first_sp)
+{
+	char* copy = NULL;
+	
+	for (u32 sp = first_sp; sp < INITIAL_SP; sp += STACK_SLOT_SIZE)
 	{
-		return var;
+		u64* value = &VAL(u64, &STACK[sp + 8]);
+		u64* segments = value;
+		u64 num_segments = 1;
+		
+		if (STACK[sp] == ACTION_STACK_VALUE_STR_LIST)
+		{
+			segments = (u64*) *value + 1;
+			num_segments = *((u64*) *value);
+		}
+		
+		else if (STACK[sp] != ACTION_STACK_VALUE_STRING)
+		{
+			continue;
+		}
+		
+		for (u64 i = 0; i < 2*num_segments; i += 2)
+		{
+			if (borrowsInlineString(var, segments[i]))
+			{
+				if (copy == NULL)
+				{
+					copy = copyToSharedString(app_context, var->inline_str, var->str_size);
+				}
+				
+				segments[i] = (u64) copy + (segments[i] - (u64) var->inline_str);
+			}
+		}
 	}
 	
-	var = (ActionVar*) HALLOC(sizeof(ActionVar));
+	if (copy != NULL)
+	{
+		releaseSharedString(app_context, copy);
+	}
+}
+
+static void releaseStringFrom(SWFAppContext* app_context, ActionVar* var, u32 first_sp)
+{
+	if (var->type != ACTION_STACK_VALUE_STRING)
+	{
+		return;
+	}
 	
-	hashmap_set(var_map, var_name, key_size, (uintptr_t) var);
+	if (var->owns_memory)
+	{
+		releaseSharedString(app_context, var->heap_ptr);
+	}
 	
-	return var;
+	// Inline chars that were never pushed can't be on the stack
+	else if (var->inline_borrowed)
+	{
+		evacuateInlineString(app_context, var, first_sp);
+	}
+	
+	var->owns_memory = false;
+	var->is_inline = false;
+	var->inline_borrowed = false;
 }
 
-char* materializeStringList(SWFAppContext* app_context)
+void releaseVariableString(SWFAppContext* app_context, ActionVar* var)
 {
-	// Get the string list
-	u64* str_list = (u64*) &STACK_TOP_VALUE;
+	releaseStringFrom(app_context, var, SP);
+}
+
+static void setInlineString(ActionVar* var, const char* chars, u32 length)
+{
+	memcpy(var->inline_str, chars, length);
+	var->inline_str[length] = '\0';
+	
+	var->type = ACTION_STACK_VALUE_STRING;
+	var->str_size = length;
+	var->string_id = 0;
+	var->is_inline = true;
+}
+
+// Handles s = s + x, where the list starts with the variable's own buffer
+// and no other variable shares it. Only the new segments are copied, and
+// the buffer grows geometrically, so building a string piece by piece is
+// linear overall. Slots that borrowed the old string still point at the
+// start of the buffer, and the append overwrites their terminator, so
+// anything reading a borrowed string has to stop at the slot's length
+// rather than at a NUL (see stringIdToNumber).
+static void appendStringList(SWFAppContext* app_context, ActionVar* var)
+{
+	u64* str_list = (u64*) STACK_TOP_VALUE;
 	u64 num_strings = str_list[0];
 	u32 total_size = STACK_TOP_N;
 	
-	// Allocate heap memory for concatenated result
-	char* result = (char*) HALLOC(total_size + 1);
+	char* buffer = var->heap_ptr;
+	char* old_buffer = NULL;
 	
-	// Concatenate all strings
-	char* dest = result;
-	for (u64 i = 0; i < 2*num_strings; i += 2)
+	if (total_size + 1 > sharedStringCapacity(buffer))
+	{
+		u32 capacity = 2*sharedStringCapacity(buffer);
+		
+		if (capacity < total_size + 1)
+		{
+			capacity = total_size + 1;
+		}
+		
+		buffer = allocSharedString(app_context, capacity);
+		memcpy(buffer, var->heap_ptr, var->str_size);
+		
+		old_buffer = var->heap_ptr;
+	}
+	
+	// Later segments may point into the old buffer too (s = s + x + s),
+	// so it's only released once everything is copied
+	char* dest = buffer + var->str_size;
+	for (u64 i = 2; i < 2*num_strings; i += 2)
 	{
 		char* src = (char*) str_list[i + 1];
 		u64 len = str_list[i + 2];
@@ -85,71 +245,147 @@ char* materializeStringList(SWFAppContext* app_context)
 	}
 	*dest = '\0';
 	
-	return result;
+	if (old_buffer != NULL)
+	{
+		releaseSharedString(app_context, old_buffer);
+	}
+	
+	var->heap_ptr = buffer;
+	var->str_size = total_size;
 }
 
 void setVariableWithValue(SWFAppContext* app_context, ActionVar* var)
 {
-	// Free old string if variable owns memory
-	if (var->type == ACTION_STACK_VALUE_STRING && var->owns_memory)
-	{
-		FREE(var->heap_ptr);
-		var->owns_memory = false;
-	}
-	
 	ActionStackValueType type = STACK_TOP_TYPE;
 	
+	// The value slot is popped once it's stored, so only the slots under
+	// it can go on borrowing the old inline chars
+	u32 below_sp = SP_SECOND_TOP;
+	
 	if (type == ACTION_STACK_VALUE_STR_LIST)
 	{
-		// Materialize string to heap
-		char* heap_str = materializeStringList(app_context);
+		u64* str_list = (u64*) STACK_TOP_VALUE;
 		u32 total_size = STACK_TOP_N;
 		
+		if (ownsString(var) &&
+		    isUniqueSharedString(var->heap_ptr) &&
+		    (char*) str_list[1] == var->heap_ptr &&
+		    str_list[2] == var->str_size)
+		{
+			appendStringList(app_context, var);
+			return;
+		}
+		
+		// Short results are kept inline with no allocation. The list may
+		// point into the variable's own chars, so it's joined first.
+		if (total_size < ACTION_VAR_INLINE_SIZE)
+		{
+			char chars[ACTION_VAR_INLINE_SIZE];
+			concatStringList(str_list, chars);
+			
+			releaseStringFrom(app_context, var, below_sp);
+			setInlineString(var, chars, total_size);
+			
+			return;
+		}
+		
+		// Materialize string to heap, before releasing the old one since
+		// the list may still point into it
+		char* heap_str = materializeStringList(app_context);
+		
+		releaseStringFrom(app_context, var, below_sp);
+		
 		var->type = ACTION_STACK_VALUE_STRING;
 		var->str_size = total_size;
+		var->string_id = 0;
 		var->heap_ptr = heap_str;
 		var->owns_memory = true;
 	}
 	
+	else if (type == ACTION_STACK_VALUE_STRING && STACK_TOP_ID == 0)
+	{
+		char* str = (char*) STACK_TOP_VALUE;
+		u32 length = STACK_TOP_N;
+		
+		// Assigning a variable its own string (s = s)
+		if ((var->owns_memory && str == var->heap_ptr) || (var->is_inline && str == var->inline_str))
+		{
+			return;
+		}
+		
+		// Copying a shared string only takes another reference
+		if (isSharedString(app_context, str))
+		{
+			retainSharedString(str);
+			releaseStringFrom(app_context, var, below_sp);
+			
+			var->type = ACTION_STACK_VALUE_STRING;
+			var->str_size = length;
+			var->string_id = 0;
+			var->heap_ptr = str;
+			var->owns_memory = true;
+			
+			return;
+		}
+		
+		// Anything else without an id is a conversion buffer or another
+		// variable's inline chars, which don't outlive the script or
+		// that variable, so it's copied
+		char chars[ACTION_VAR_INLINE_SIZE];
+		
+		if (length < ACTION_VAR_INLINE_SIZE)
+		{
+			memcpy(chars, str, length);
+			
+			releaseStringFrom(app_context, var, below_sp);
+			setInlineString(var, chars, length);
+			
+			return;
+		}
+		
+		str = copyToSharedString(app_context, str, length);
+		releaseStringFrom(app_context, var, below_sp);
+		
+		var->type = ACTION_STACK_VALUE_STRING;
+		var->str_size = length;
+		var->string_id = 0;
+		var->heap_ptr = str;
+		var->owns_memory = true;
+	}
+	
 	else
 	{
-		// Numeric types and regular strings - store directly
+		releaseStringFrom(app_context, var, below_sp);
+		
+		// Numeric types and constant strings - store directly
 		var->type = type;
 		var->str_size = STACK_TOP_N;
+		var->string_id = type == ACTION_STACK_VALUE_STRING ? STACK_TOP_ID : 0;
 		var->value = STACK_TOP_VALUE;
 	}
 }
 
 void freeMap(SWFAppContext* app_context)
 {
-	// Free hashmap-based variables
-	if (var_map)
-	{
-		hashmap_iterate(var_map, free_variable_callback, app_context);
-		hashmap_free(var_map);
-		var_map = NULL;
-	}
+	// Release array-based variables, the intern table releases dynamic ones
+	ActionVar* var_array = app_context->var_array;
 	
-	// Free array-based variables
 	if (var_array)
 	{
-		for (size_t i = 1; i < var_array_size; i++)
+		for (size_t i = 1; i < app_context->var_array_size; i++)
 		{
-			if (var_array[i])
+			if (var_array[i].type == ACTION_STACK_VALUE_STRING &&
+			    var_array[i].owns_memory)
 			{
-				// Free heap-allocated strings
-				if (var_array[i]->type == ACTION_STACK_VALUE_STRING &&
-				    var_array[i]->owns_memory)
-				{
-					FREE(var_array[i]->heap_ptr);
-				}
-				
-				FREE(var_array[i]);
+				releaseSharedString(app_context, var_array[i].heap_ptr);
 			}
 		}
 		
-		FREE(var_array);
-		var_array = NULL;
-		var_array_size = 0;
+		vmem_release((char*) var_array, app_context->var_array_size*sizeof(ActionVar));
+		app_context->var_array = NULL;
+		app_context->var_array_size = 0;
 	}
+	
+	freeInternTable(app_context);
+	freeSharedStrings(app_context);
 }
\ No newline at end of file
@@ -7,7 +7,25 @@
 #include <heap.h>
 #include <utils.h>
 
-int once = 0;
+#if defined(_MSC_VER)
+#include <windows.h>
+
+static SRWLOCK sdl_lock = SRWLOCK_INIT;
+
+#define sdlLock() AcquireSRWLockExclusive(&sdl_lock);
+#define sdlUnlock() ReleaseSRWLockExclusive(&sdl_lock);
+#else
+#include <pthread.h>
+
+static pthread_mutex_t sdl_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define sdlLock() pthread_mutex_lock(&sdl_lock);
+#define sdlUnlock() pthread_mutex_unlock(&sdl_lock);
+#endif
+
+// SDL is process-wide, so it's initialized for the first instance using
+// it and shut down after the last
+static u32 sdl_users = 0;
 
 const float identity[16] =
 {
@@ -55,13 +73,17 @@ const float identity_cxform[20] =
 
 void flashbang_init(FlashbangContext* context, SWFAppContext* app_context)
 {
-	if (!once && !SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD))
+	sdlLock();
+	
+	if (sdl_users == 0 && !SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD))
 	{
 		SDL_Log("Failed to initialize SDL: %s", SDL_GetError());
 		exit(EXIT_FAILURE);
 	}
 	
-	once = 1;
+	sdl_users += 1;
+	
+	sdlUnlock();
 	
 	context->current_bitmap = 0;
 	
@@ -1011,7 +1033,16 @@ void flashbang_release(FlashbangContext* context, SWFAppContext* app_context)
 	// destroy the GPU device
 	SDL_DestroyGPUDevice(context->device);
 	
-	// destroy SDL
-	SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD);
-	SDL_Quit();
+	// destroy SDL, once no other instance uses it
+	sdlLock();
+	
+	sdl_users -= 1;
+	
+	if (sdl_users == 0)
+	{
+		SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD);
+		SDL_Quit();
+	}
+	
+	sdlUnlock();
 }
\ No newline at end of file
@@ -1,60 +1,66 @@
+#include <string.h>
+
 #include <swf.h>
 #include <tag.h>
 #include <action.h>
 #include <variables.h>
+#include <number.h>
 #include <flashbang.h>
+#include <tracesink.h>
+#include <frameclock.h>
+#include <actionstack.h>
+#include <timeline.h>
 #include <heap.h>
 #include <utils.h>
 
-int quit_swf;
-int bad_poll;
-size_t next_frame;
-int manual_next_frame;
-ActionVar* temp_val;
-
-Character* dictionary = NULL;
-
-DisplayObject* display_list = NULL;
-size_t max_depth = 0;
-
-FlashbangContext* context;
-
 void tagInit();
 
-void tagMain(SWFAppContext* app_context)
+// Everything that reserves address space goes first, so running out of
+// it fails creation instead of the first push or variable write
+static int reserveInstance(SWFAppContext* app_context)
 {
-	frame_func* frame_funcs = app_context->frame_funcs;
-	
-	while (!quit_swf)
+	if (!heap_init(app_context, HEAP_SIZE))
 	{
-		frame_funcs[next_frame](app_context);
-		if (!manual_next_frame)
-		{
-			next_frame += 1;
-		}
-		manual_next_frame = 0;
-		
-		bad_poll |= flashbang_poll();
-		quit_swf |= bad_poll;
+		return 0;
 	}
 	
-	if (bad_poll)
+	if (!initActionStack(app_context))
 	{
-		return;
+		heap_shutdown(app_context);
+		return 0;
 	}
 	
-	while (!flashbang_poll())
+	if (!initVarArray(app_context, app_context->max_string_id))
 	{
-		tagShowFrame(app_context);
+		freeActionStack(app_context);
+		heap_shutdown(app_context);
+		return 0;
 	}
+	
+	return 1;
 }
 
-void swfStart(SWFAppContext* app_context)
+int swfCreate(SWFAppContext* app_context)
 {
-	heap_init(app_context, HEAP_SIZE);
+	memset(&app_context->run_stats, 0, sizeof(SWFRunStats));
 	
-	FlashbangContext c;
-	context = &c;
+	if (!reserveInstance(app_context))
+	{
+		fprintf(stderr, "Couldn't reserve memory for a new instance\n");
+		app_context->run_stats.stop_reason = SWF_STOP_CREATE_FAILED;
+		
+		return 0;
+	}
+	
+	traceSinkInit(app_context, app_context->trace_config);
+	
+	if (app_context->timeline_path != NULL)
+	{
+		timelineStart(app_context->timeline_path, app_context->timeline_on_signal);
+	}
+	
+	FlashbangContext* context = (FlashbangContext*) HALLOC(sizeof(FlashbangContext));
+	app_context->flashbang = context;
 	
 	context->width = app_context->width;
 	context->height = app_context->height;
@@ -80,35 +86,149 @@ void swfStart(SWFAppContext* app_context)
 	context->cxform_data = app_context->cxform_data;
 	context->cxform_data_size = app_context->cxform_data_size;
 	
+	TIMELINE_BEGIN(flashbang_init_start);
 	flashbang_init(context, app_context);
+	TIMELINE_END(flashbang_init_start, "flashbang_init");
 	
-	dictionary = HALLOC(INITIAL_DICTIONARY_CAPACITY*sizeof(Character));
-	display_list = HALLOC(INITIAL_DISPLAYLIST_CAPACITY*sizeof(DisplayObject));
+	TIMELINE_BEGIN(runtime_init_start);
 	
-	STACK = (char*) HALLOC(INITIAL_STACK_SIZE);
-	SP = INITIAL_SP;
+	app_context->dictionary = HALLOC(INITIAL_DICTIONARY_CAPACITY*sizeof(Character));
+	app_context->dictionary_capacity = INITIAL_DICTIONARY_CAPACITY;
+	app_context->max_char_id = 0;
+	app_context->display_list = HALLOC(INITIAL_DISPLAYLIST_CAPACITY*sizeof(DisplayObject));
+	app_context->display_list_capacity = INITIAL_DISPLAYLIST_CAPACITY;
+	app_context->max_depth = 0;
 	
-	quit_swf = 0;
-	bad_poll = 0;
-	next_frame = 0;
+	app_context->str_list_arena = (u64*) HALLOC(STR_LIST_ARENA_SIZE);
+	app_context->str_list_top = 0;
+	app_context->str_list_last = 0;
 	
-	initVarArray(app_context, app_context->max_string_id);
+	app_context->quit_swf = 0;
+	app_context->bad_poll = 0;
+	app_context->next_frame = 0;
+	app_context->manual_next_frame = 0;
+	app_context->temp_val = NULL;
 	
-	initTime();
-	initMap();
+	initNumberCache(app_context, app_context->max_string_id);
+
+#ifdef SWF_OP_PAIR_PROFILE
+	opProfileInit(app_context);
+#endif
+
+#ifdef SWF_OP_CYCLE_PROFILE
+	opCycleProfileInit(app_context);
+#endif
 	
+	initFrameClock(app_context);
+	initMap(app_context);
+	
+	TIMELINE_END(runtime_init_start, "runtime init");
+	
+	TIMELINE_BEGIN(tag_init_start);
 	tagInit(app_context);
+	TIMELINE_END(tag_init_start, "tagInit");
 	
-	tagMain(app_context);
+	return 1;
+}
+
+size_t swfStepFrames(SWFAppContext* app_context, size_t n)
+{
+	// Overflow reports and stack commits on Windows go by the instance
+	// bound to the thread, and hosts interleave instances on one thread
+	bindActionStack(app_context);
+	
+	frame_func* frame_funcs = app_context->frame_funcs;
+	size_t frames = 0;
 	
+	while (frames < n && !app_context->quit_swf)
+	{
+		PROFILE_FRAME_BOUNDARY();
+		frameClockBeginFrame(app_context);
+		app_context->current_frame = app_context->next_frame;
+		
+		TIMELINE_BEGIN(frame_start);
+		frame_funcs[app_context->next_frame](app_context);
+		timelineEnd("frame", frame_start, app_context->current_frame);
+		
+		traceSinkEndFrame(app_context);
+		timelinePoll();
+		
+		if (!app_context->manual_next_frame)
+		{
+			app_context->next_frame += 1;
+		}
+		app_context->manual_next_frame = 0;
+		
+		frames += 1;
+	}
+	
+	return frames;
+}
+
+void swfRender(SWFAppContext* app_context)
+{
+	tagDrawFrame(app_context);
+}
+
+void swfDestroy(SWFAppContext* app_context)
+{
 	freeMap(app_context);
+
+#ifdef SWF_OP_PAIR_PROFILE
+	opProfileShutdown(app_context, stderr, 64);
+#endif
+
+#ifdef SWF_OP_CYCLE_PROFILE
+	opCycleProfileShutdown(app_context, stderr);
+#endif
+	
+	freeNumberCache(app_context);
+	FREE(app_context->str_list_arena);
+	freeActionStack(app_context);
 	
-	FREE(STACK);
+	FREE(app_context->dictionary);
+	FREE(app_context->display_list);
 	
-	FREE(dictionary);
-	FREE(display_list);
+	flashbang_release(app_context->flashbang, app_context);
+	FREE(app_context->flashbang);
+	app_context->flashbang = NULL;
 	
-	flashbang_release(context, app_context);
+	if (app_context->timeline_path != NULL)
+	{
+		timelineStop();
+	}
 	
+	traceSinkShutdown(app_context);
 	heap_shutdown(app_context);
+}
+
+void swfStart(SWFAppContext* app_context)
+{
+	if (!swfCreate(app_context))
+	{
+		return;
+	}
+	
+	
+	while (!app_context->quit_swf)
+	{
+		swfStepFrames(app_context, 1);
+		
+		TIMELINE_BEGIN(poll_start);
+		app_context->bad_poll |= flashbang_poll();
+		TIMELINE_END(poll_start, "flashbang_poll");
+		
+		app_context->quit_swf |= app_context->bad_poll;
+	}
+	
+	// Keep showing the last frame until the window is closed
+	if (!app_context->bad_poll)
+	{
+		while (!flashbang_poll())
+		{
+			swfRender(app_context);
+		}
+	}
+	
+	swfDestroy(app_context);
 }
\ No newline at end of file
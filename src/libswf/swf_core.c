@@ -1,82 +1,293 @@
+#include <string.h>
+
 #include <swf.h>
 #include <tag.h>
 #include <action.h>
 #include <variables.h>
+#include <number.h>
+#include <tracesink.h>
+#include <frameclock.h>
+#include <actionstack.h>
+#include <timeline.h>
 #include <heap.h>
 #include <utils.h>
 
-// Core runtime state - exported
-char* stack = NULL;
-u32 sp = 0;
-u32 oldSP = 0;
+#define DEFAULT_MAX_FRAMES 10000
 
-int quit_swf = 0;
-int bad_poll = 0;
-size_t next_frame = 0;
-int manual_next_frame = 0;
-ActionVar* temp_val = NULL;
+static const char* stop_reasons[] =
+{
+	[SWF_STOP_QUIT] = "quit",
+	[SWF_STOP_END] = "end",
+	[SWF_STOP_FRAME_BUDGET] = "frame_budget",
+	[SWF_STOP_TIME_BUDGET] = "time_budget",
+	[SWF_STOP_CREATE_FAILED] = "create_failed",
+};
 
-// Console-only swfStart implementation
-void swfStart(SWFAppContext* app_context)
+static void writeRunStats(SWFAppContext* app_context)
 {
-	printf("=== SWF Execution Started (NO_GRAPHICS mode) ===\n");
+	SWFRunStats* stats = &app_context->run_stats;
+	FILE* out = stdout;
+	
+	if (strcmp(app_context->stats_path, "-") != 0)
+	{
+		out = fopen(app_context->stats_path, "wb");
+		
+		if (out == NULL)
+		{
+			fprintf(stderr, "Couldn't open stats file %s\n", app_context->stats_path);
+			return;
+		}
+	}
 	
-	heap_init(app_context, HEAP_SIZE);
+	double wall_s = stats->wall_ns/1e9;
 	
-	// Allocate stack
-	stack = (char*) HALLOC(INITIAL_STACK_SIZE);
-	sp = INITIAL_SP;
+	fprintf(out, "{\n");
+	fprintf(out, "  \"stop_reason\": \"%s\",\n", stop_reasons[stats->stop_reason]);
+	fprintf(out, "  \"frames\": %llu,\n", (unsigned long long) stats->frames);
+	fprintf(out, "  \"wall_ms\": %.3f,\n", stats->wall_ns/1e6);
+	fprintf(out, "  \"script_ms\": %.3f,\n", stats->script_ns/1e6);
+	fprintf(out, "  \"frames_per_sec\": %.1f,\n", wall_s > 0 ? stats->frames/wall_s : 0.0);
+	fprintf(out, "  \"allocations\": %llu,\n", (unsigned long long) stats->allocs);
+	fprintf(out, "  \"frees\": %llu,\n", (unsigned long long) stats->frees);
+	fprintf(out, "  \"peak_heap_bytes\": %llu,\n", (unsigned long long) stats->peak_heap_bytes);
+	fprintf(out, "  \"traces\": %llu\n", (unsigned long long) stats->traces);
+	fprintf(out, "}\n");
 	
-	// Initialize subsystems
-	quit_swf = 0;
-	bad_poll = 0;
-	next_frame = 0;
-	manual_next_frame = 0;
+	if (out != stdout)
+	{
+		fclose(out);
+	}
+}
+
+// Everything that reserves address space goes first, so running out of
+// it fails creation instead of the first push or variable write
+static int reserveInstance(SWFAppContext* app_context)
+{
+	if (!heap_init(app_context, HEAP_SIZE))
+	{
+		return 0;
+	}
 	
-	initTime();
-	initMap();
-	tagInit();
+	if (!initActionStack(app_context))
+	{
+		heap_shutdown(app_context);
+		return 0;
+	}
+	
+	if (!initVarArray(app_context, app_context->max_string_id))
+	{
+		freeActionStack(app_context);
+		heap_shutdown(app_context);
+		return 0;
+	}
 	
-	// Run frames in console mode
-	frame_func* funcs = app_context->frame_funcs;
-	size_t current_frame = 0;
-	const size_t max_frames = 10000;
+	return 1;
+}
+
+int swfCreate(SWFAppContext* app_context)
+{
+	memset(&app_context->run_stats, 0, sizeof(SWFRunStats));
 	
-	while (!quit_swf && current_frame < max_frames)
+	if (!reserveInstance(app_context))
 	{
-		printf("\n[Frame %zu]\n", current_frame);
+		fprintf(stderr, "Couldn't reserve memory for a new instance\n");
+		app_context->run_stats.stop_reason = SWF_STOP_CREATE_FAILED;
 		
-#ifdef NDEBUG
-		if (funcs[current_frame])
-		{
+		return 0;
+	}
+	
+	if (!app_context->quiet)
+	{
+		printf("=== SWF Execution Started (NO_GRAPHICS mode) ===\n");
+	}
+	
+	traceSinkInit(app_context, app_context->trace_config);
+	
+	if (app_context->timeline_path != NULL)
+	{
+		timelineStart(app_context->timeline_path, app_context->timeline_on_signal);
+	}
+	
+	app_context->str_list_arena = (u64*) HALLOC(STR_LIST_ARENA_SIZE);
+	app_context->str_list_top = 0;
+	app_context->str_list_last = 0;
+	
+	initNumberCache(app_context, app_context->max_string_id);
+	
+	// Initialize subsystems
+	app_context->quit_swf = 0;
+	app_context->bad_poll = 0;
+	app_context->next_frame = 0;
+	app_context->manual_next_frame = 0;
+	app_context->temp_val = NULL;
+	
+	initFrameClock(app_context);
+	initMap(app_context);
+	tagInit(app_context);
+
+#ifdef SWF_OP_PAIR_PROFILE
+	opProfileInit(app_context);
 #endif
-			funcs[current_frame](app_context);
-#ifdef NDEBUG
-		}
-		
-		else
-		{
-			printf("No function for frame %zu, stopping.\n", current_frame);
-			break;
-		}
+
+#ifdef SWF_OP_CYCLE_PROFILE
+	opCycleProfileInit(app_context);
 #endif
-		if (manual_next_frame)
+	
+	if (app_context->max_frames == 0)
+	{
+		app_context->max_frames = DEFAULT_MAX_FRAMES;
+	}
+	
+	app_context->run_stats.stop_reason = SWF_STOP_QUIT;
+	app_context->run_start_ns = get_elapsed_ns();
+	
+	return 1;
+}
+
+static int runFrame(SWFAppContext* app_context)
+{
+	SWFRunStats* stats = &app_context->run_stats;
+	size_t current_frame = app_context->next_frame;
+	
+	if (app_context->quit_swf)
+	{
+		return 0;
+	}
+	
+	if (stats->frames == app_context->max_frames)
+	{
+		stats->stop_reason = SWF_STOP_FRAME_BUDGET;
+		return 0;
+	}
+	
+	if (app_context->max_run_ms != 0 && stats->wall_ns >= (u64) app_context->max_run_ms*1000000)
+	{
+		stats->stop_reason = SWF_STOP_TIME_BUDGET;
+		return 0;
+	}
+	
+	// Through the sink so the header stays in order with the traces
+	char line[64];
+	int length;
+	
+	if (!app_context->quiet)
+	{
+		length = snprintf(line, sizeof(line), "\n[Frame %zu]\n", current_frame);
+		traceSinkWrite(app_context, line, length);
+	}
+
+#ifdef NDEBUG
+	if (app_context->frame_funcs[current_frame] == NULL)
+	{
+		if (!app_context->quiet)
 		{
-			current_frame = next_frame;
-			manual_next_frame = 0;
+			length = snprintf(line, sizeof(line), "No function for frame %zu, stopping.\n", current_frame);
+			traceSinkWrite(app_context, line, length);
 		}
 		
-		else
-		{
-			current_frame++;
-		}
+		stats->stop_reason = SWF_STOP_END;
+		return 0;
 	}
+#endif
+	
+	PROFILE_FRAME_BOUNDARY();
+	frameClockBeginFrame(app_context);
+	app_context->current_frame = current_frame;
+	
+	TIMELINE_BEGIN(frame_start);
+	u64 script_start = get_elapsed_ns();
+	
+	app_context->frame_funcs[current_frame](app_context);
+	
+	u64 now = get_elapsed_ns();
+	timelineEnd("frame", frame_start, current_frame);
+	
+	stats->script_ns += now - script_start;
+	stats->wall_ns = now - app_context->run_start_ns;
+	stats->frames += 1;
+	
+	traceSinkEndFrame(app_context);
+	timelinePoll();
 	
-	printf("\n=== SWF Execution Completed ===\n");
+	if (!app_context->manual_next_frame)
+	{
+		app_context->next_frame += 1;
+	}
+	app_context->manual_next_frame = 0;
+	
+	return 1;
+}
+
+size_t swfStepFrames(SWFAppContext* app_context, size_t n)
+{
+	// Overflow reports and stack commits on Windows go by the instance
+	// bound to the thread, and hosts interleave instances on one thread
+	bindActionStack(app_context);
+	
+	size_t frames = 0;
+	
+	while (frames < n && runFrame(app_context))
+	{
+		frames += 1;
+	}
+	
+	return frames;
+}
+
+void swfDestroy(SWFAppContext* app_context)
+{
+	SWFRunStats* stats = &app_context->run_stats;
+	
+	stats->wall_ns = get_elapsed_ns() - app_context->run_start_ns;
+	stats->traces = traceSinkCount(app_context);
+	
+	if (app_context->timeline_path != NULL)
+	{
+		timelineStop();
+	}
+	
+	traceSinkShutdown(app_context);
+	
+	if (!app_context->quiet)
+	{
+		printf("\n=== SWF Execution Completed ===\n");
+	}
 	
 	// Cleanup
-	freeMap();
-	FREE(stack);
+#ifdef SWF_OP_PAIR_PROFILE
+	opProfileShutdown(app_context, stderr, 64);
+#endif
+
+#ifdef SWF_OP_CYCLE_PROFILE
+	opCycleProfileShutdown(app_context, stderr);
+#endif
+	
+	freeMap(app_context);
+	freeNumberCache(app_context);
+	FREE(app_context->str_list_arena);
+	freeActionStack(app_context);
+	
+	stats->allocs = app_context->heap_allocs;
+	stats->frees = app_context->heap_frees;
+	stats->peak_heap_bytes = heap_peak_allocated(app_context);
+	
+	if (app_context->stats_path != NULL)
+	{
+		writeRunStats(app_context);
+	}
 	
 	heap_shutdown(app_context);
+}
+
+// Console-only swfStart implementation, runs frames as fast as it can
+// until the movie quits or a budget runs out
+void swfStart(SWFAppContext* app_context)
+{
+	if (!swfCreate(app_context))
+	{
+		return;
+	}
+	
+	swfStepFrames(app_context, SIZE_MAX);
+	swfDestroy(app_context);
 }
\ No newline at end of file
@@ -0,0 +1,367 @@
+#include <string.h>
+
+#include <swfpool.h>
+
+#define INITIAL_QUEUE_CAPACITY 64
+
+#if defined(_MSC_VER)
+// Microsoft
+
+#include <windows.h>
+
+typedef HANDLE PoolThread;
+typedef CRITICAL_SECTION PoolMutex;
+typedef CONDITION_VARIABLE PoolCond;
+
+#define THREAD_FUNC(name) static DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN return 0;
+
+#define LOAD_ACQUIRE(p) ((u32) InterlockedCompareExchange((volatile LONG*) (p), 0, 0))
+#define ATOMIC_INC(p) ((u32) InterlockedIncrement((volatile LONG*) (p)))
+#define ATOMIC_DEC(p) InterlockedDecrement((volatile LONG*) (p));
+
+#define mutexInit(m) InitializeCriticalSection(m);
+#define mutexDestroy(m) DeleteCriticalSection(m);
+#define mutexLock(m) EnterCriticalSection(m);
+#define mutexUnlock(m) LeaveCriticalSection(m);
+#define condInit(c) InitializeConditionVariable(c);
+#define condDestroy(c)
+#define condWait(c, m) SleepConditionVariableCS(c, m, INFINITE);
+#define condSignal(c) WakeConditionVariable(c);
+#define condBroadcast(c) WakeAllConditionVariable(c);
+#define threadStart(t, func, arg) *(t) = CreateThread(NULL, 0, func, arg, 0, NULL);
+#define threadJoin(t) WaitForSingleObject(t, INFINITE); CloseHandle(t);
+
+static u32 countCores()
+{
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	
+	return si.dwNumberOfProcessors;
+}
+
+#else
+// POSIX
+
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t PoolThread;
+typedef pthread_mutex_t PoolMutex;
+typedef pthread_cond_t PoolCond;
+
+#define THREAD_FUNC(name) static void* name(void* arg)
+#define THREAD_RETURN return NULL;
+
+#define LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define ATOMIC_INC(p) __atomic_add_fetch(p, 1, __ATOMIC_ACQ_REL)
+#define ATOMIC_DEC(p) __atomic_sub_fetch(p, 1, __ATOMIC_ACQ_REL);
+
+#define mutexInit(m) pthread_mutex_init(m, NULL);
+#define mutexDestroy(m) pthread_mutex_destroy(m);
+#define mutexLock(m) pthread_mutex_lock(m);
+#define mutexUnlock(m) pthread_mutex_unlock(m);
+#define condInit(c) pthread_cond_init(c, NULL);
+#define condDestroy(c) pthread_cond_destroy(c);
+#define condWait(c, m) pthread_cond_wait(c, m);
+#define condSignal(c) pthread_cond_signal(c);
+#define condBroadcast(c) pthread_cond_broadcast(c);
+#define threadStart(t, func, arg) pthread_create(t, NULL, func, arg);
+#define threadJoin(t) pthread_join(t, NULL);
+
+static u32 countCores()
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	
+	return cores > 0 ? (u32) cores : 1;
+}
+
+#endif
+
+typedef struct
+{
+	SWFAppContext* app_context;
+	SWFDoneCallback done;
+	void* user;
+} PoolTask;
+
+// The owner pushes and pops at tail, thieves take from head. Positions
+// only grow and index tasks masked by capacity - 1.
+typedef struct
+{
+	PoolMutex mutex;
+	PoolTask** tasks;
+	u32 capacity;
+	u32 head;
+	u32 tail;
+} TaskQueue;
+
+typedef struct
+{
+	SWFPool* pool;
+	u32 index;
+	TaskQueue queue;
+	PoolThread thread;
+} PoolWorker;
+
+struct SWFPool
+{
+	PoolWorker* workers;
+	u32 num_workers;
+	u32 next_worker;
+	
+	// Tasks waiting in any queue, so idle workers know when to sleep
+	u32 queued;
+	
+	// Submitted and not done yet, only touched with mutex held
+	u64 remaining;
+	
+	PoolMutex mutex;
+	PoolCond work_available;
+	PoolCond all_done;
+	int stopping;
+};
+
+static void queuePush(TaskQueue* queue, PoolTask* task)
+{
+	mutexLock(&queue->mutex);
+	
+	if (queue->tail - queue->head == queue->capacity)
+	{
+		PoolTask** tasks = (PoolTask**) malloc(2*queue->capacity*sizeof(PoolTask*));
+		
+		for (u32 i = queue->head; i != queue->tail; ++i)
+		{
+			tasks[i & (2*queue->capacity - 1)] = queue->tasks[i & (queue->capacity - 1)];
+		}
+		
+		free(queue->tasks);
+		queue->tasks = tasks;
+		queue->capacity *= 2;
+	}
+	
+	queue->tasks[queue->tail & (queue->capacity - 1)] = task;
+	queue->tail += 1;
+	
+	mutexUnlock(&queue->mutex);
+}
+
+static PoolTask* queuePopNewest(TaskQueue* queue)
+{
+	PoolTask* task = NULL;
+	
+	mutexLock(&queue->mutex);
+	
+	if (queue->tail != queue->head)
+	{
+		queue->tail -= 1;
+		task = queue->tasks[queue->tail & (queue->capacity - 1)];
+	}
+	
+	mutexUnlock(&queue->mutex);
+	
+	return task;
+}
+
+static PoolTask* queuePopOldest(TaskQueue* queue)
+{
+	PoolTask* task = NULL;
+	
+	mutexLock(&queue->mutex);
+	
+	if (queue->tail != queue->head)
+	{
+		task = queue->tasks[queue->head & (queue->capacity - 1)];
+		queue->head += 1;
+	}
+	
+	mutexUnlock(&queue->mutex);
+	
+	return task;
+}
+
+static PoolTask* takeTask(PoolWorker* worker)
+{
+	SWFPool* pool = worker->pool;
+	PoolTask* task = queuePopNewest(&worker->queue);
+	
+	// Start with the next worker along, so thieves spread out
+	for (u32 i = 1; task == NULL && i < pool->num_workers; ++i)
+	{
+		task = queuePopOldest(&pool->workers[(worker->index + i) % pool->num_workers].queue);
+	}
+	
+	if (task != NULL)
+	{
+		ATOMIC_DEC(&pool->queued);
+	}
+	
+	return task;
+}
+
+static void runTask(SWFPool* pool, PoolTask* task)
+{
+	SWFAppContext* app_context = task->app_context;
+	
+	if (swfCreate(app_context))
+	{
+		swfStepFrames(app_context, SIZE_MAX);
+		swfDestroy(app_context);
+	}
+	
+	if (task->done != NULL)
+	{
+		task->done(app_context, task->user);
+	}
+	
+	free(task);
+	
+	mutexLock(&pool->mutex);
+	
+	pool->remaining -= 1;
+	
+	if (pool->remaining == 0)
+	{
+		condBroadcast(&pool->all_done);
+	}
+	
+	mutexUnlock(&pool->mutex);
+}
+
+THREAD_FUNC(workerMain)
+{
+	PoolWorker* worker = (PoolWorker*) arg;
+	SWFPool* pool = worker->pool;
+	
+	while (1)
+	{
+		PoolTask* task = takeTask(worker);
+		
+		if (task != NULL)
+		{
+			runTask(pool, task);
+			continue;
+		}
+		
+		mutexLock(&pool->mutex);
+		
+		while (!pool->stopping && LOAD_ACQUIRE(&pool->queued) == 0)
+		{
+			condWait(&pool->work_available, &pool->mutex);
+		}
+		
+		int stopping = pool->stopping && LOAD_ACQUIRE(&pool->queued) == 0;
+		
+		mutexUnlock(&pool->mutex);
+		
+		if (stopping)
+		{
+			break;
+		}
+	}
+	
+	THREAD_RETURN
+}
+
+SWFPool* swfPoolCreate(u32 num_workers)
+{
+	SWFPool* pool = (SWFPool*) malloc(sizeof(SWFPool));
+	memset(pool, 0, sizeof(SWFPool));
+	
+	pool->num_workers = num_workers != 0 ? num_workers : countCores();
+	pool->workers = (PoolWorker*) malloc(pool->num_workers*sizeof(PoolWorker));
+	memset(pool->workers, 0, pool->num_workers*sizeof(PoolWorker));
+	
+	mutexInit(&pool->mutex);
+	condInit(&pool->work_available);
+	condInit(&pool->all_done);
+	
+	for (u32 i = 0; i < pool->num_workers; ++i)
+	{
+		PoolWorker* worker = &pool->workers[i];
+		
+		worker->pool = pool;
+		worker->index = i;
+		worker->queue.capacity = INITIAL_QUEUE_CAPACITY;
+		worker->queue.tasks = (PoolTask**) malloc(INITIAL_QUEUE_CAPACITY*sizeof(PoolTask*));
+		
+		mutexInit(&worker->queue.mutex);
+	}
+	
+	for (u32 i = 0; i < pool->num_workers; ++i)
+	{
+		threadStart(&pool->workers[i].thread, workerMain, &pool->workers[i]);
+	}
+	
+	return pool;
+}
+
+void swfPoolSubmit(SWFPool* pool, SWFAppContext* app_context, SWFDoneCallback done, void* user)
+{
+	PoolTask* task = (PoolTask*) malloc(sizeof(PoolTask));
+	task->app_context = app_context;
+	task->done = done;
+	task->user = user;
+	
+	mutexLock(&pool->mutex);
+	pool->remaining += 1;
+	mutexUnlock(&pool->mutex);
+	
+	// Round robin, so a batch submitted at once starts spread out
+	u32 index = ATOMIC_INC(&pool->next_worker) % pool->num_workers;
+	
+	// Counted before it's visible, so a worker taking it right away never
+	// takes queued below zero. A worker that sees the count first only
+	// goes round its loop again until the push lands.
+	ATOMIC_INC(&pool->queued);
+	queuePush(&pool->workers[index].queue, task);
+	
+	mutexLock(&pool->mutex);
+	condSignal(&pool->work_available);
+	mutexUnlock(&pool->mutex);
+}
+
+void swfPoolWait(SWFPool* pool)
+{
+	mutexLock(&pool->mutex);
+	
+	while (pool->remaining != 0)
+	{
+		condWait(&pool->all_done, &pool->mutex);
+	}
+	
+	mutexUnlock(&pool->mutex);
+}
+
+void swfPoolDestroy(SWFPool* pool)
+{
+	swfPoolWait(pool);
+	
+	mutexLock(&pool->mutex);
+	pool->stopping = 1;
+	condBroadcast(&pool->work_available);
+	mutexUnlock(&pool->mutex);
+	
+	for (u32 i = 0; i < pool->num_workers; ++i)
+	{
+		threadJoin(pool->workers[i].thread);
+	}
+	
+	for (u32 i = 0; i < pool->num_workers; ++i)
+	{
+		mutexDestroy(&pool->workers[i].queue.mutex);
+		free(pool->workers[i].queue.tasks);
+	}
+	
+	condDestroy(&pool->all_done);
+	condDestroy(&pool->work_available);
+	mutexDestroy(&pool->mutex);
+	
+	free(pool->workers);
+	free(pool);
+}
+
+u32 swfPoolWorkerCount(SWFPool* pool)
+{
+	return pool->num_workers;
+}
\ No newline at end of file
@@ -0,0 +1,890 @@
+#include <string.h>
+
+#include <swfsnapshot.h>
+#include <action.h>
+#include <variables.h>
+#include <intern.h>
+#include <sharedstring.h>
+#include <actionstack.h>
+#include <heap.h>
+#include <utils.h>
+
+#define SNAPSHOT_MAGIC 0x53465753  // "SWFS"
+#define SNAPSHOT_VERSION 1
+
+#define INITIAL_IMAGE_CAPACITY 4096
+
+#define VAR_OWNS_MEMORY 1
+#define VAR_IS_INLINE 2
+#define VAR_INLINE_BORROWED 4
+
+// Where a pointer written to an image points
+typedef enum
+{
+	PTR_NULL,
+	PTR_EXECUTABLE,
+	PTR_SHARED_STRING,
+	PTR_VAR_ARRAY,
+	PTR_INTERNED_VAR,
+} SnapshotPtrKind;
+
+typedef struct
+{
+	u32 magic;
+	u32 version;
+	
+	// Offset of frame_funcs from snapshot_anchor, which only matches
+	// between instances of the same executable
+	s64 frame_funcs_offset;
+	u64 max_string_id;
+	
+	u64 next_frame;
+	u64 current_frame;
+	u64 clock_frames;
+	u64 frame_time_ns;
+	u32 quit_swf;
+	
+	u32 num_shared_strings;
+	u32 num_interned;
+	u32 num_vars;
+	u32 num_slots;
+	u32 reserved;
+	u64 num_characters;
+	u64 num_display_objects;
+} SnapshotHeader;
+
+typedef struct
+{
+	char* data;
+	size_t size;
+	size_t capacity;
+} ImageWriter;
+
+typedef struct
+{
+	const char* pos;
+	const char* end;
+	int failed;
+} ImageReader;
+
+typedef struct
+{
+	SWFAppContext* app_context;
+	
+	// Every live shared string, sorted by address while saving and in
+	// image order while restoring
+	char** shared;
+	u32 num_shared;
+	
+	int failed;
+} SnapshotState;
+
+// Constant strings live in the executable, which is only ever moved as a
+// whole, so their offset from here is the same in every process
+static const char snapshot_anchor[1] = { 0 };
+
+static void writeBytes(ImageWriter* writer, const void* src, size_t size)
+{
+	// An empty dictionary or display list is NULL, which memcpy can't take
+	if (size == 0)
+	{
+		return;
+	}
+	
+	if (writer->size + size > writer->capacity)
+	{
+		size_t capacity = writer->capacity == 0 ? INITIAL_IMAGE_CAPACITY : 2*writer->capacity;
+		
+		while (writer->size + size > capacity)
+		{
+			capacity *= 2;
+		}
+		
+		writer->data = (char*) realloc(writer->data, capacity);
+		writer->capacity = capacity;
+	}
+	
+	memcpy(writer->data + writer->size, src, size);
+	writer->size += size;
+}
+
+static void writeU32(ImageWriter* writer, u32 value)
+{
+	writeBytes(writer, &value, sizeof(u32));
+}
+
+static void writeU64(ImageWriter* writer, u64 value)
+{
+	writeBytes(writer, &value, sizeof(u64));
+}
+
+static void readBytes(ImageReader* reader, void* dest, size_t size)
+{
+	if (reader->failed || (size_t) (reader->end - reader->pos) < size)
+	{
+		reader->failed = 1;
+		memset(dest, 0, size);
+		
+		return;
+	}
+	
+	memcpy(dest, reader->pos, size);
+	reader->pos += size;
+}
+
+static u32 readU32(ImageReader* reader)
+{
+	u32 value;
+	readBytes(reader, &value, sizeof(u32));
+	
+	return value;
+}
+
+static u64 readU64(ImageReader* reader)
+{
+	u64 value;
+	readBytes(reader, &value, sizeof(u64));
+	
+	return value;
+}
+
+static int compareAddresses(const void* a, const void* b)
+{
+	uintptr_t x = (uintptr_t) *((char* const*) a);
+	uintptr_t y = (uintptr_t) *((char* const*) b);
+	
+	return (x > y) - (x < y);
+}
+
+static void addSharedString(SnapshotState* state, ActionVar* var)
+{
+	if (var->type == ACTION_STACK_VALUE_STRING && var->owns_memory)
+	{
+		state->shared[state->num_shared] = var->heap_ptr;
+		state->num_shared += 1;
+	}
+}
+
+// Only variables hold shared strings, and the stack borrows from them or
+// from the queue of released ones it still uses, so this finds them all
+static void collectSharedStrings(SnapshotState* state)
+{
+	SWFAppContext* app_context = state->app_context;
+	u32 num_interned = internedStringCount(app_context);
+	
+	size_t max_shared = app_context->var_array_size + num_interned + app_context->num_dead_strings;
+	state->shared = (char**) malloc(max_shared*sizeof(char*) + 1);
+	state->num_shared = 0;
+	
+	for (size_t i = 1; i < app_context->var_array_size; ++i)
+	{
+		addSharedString(state, &app_context->var_array[i]);
+	}
+	
+	for (u32 i = 0; i < num_interned; ++i)
+	{
+		addSharedString(state, getInternedVariable(app_context, (u32) app_context->max_string_id + 1 + i));
+	}
+	
+	for (u32 i = 0; i < app_context->num_dead_strings; ++i)
+	{
+		char* str = app_context->dead_strings[i];
+		
+		if ((SHARED_STRING_HEADER(str)->refcount & SHARED_STRING_COUNT_MASK) == 0)
+		{
+			state->shared[state->num_shared] = str;
+			state->num_shared += 1;
+		}
+	}
+	
+	qsort(state->shared, state->num_shared, sizeof(char*), compareAddresses);
+	
+	u32 num_unique = 0;
+	
+	for (u32 i = 0; i < state->num_shared; ++i)
+	{
+		if (num_unique == 0 || state->shared[i] != state->shared[num_unique - 1])
+		{
+			state->shared[num_unique] = state->shared[i];
+			num_unique += 1;
+		}
+	}
+	
+	state->num_shared = num_unique;
+}
+
+// Returns the index of the shared string ptr points into, or -1
+static s64 findSharedString(SnapshotState* state, const char* ptr)
+{
+	u32 low = 0;
+	u32 high = state->num_shared;
+	
+	// Finds the first string starting after ptr
+	while (low < high)
+	{
+		u32 mid = low + (high - low)/2;
+		
+		if (state->shared[mid] <= ptr)
+		{
+			low = mid + 1;
+		}
+		
+		else
+		{
+			high = mid;
+		}
+	}
+	
+	if (low == 0 || ptr > state->shared[low - 1] + sharedStringCapacity(state->shared[low - 1]))
+	{
+		return -1;
+	}
+	
+	return low - 1;
+}
+
+static void writePtr(SnapshotState* state, ImageWriter* writer, const char* ptr)
+{
+	SWFAppContext* app_context = state->app_context;
+	const char* var_array = (const char*) app_context->var_array;
+	
+	u32 kind;
+	u32 index = 0;
+	u64 offset = 0;
+	
+	if (ptr == NULL)
+	{
+		kind = PTR_NULL;
+	}
+	
+	else if (ptr >= var_array && ptr < var_array + app_context->var_array_size*sizeof(ActionVar))
+	{
+		kind = PTR_VAR_ARRAY;
+		offset = ptr - var_array;
+	}
+	
+	else if (isSharedString(app_context, ptr))
+	{
+		s64 found = findSharedString(state, ptr);
+		
+		if (found < 0)
+		{
+			fprintf(stderr, "Snapshot found a heap pointer that isn't into a shared string\n");
+			state->failed = 1;
+			
+			return;
+		}
+		
+		kind = PTR_SHARED_STRING;
+		index = (u32) found;
+		offset = ptr - state->shared[found];
+	}
+	
+	else if ((index = findInternedVariable(app_context, ptr)) != 0)
+	{
+		kind = PTR_INTERNED_VAR;
+		offset = ptr - (const char*) getInternedVariable(app_context, index);
+	}
+	
+	else
+	{
+		kind = PTR_EXECUTABLE;
+		offset = (u64) (ptr - snapshot_anchor);
+	}
+	
+	writeU32(writer, kind);
+	writeU32(writer, index);
+	writeU64(writer, offset);
+}
+
+static char* readPtr(SnapshotState* state, ImageReader* reader)
+{
+	SWFAppContext* app_context = state->app_context;
+	
+	u32 kind = readU32(reader);
+	u32 index = readU32(reader);
+	u64 offset = readU64(reader);
+	
+	switch (kind)
+	{
+		case PTR_NULL:
+		{
+			return NULL;
+		}
+		
+		case PTR_EXECUTABLE:
+		{
+			return (char*) snapshot_anchor + (s64) offset;
+		}
+		
+		case PTR_SHARED_STRING:
+		{
+			if (index < state->num_shared && offset <= sharedStringCapacity(state->shared[index]))
+			{
+				return state->shared[index] + offset;
+			}
+			
+			break;
+		}
+		
+		case PTR_VAR_ARRAY:
+		{
+			if (offset < app_context->var_array_size*sizeof(ActionVar))
+			{
+				return (char*) app_context->var_array + offset;
+			}
+			
+			break;
+		}
+		
+		case PTR_INTERNED_VAR:
+		{
+			u64 first_id = app_context->max_string_id + 1;
+			
+			if (index >= first_id && index < first_id + internedStringCount(app_context) && offset < sizeof(ActionVar))
+			{
+				return (char*) getInternedVariable(app_context, index) + offset;
+			}
+			
+			break;
+		}
+	}
+	
+	reader->failed = 1;
+	
+	return NULL;
+}
+
+static void writeVar(SnapshotState* state, ImageWriter* writer, ActionVar* var)
+{
+	u32 flags = (var->owns_memory ? VAR_OWNS_MEMORY : 0) | (var->is_inline ? VAR_IS_INLINE : 0) |
+	            (var->inline_borrowed ? VAR_INLINE_BORROWED : 0);
+	
+	writeU32(writer, var->type);
+	writeU32(writer, var->str_size);
+	writeU32(writer, var->string_id);
+	writeU32(writer, flags);
+	
+	if (var->is_inline)
+	{
+		writeBytes(writer, var->inline_str, ACTION_VAR_INLINE_SIZE);
+	}
+	
+	else if (var->type == ACTION_STACK_VALUE_STRING)
+	{
+		writePtr(state, writer, (char*) var->value);
+	}
+	
+	else
+	{
+		writeU64(writer, var->value);
+	}
+}
+
+// Reference counts come from the shared string table, so the variable
+// takes over the reference without retaining it
+static void readVar(SnapshotState* state, ImageReader* reader, ActionVar* var)
+{
+	memset(var, 0, sizeof(ActionVar));
+	
+	var->type = (ActionStackValueType) readU32(reader);
+	var->str_size = readU32(reader);
+	var->string_id = readU32(reader);
+	
+	u32 flags = readU32(reader);
+	var->owns_memory = (flags & VAR_OWNS_MEMORY) != 0;
+	var->is_inline = (flags & VAR_IS_INLINE) != 0;
+	var->inline_borrowed = (flags & VAR_INLINE_BORROWED) != 0;
+	
+	if (var->is_inline)
+	{
+		readBytes(reader, var->inline_str, ACTION_VAR_INLINE_SIZE);
+	}
+	
+	else if (var->type == ACTION_STACK_VALUE_STRING)
+	{
+		var->value = (u64) readPtr(state, reader);
+	}
+	
+	else
+	{
+		var->value = readU64(reader);
+	}
+	
+	// Left empty so it's safe to free
+	if (reader->failed)
+	{
+		memset(var, 0, sizeof(ActionVar));
+	}
+}
+
+static void writeSharedStrings(SnapshotState* state, ImageWriter* writer)
+{
+	for (u32 i = 0; i < state->num_shared; ++i)
+	{
+		char* str = state->shared[i];
+		u32 length = (u32) strlen(str);
+		
+		writeU32(writer, SHARED_STRING_HEADER(str)->refcount & SHARED_STRING_COUNT_MASK);
+		writeU32(writer, sharedStringCapacity(str));
+		writeU32(writer, length);
+		writeBytes(writer, str, length);
+	}
+}
+
+static void readSharedStrings(SnapshotState* state, ImageReader* reader, u32 num_shared)
+{
+	SWFAppContext* app_context = state->app_context;
+	
+	state->shared = (char**) malloc(num_shared*sizeof(char*) + 1);
+	state->num_shared = 0;
+	
+	for (u32 i = 0; i < num_shared && !reader->failed; ++i)
+	{
+		u32 refcount = readU32(reader);
+		u32 capacity = readU32(reader);
+		u32 length = readU32(reader);
+		
+		if (length >= capacity || (size_t) (reader->end - reader->pos) < length)
+		{
+			reader->failed = 1;
+			break;
+		}
+		
+		char* str = allocSharedString(app_context, capacity);
+		readBytes(reader, str, length);
+		str[length] = '\0';
+		
+		state->shared[i] = str;
+		state->num_shared += 1;
+		
+		// Strings only the stack still uses go back on the queue
+		if (refcount == 0)
+		{
+			releaseSharedString(app_context, str);
+		}
+		
+		else
+		{
+			SHARED_STRING_HEADER(str)->refcount = refcount;
+		}
+	}
+}
+
+// Ids are handed out in order while a table has no free ones, so
+// interning the strings again by id, with free ids reserved in between,
+// gives each its old id. The free list follows, in the order it's used.
+static void writeInternedStrings(SnapshotState* state, ImageWriter* writer)
+{
+	SWFAppContext* app_context = state->app_context;
+	u32 num_interned = internedStringCount(app_context);
+	
+	for (u32 i = 0; i < num_interned; ++i)
+	{
+		u32 string_id = (u32) app_context->max_string_id + 1 + i;
+		u32 length;
+		const char* chars = getInternedString(app_context, string_id, &length);
+		
+		writeU32(writer, chars != NULL);
+		
+		if (chars != NULL)
+		{
+			writeU32(writer, length);
+			writeBytes(writer, chars, length);
+			writeVar(state, writer, getInternedVariable(app_context, string_id));
+		}
+	}
+	
+	for (u32 string_id = nextFreeInternedId(app_context, 0); string_id != 0; string_id = nextFreeInternedId(app_context, string_id))
+	{
+		writeU32(writer, string_id);
+	}
+	
+	writeU32(writer, 0);
+}
+
+static void readInternedStrings(SnapshotState* state, ImageReader* reader, u32 num_interned)
+{
+	SWFAppContext* app_context = state->app_context;
+	u32 first_id = (u32) app_context->max_string_id + 1;
+	
+	for (u32 i = 0; i < num_interned && !reader->failed; ++i)
+	{
+		u32 string_id;
+		
+		if (readU32(reader) == 0)
+		{
+			string_id = reserveInternedId(app_context);
+		}
+		
+		else
+		{
+			u32 length = readU32(reader);
+			
+			if ((size_t) (reader->end - reader->pos) < length)
+			{
+				reader->failed = 1;
+				break;
+			}
+			
+			u64 segment[2] = { (u64) reader->pos, length };
+			string_id = internStringSegments(app_context, segment, 1, length, hashStringSegments(segment, 1));
+			
+			reader->pos += length;
+			readVar(state, reader, getInternedVariable(app_context, string_id));
+		}
+		
+		if (string_id != first_id + i)
+		{
+			reader->failed = 1;
+			break;
+		}
+	}
+	
+	// Each free id once, pushed in reverse so the list comes out in order
+	u32* free_ids = (u32*) malloc(num_interned*sizeof(u32) + 1);
+	u8* listed = (u8*) calloc(num_interned + 1, 1);
+	u32 num_free = 0;
+	
+	for (u32 string_id = readU32(reader); string_id != 0 && !reader->failed; string_id = readU32(reader))
+	{
+		u32 length;
+		
+		if (string_id < first_id || string_id - first_id >= num_interned || listed[string_id - first_id] ||
+		    getInternedString(app_context, string_id, &length) != NULL)
+		{
+			reader->failed = 1;
+			break;
+		}
+		
+		listed[string_id - first_id] = 1;
+		free_ids[num_free] = string_id;
+		num_free += 1;
+	}
+	
+	for (u32 i = num_free; i > 0 && !reader->failed; --i)
+	{
+		freeInternedId(app_context, free_ids[i - 1]);
+	}
+	
+	free(listed);
+	free(free_ids);
+}
+
+static u32 writeVarArray(SnapshotState* state, ImageWriter* writer)
+{
+	SWFAppContext* app_context = state->app_context;
+	ActionVar empty;
+	memset(&empty, 0, sizeof(ActionVar));
+	
+	u32 num_vars = 0;
+	
+	for (size_t i = 1; i < app_context->var_array_size; ++i)
+	{
+		ActionVar* var = &app_context->var_array[i];
+		
+		if (memcmp(var, &empty, sizeof(ActionVar)) == 0)
+		{
+			continue;
+		}
+		
+		writeU32(writer, (u32) i);
+		writeVar(state, writer, var);
+		num_vars += 1;
+	}
+	
+	return num_vars;
+}
+
+static void readVarArray(SnapshotState* state, ImageReader* reader, u32 num_vars)
+{
+	SWFAppContext* app_context = state->app_context;
+	
+	for (u32 i = 0; i < num_vars && !reader->failed; ++i)
+	{
+		u32 string_id = readU32(reader);
+		
+		if (string_id == 0 || string_id >= app_context->var_array_size)
+		{
+			reader->failed = 1;
+			break;
+		}
+		
+		ActionVar* var = &app_context->var_array[string_id];
+		releaseVariableString(app_context, var);
+		readVar(state, reader, var);
+	}
+}
+
+// Slots are written bottom up. A string list is written out with its
+// segments, and rebuilt on restore in the same LIFO order as the slots.
+static u32 writeStack(SnapshotState* state, ImageWriter* writer)
+{
+	SWFAppContext* app_context = state->app_context;
+	u32 num_slots = 0;
+	
+	for (u32 sp = INITIAL_SP - STACK_SLOT_SIZE; sp >= SP && sp < INITIAL_SP; sp -= STACK_SLOT_SIZE)
+	{
+		u64 value = VAL(u64, &STACK[sp + 8]);
+		
+		writeU32(writer, VAL(u32, &STACK[sp]));
+		writeU32(writer, VAL(u32, &STACK[sp + 4]));
+		
+		if (STACK[sp] == ACTION_STACK_VALUE_STRING)
+		{
+			writePtr(state, writer, (char*) value);
+		}
+		
+		else if (STACK[sp] == ACTION_STACK_VALUE_STR_LIST)
+		{
+			u64* str_list = (u64*) value;
+			
+			writeU64(writer, str_list[-1]);
+			writeU64(writer, str_list[0]);
+			
+			for (u64 i = 0; i < 2*str_list[0]; i += 2)
+			{
+				writePtr(state, writer, (char*) str_list[i + 1]);
+				writeU64(writer, str_list[i + 2]);
+			}
+		}
+		
+		else
+		{
+			writeU64(writer, value);
+		}
+		
+		num_slots += 1;
+	}
+	
+	return num_slots;
+}
+
+static void readStack(SnapshotState* state, ImageReader* reader, u32 num_slots)
+{
+	SWFAppContext* app_context = state->app_context;
+	u64* arena = app_context->str_list_arena;
+	
+	if ((u64) num_slots*STACK_SLOT_SIZE > INITIAL_SP - ACTION_STACK_GUARD_SIZE)
+	{
+		reader->failed = 1;
+		return;
+	}
+	
+	for (u32 i = 0; i < num_slots && !reader->failed; ++i)
+	{
+		u32 head = readU32(reader);
+		u32 length = readU32(reader);
+		u8 type = (u8) head;
+		u64 value;
+		
+		if (type == ACTION_STACK_VALUE_STRING)
+		{
+			value = (u64) readPtr(state, reader);
+		}
+		
+		else if (type == ACTION_STACK_VALUE_STR_LIST)
+		{
+			u64 hash_word = readU64(reader);
+			u64 num_strings = readU64(reader);
+			
+			u32 base = app_context->str_list_top;
+			u64 top = base + STR_LIST_HEADER_SIZE + 1 + 2*num_strings;
+			
+			if (num_strings > STR_LIST_ARENA_SIZE/sizeof(u64) || top > STR_LIST_ARENA_SIZE/sizeof(u64))
+			{
+				reader->failed = 1;
+				break;
+			}
+			
+			arena[base] = app_context->str_list_last;
+			arena[base + 1] = SP - STACK_SLOT_SIZE;
+			arena[base + 2] = hash_word;
+			
+			u64* str_list = &arena[base + STR_LIST_HEADER_SIZE];
+			str_list[0] = num_strings;
+			
+			for (u64 j = 0; j < 2*num_strings; j += 2)
+			{
+				str_list[j + 1] = (u64) readPtr(state, reader);
+				str_list[j + 2] = readU64(reader);
+			}
+			
+			app_context->str_list_last = base;
+			app_context->str_list_top = (u32) top;
+			
+			value = (u64) str_list;
+		}
+		
+		else
+		{
+			value = readU64(reader);
+		}
+		
+		if (reader->failed)
+		{
+			break;
+		}
+		
+		SP -= STACK_SLOT_SIZE;
+		VAL(u32, &STACK[SP]) = head;
+		VAL(u32, &STACK[SP + 4]) = length;
+		VAL(u64, &STACK[SP + 8]) = value;
+	}
+}
+
+size_t swfSnapshot(SWFAppContext* app_context, char** image)
+{
+	SnapshotState state;
+	memset(&state, 0, sizeof(SnapshotState));
+	state.app_context = app_context;
+	
+	// Whatever is still queued after this is used by the stack
+	reclaimSharedStrings(app_context);
+	collectSharedStrings(&state);
+	
+	SnapshotHeader header;
+	memset(&header, 0, sizeof(SnapshotHeader));
+	
+	header.magic = SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+	header.frame_funcs_offset = (s64) ((const char*) app_context->frame_funcs - snapshot_anchor);
+	header.max_string_id = app_context->max_string_id;
+	
+	header.next_frame = app_context->next_frame;
+	header.current_frame = app_context->current_frame;
+	header.clock_frames = app_context->clock_frames;
+	header.frame_time_ns = app_context->frame_time_ns;
+	header.quit_swf = app_context->quit_swf;
+	
+	header.num_shared_strings = state.num_shared;
+	header.num_interned = internedStringCount(app_context);
+	header.num_characters = app_context->dictionary != NULL ? app_context->max_char_id + 1 : 0;
+	header.num_display_objects = app_context->display_list != NULL ? app_context->max_depth + 1 : 0;
+	
+	// The header goes first, once the counts below are known
+	ImageWriter writer;
+	memset(&writer, 0, sizeof(ImageWriter));
+	writeBytes(&writer, &header, sizeof(SnapshotHeader));
+	
+	writeSharedStrings(&state, &writer);
+	writeInternedStrings(&state, &writer);
+	header.num_vars = writeVarArray(&state, &writer);
+	header.num_slots = writeStack(&state, &writer);
+	
+	writeBytes(&writer, app_context->dictionary, header.num_characters*sizeof(Character));
+	writeBytes(&writer, app_context->display_list, header.num_display_objects*sizeof(DisplayObject));
+	
+	memcpy(writer.data, &header, sizeof(SnapshotHeader));
+	
+	free(state.shared);
+	
+	if (state.failed)
+	{
+		free(writer.data);
+		*image = NULL;
+		
+		return 0;
+	}
+	
+	*image = writer.data;
+	
+	return writer.size;
+}
+
+// Grows a dictionary or display list until index fits
+static void ensureCapacity(SWFAppContext* app_context, char** ptr, size_t* capacity, size_t index, size_t elem_size)
+{
+	while (index >= *capacity)
+	{
+		grow_ptr(app_context, ptr, capacity, elem_size);
+	}
+}
+
+int swfRestore(SWFAppContext* app_context, const char* image, size_t size)
+{
+	ImageReader reader = { image, image + size, 0 };
+	
+	SnapshotHeader header;
+	readBytes(&reader, &header, sizeof(SnapshotHeader));
+	
+	if (reader.failed || header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION)
+	{
+		fprintf(stderr, "Not a snapshot image, or from another version\n");
+		return 0;
+	}
+	
+	if (header.frame_funcs_offset != (s64) ((const char*) app_context->frame_funcs - snapshot_anchor) ||
+	    header.max_string_id != app_context->max_string_id)
+	{
+		fprintf(stderr, "Snapshot was taken by another executable\n");
+		return 0;
+	}
+	
+	if (internedStringCount(app_context) != 0 || SP != INITIAL_SP || app_context->str_list_top != 0)
+	{
+		fprintf(stderr, "Snapshots can only be restored into a new instance\n");
+		return 0;
+	}
+	
+	if ((header.num_characters != 0 && app_context->dictionary == NULL) ||
+	    (header.num_display_objects != 0 && app_context->display_list == NULL))
+	{
+		fprintf(stderr, "Snapshot has a display list but this instance doesn't\n");
+		return 0;
+	}
+	
+	// Restoring may touch stack pages not committed yet
+	bindActionStack(app_context);
+	
+	SnapshotState state;
+	memset(&state, 0, sizeof(SnapshotState));
+	state.app_context = app_context;
+	
+	readSharedStrings(&state, &reader, header.num_shared_strings);
+	readInternedStrings(&state, &reader, header.num_interned);
+	readVarArray(&state, &reader, header.num_vars);
+	readStack(&state, &reader, header.num_slots);
+	
+	free(state.shared);
+	
+	size_t remaining = reader.end - reader.pos;
+	
+	if (header.num_characters > remaining/sizeof(Character) ||
+	    header.num_display_objects > remaining/sizeof(DisplayObject))
+	{
+		reader.failed = 1;
+	}
+	
+	if (header.num_characters != 0 && !reader.failed)
+	{
+		ensureCapacity(app_context, (char**) &app_context->dictionary, &app_context->dictionary_capacity, header.num_characters - 1, sizeof(Character));
+		readBytes(&reader, app_context->dictionary, header.num_characters*sizeof(Character));
+		app_context->max_char_id = header.num_characters - 1;
+	}
+	
+	if (header.num_display_objects != 0 && !reader.failed)
+	{
+		ensureCapacity(app_context, (char**) &app_context->display_list, &app_context->display_list_capacity, header.num_display_objects - 1, sizeof(DisplayObject));
+		readBytes(&reader, app_context->display_list, header.num_display_objects*sizeof(DisplayObject));
+		app_context->max_depth = header.num_display_objects - 1;
+	}
+	
+	if (reader.failed || reader.pos != reader.end)
+	{
+		fprintf(stderr, "Snapshot image is damaged\n");
+		return 0;
+	}
+	
+	app_context->next_frame = header.next_frame;
+	app_context->current_frame = header.current_frame;
+	app_context->quit_swf = header.quit_swf;
+	app_context->manual_next_frame = 0;
+	
+	// getTimer carries on from the time saved
+	app_context->clock_frames = header.clock_frames;
+	app_context->frame_time_ns = header.frame_time_ns;
+	app_context->clock_start_ns = app_context->virtual_time ? 0 : get_elapsed_ns() - header.frame_time_ns;
+	
+	return 1;
+}
\ No newline at end of file
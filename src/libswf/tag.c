@@ -2,31 +2,43 @@
 #include <tag.h>
 #include <flashbang.h>
 #include <utils.h>
+#include <timeline.h>
 
-extern FlashbangContext* context;
-
-size_t dictionary_capacity = INITIAL_DICTIONARY_CAPACITY;
-size_t display_list_capacity = INITIAL_DISPLAYLIST_CAPACITY;
-
-void tagSetBackgroundColor(u8 red, u8 green, u8 blue)
+void tagSetBackgroundColor(SWFAppContext* app_context, u8 red, u8 green, u8 blue)
 {
-	flashbang_set_window_background(context, red, green, blue);
+	flashbang_set_window_background(app_context->flashbang, red, green, blue);
 }
 
 void tagShowFrame(SWFAppContext* app_context)
 {
+	if (!app_context->host_renders)
+	{
+		tagDrawFrame(app_context);
+	}
+}
+
+void tagDrawFrame(SWFAppContext* app_context)
+{
+	FlashbangContext* context = app_context->flashbang;
+	
+	TIMELINE_BEGIN(show_start);
+	
+	TIMELINE_BEGIN(open_start);
 	flashbang_open_pass(context);
+	TIMELINE_END(open_start, "flashbang_open_pass");
 	
-	for (size_t i = 1; i <= max_depth; ++i)
+	TIMELINE_BEGIN(draw_start);
+	
+	for (size_t i = 1; i <= app_context->max_depth; ++i)
 	{
-		DisplayObject* obj = &display_list[i];
+		DisplayObject* obj = &app_context->display_list[i];
 		
 		if (obj->char_id == 0)
 		{
 			continue;
 		}
 		
-		Character* ch = &dictionary[obj->char_id];
+		Character* ch = &app_context->dictionary[obj->char_id];
 		
 		switch (ch->type)
 		{
@@ -45,48 +57,74 @@ void tagShowFrame(SWFAppContext* app_context)
 		}
 	}
 	
+	TIMELINE_END(draw_start, "display list");
+	
+	TIMELINE_BEGIN(close_start);
 	flashbang_close_pass(context);
+	TIMELINE_END(close_start, "flashbang_close_pass");
+	
+	TIMELINE_END(show_start, "tagShowFrame");
 }
 
 void tagDefineShape(SWFAppContext* app_context, CharacterType type, size_t char_id, size_t shape_offset, size_t shape_size)
 {
-	ENSURE_SIZE(dictionary, char_id, dictionary_capacity, sizeof(Character));
+	ENSURE_SIZE(app_context->dictionary, char_id, app_context->dictionary_capacity, sizeof(Character));
+	
+	Character* ch = &app_context->dictionary[char_id];
+	
+	ch->type = type;
+	ch->shape_offset = shape_offset;
+	ch->size = shape_size;
 	
-	dictionary[char_id].type = type;
-	dictionary[char_id].shape_offset = shape_offset;
-	dictionary[char_id].size = shape_size;
+	if (char_id > app_context->max_char_id)
+	{
+		app_context->max_char_id = char_id;
+	}
 }
 
 void tagDefineText(SWFAppContext* app_context, size_t char_id, size_t text_start, size_t text_size, u32 transform_start, u32 cxform_id)
 {
-	ENSURE_SIZE(dictionary, char_id, dictionary_capacity, sizeof(Character));
+	ENSURE_SIZE(app_context->dictionary, char_id, app_context->dictionary_capacity, sizeof(Character));
 	
-	dictionary[char_id].type = CHAR_TYPE_TEXT;
-	dictionary[char_id].text_start = text_start;
-	dictionary[char_id].text_size = text_size;
-	dictionary[char_id].transform_start = transform_start;
-	dictionary[char_id].cxform_id = cxform_id;
+	Character* ch = &app_context->dictionary[char_id];
+	
+	ch->type = CHAR_TYPE_TEXT;
+	ch->text_start = text_start;
+	ch->text_size = text_size;
+	ch->transform_start = transform_start;
+	ch->cxform_id = cxform_id;
+	
+	if (char_id > app_context->max_char_id)
+	{
+		app_context->max_char_id = char_id;
+	}
 }
 
 void tagPlaceObject2(SWFAppContext* app_context, size_t depth, size_t char_id, u32 transform_id)
 {
-	ENSURE_SIZE(display_list, depth, display_list_capacity, sizeof(DisplayObject));
+	ENSURE_SIZE(app_context->display_list, depth, app_context->display_list_capacity, sizeof(DisplayObject));
+	
+	DisplayObject* obj = &app_context->display_list[depth];
 	
-	display_list[depth].char_id = char_id;
-	display_list[depth].transform_id = transform_id;
+	obj->char_id = char_id;
+	obj->transform_id = transform_id;
 	
-	if (depth > max_depth)
+	if (depth > app_context->max_depth)
 	{
-		max_depth = depth;
+		app_context->max_depth = depth;
 	}
 }
 
-void defineBitmap(size_t offset, size_t size, u32 width, u32 height)
+void defineBitmap(SWFAppContext* app_context, size_t offset, size_t size, u32 width, u32 height)
 {
-	flashbang_upload_bitmap(context, offset, size, width, height);
+	TIMELINE_BEGIN(upload_start);
+	flashbang_upload_bitmap(app_context->flashbang, offset, size, width, height);
+	TIMELINE_END(upload_start, "bitmap upload");
 }
 
-void finalizeBitmaps()
+void finalizeBitmaps(SWFAppContext* app_context)
 {
-	flashbang_finalize_bitmaps(context);
+	TIMELINE_BEGIN(finalize_start);
+	flashbang_finalize_bitmaps(app_context->flashbang);
+	TIMELINE_END(finalize_start, "finalize bitmaps");
 }
\ No newline at end of file
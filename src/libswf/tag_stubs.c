@@ -1,39 +1,70 @@
+#include <stdarg.h>
+
 #include <common.h>
 #include <tag.h>
+#include <tracesink.h>
 
 // Stub implementations for console-only mode
 // Note: tagInit() is provided by the generated tagMain.c file
 
-void tagSetBackgroundColor(u8 red, u8 green, u8 blue)
+// Through the sink so tag lines stay in order with the traces
+static void tagLog(SWFAppContext* app_context, const char* format, ...)
+{
+	if (app_context->quiet)
+	{
+		return;
+	}
+	
+	char line[128];
+	
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	
+	if (length < 0)
+	{
+		return;
+	}
+	
+	if ((size_t) length >= sizeof(line))
+	{
+		length = sizeof(line) - 1;
+	}
+	
+	traceSinkWrite(app_context, line, length);
+}
+
+void tagSetBackgroundColor(SWFAppContext* app_context, u8 red, u8 green, u8 blue)
 {
-	printf("[Tag] SetBackgroundColor(%d, %d, %d)\n", red, green, blue);
+	tagLog(app_context, "[Tag] SetBackgroundColor(%d, %d, %d)\n", red, green, blue);
 }
 
-void tagShowFrame()
+void tagShowFrame(SWFAppContext* app_context)
 {
-	printf("[Tag] ShowFrame()\n");
+	tagLog(app_context, "[Tag] ShowFrame()\n");
 }
 
 // Stubs for graphics-only tags - should not be called in NO_GRAPHICS mode
 // but if they are, we provide empty implementations
 #ifdef INCLUDE_GRAPHICS_STUBS
-void tagDefineShape(size_t char_id, size_t shape_offset, size_t shape_size)
+void tagDefineShape(SWFAppContext* app_context, CharacterType type, size_t char_id, size_t shape_offset, size_t shape_size)
 {
-	printf("[Tag] DefineShape(char_id=%zu) [ignored in NO_GRAPHICS mode]\n", char_id);
+	tagLog(app_context, "[Tag] DefineShape(char_id=%zu) [ignored in NO_GRAPHICS mode]\n", char_id);
 }
 
-void tagPlaceObject2(size_t depth, size_t char_id, u32 transform_id)
+void tagPlaceObject2(SWFAppContext* app_context, size_t depth, size_t char_id, u32 transform_id)
 {
-	printf("[Tag] PlaceObject2(depth=%zu, char_id=%zu) [ignored in NO_GRAPHICS mode]\n", depth, char_id);
+	tagLog(app_context, "[Tag] PlaceObject2(depth=%zu, char_id=%zu) [ignored in NO_GRAPHICS mode]\n", depth, char_id);
 }
 
-void defineBitmap(size_t offset, size_t size, u32 width, u32 height)
+void defineBitmap(SWFAppContext* app_context, size_t offset, size_t size, u32 width, u32 height)
 {
-	printf("[Tag] DefineBitmap(width=%u, height=%u) [ignored in NO_GRAPHICS mode]\n", width, height);
+	tagLog(app_context, "[Tag] DefineBitmap(width=%u, height=%u) [ignored in NO_GRAPHICS mode]\n", width, height);
 }
 
-void finalizeBitmaps()
+void finalizeBitmaps(SWFAppContext* app_context)
 {
-	printf("[Tag] FinalizeBitmaps() [ignored in NO_GRAPHICS mode]\n");
+	tagLog(app_context, "[Tag] FinalizeBitmaps() [ignored in NO_GRAPHICS mode]\n");
 }
 #endif
\ No newline at end of file
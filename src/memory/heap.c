@@ -3,24 +3,43 @@
 #include <heap.h>
 #include <utils.h>
 
-void heap_init(SWFAppContext* app_context, size_t size)
+int heap_init(SWFAppContext* app_context, size_t size)
 {
 	char* h = vmem_reserve(size);
+	
+	if (h == NULL)
+	{
+		return 0;
+	}
+	
 	app_context->heap = h;
 	app_context->heap_size = size;
 	app_context->heap_instance = o1heapInit(h, size);
+	app_context->heap_allocs = 0;
+	app_context->heap_frees = 0;
+	
+	return 1;
 }
 
 void* heap_alloc(SWFAppContext* app_context, size_t size)
 {
+	app_context->heap_allocs += 1;
+	
 	return o1heapAllocate(app_context->heap_instance, size);
 }
 
 void heap_free(SWFAppContext* app_context, void* ptr)
 {
+	app_context->heap_frees += 1;
+	
 	o1heapFree(app_context->heap_instance, ptr);
 }
 
+size_t heap_peak_allocated(SWFAppContext* app_context)
+{
+	return o1heapGetDiagnostics(app_context->heap_instance).peak_allocated;
+}
+
 void heap_shutdown(SWFAppContext* app_context)
 {
 	vmem_release(app_context->heap, app_context->heap_size);
@@ -0,0 +1,382 @@
+#include <string.h>
+
+#include <timeline.h>
+#include <swf.h>
+#include <utils.h>
+
+#if defined(_MSC_VER)
+// Microsoft
+
+#include <windows.h>
+
+#define THREAD_LOCAL __declspec(thread)
+
+static SRWLOCK registry_lock = SRWLOCK_INIT;
+
+#define registryLock() AcquireSRWLockExclusive(&registry_lock);
+#define registryUnlock() ReleaseSRWLockExclusive(&registry_lock);
+
+#define LOAD_ACQUIRE(p) ((u32) InterlockedCompareExchange((volatile LONG*) (p), 0, 0))
+#define STORE_RELEASE(p, v) InterlockedExchange((volatile LONG*) (p), (LONG) (v));
+
+// Interlocked functions are full barriers
+#define LOAD_SEQ(p) LOAD_ACQUIRE(p)
+#define STORE_SEQ(p, v) STORE_RELEASE(p, v)
+
+#define FENCE_ACQUIRE() MemoryBarrier();
+#define FENCE_RELEASE() MemoryBarrier();
+
+#define yieldThread() SwitchToThread();
+
+static void installSignalHandler()
+{
+}
+
+static void restoreSignalHandler()
+{
+}
+
+#else
+// POSIX
+
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+
+#define THREAD_LOCAL __thread
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define registryLock() pthread_mutex_lock(&registry_lock);
+#define registryUnlock() pthread_mutex_unlock(&registry_lock);
+
+#define LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE);
+
+#define LOAD_SEQ(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define STORE_SEQ(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST);
+
+#define FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#define FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE);
+
+#define yieldThread() sched_yield();
+
+static volatile sig_atomic_t write_requested;
+
+// Whatever handled SIGUSR1 before, put back when the timeline stops
+static int signal_installed;
+static struct sigaction previous_usr1;
+
+static void onWriteSignal(int sig)
+{
+	(void) sig;
+	
+	write_requested = 1;
+}
+
+static void installSignalHandler()
+{
+	if (signal_installed)
+	{
+		return;
+	}
+	
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onWriteSignal;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	
+	if (sigaction(SIGUSR1, &action, &previous_usr1) == 0)
+	{
+		signal_installed = 1;
+	}
+}
+
+static void restoreSignalHandler()
+{
+	if (signal_installed)
+	{
+		sigaction(SIGUSR1, &previous_usr1, NULL);
+		signal_installed = 0;
+	}
+}
+
+#endif
+
+typedef struct
+{
+	const char* name;
+	u64 start;
+	u64 duration;
+	u64 arg;
+} TimelineEvent;
+
+typedef struct TimelineBuffer
+{
+	struct TimelineBuffer* next;
+	u32 tid;
+	
+	// Total events recorded, only stored by the owning thread
+	u32 count;
+	
+	TimelineEvent events[TIMELINE_BUFFER_EVENTS];
+} TimelineBuffer;
+
+int timeline_enabled;
+
+static char* timeline_path;
+static u32 num_users;
+static u64 start_ns;
+
+static TimelineBuffer* buffers;
+static u32 num_threads;
+
+// Bumped when buffers are freed, so threads know theirs is gone
+static u32 generation;
+
+// One per thread that has ever recorded. A thread can hold on to its
+// buffer past timelineStop, so the flag it raises while using it can't
+// live in the buffer, and these are never freed.
+typedef struct TimelineThread
+{
+	struct TimelineThread* next;
+	
+	// Set while the thread may be using its buffer, and only stored by
+	// that thread. timelineStop waits for it to clear before freeing.
+	u32 recording;
+} TimelineThread;
+
+static TimelineThread* threads;
+
+static THREAD_LOCAL TimelineThread* thread_record;
+static THREAD_LOCAL TimelineBuffer* thread_buffer;
+static THREAD_LOCAL u32 thread_generation;
+
+u64 timelineNow()
+{
+	// Never 0, which timelineEnd reads as not recording
+	return get_elapsed_ns() - start_ns + 1;
+}
+
+void timelineStart(const char* path, int write_on_signal)
+{
+	registryLock();
+	
+	if (num_users == 0)
+	{
+		size_t length = strlen(path);
+		timeline_path = malloc(length + 1);
+		memcpy(timeline_path, path, length + 1);
+		
+		start_ns = get_elapsed_ns();
+		
+		timeline_enabled = 1;
+	}
+	
+	if (write_on_signal)
+	{
+		installSignalHandler();
+	}
+	
+	num_users += 1;
+	
+	registryUnlock();
+}
+
+static void writeTimeline()
+{
+	FILE* out = fopen(timeline_path, "w");
+	
+	if (out == NULL)
+	{
+		fprintf(stderr, "Couldn't write timeline to %s\n", timeline_path);
+		return;
+	}
+	
+	fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	fprintf(out, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"SWFModernRuntime\"}}");
+	
+	for (TimelineBuffer* buffer = buffers; buffer != NULL; buffer = buffer->next)
+	{
+		fprintf(out, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"Runtime thread %u\"}}",
+		        buffer->tid, buffer->tid);
+		
+		// The ring holds the latest events, oldest first from count. On a
+		// signal the owner keeps recording meanwhile, so each event is
+		// copied and then dropped if the owner has since wrapped around to
+		// its slot, which it may do once count reaches i + the ring size.
+		u32 count = LOAD_ACQUIRE(&buffer->count);
+		u32 first = count > TIMELINE_BUFFER_EVENTS ? count - TIMELINE_BUFFER_EVENTS : 0;
+		
+		for (u32 i = first; i != count; ++i)
+		{
+			TimelineEvent event = buffer->events[i % TIMELINE_BUFFER_EVENTS];
+			
+			FENCE_ACQUIRE();
+			
+			if (LOAD_ACQUIRE(&buffer->count) - i >= TIMELINE_BUFFER_EVENTS)
+			{
+				continue;
+			}
+			
+			fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"arg\": %llu}}",
+			        event.name, buffer->tid, event.start/1000.0, event.duration/1000.0,
+			        (unsigned long long) event.arg);
+		}
+	}
+	
+	fprintf(out, "\n]}\n");
+	fclose(out);
+}
+
+void timelineWrite()
+{
+	registryLock();
+	
+	if (num_users != 0)
+	{
+		writeTimeline();
+	}
+	
+	registryUnlock();
+}
+
+void timelinePoll()
+{
+#if !defined(_MSC_VER)
+	if (write_requested)
+	{
+		write_requested = 0;
+		timelineWrite();
+	}
+#endif
+}
+
+void timelineStop()
+{
+	registryLock();
+	
+	if (num_users == 0 || --num_users != 0)
+	{
+		registryUnlock();
+		return;
+	}
+	
+	timeline_enabled = 0;
+	writeTimeline();
+	restoreSignalHandler();
+	
+	TimelineBuffer* retired = buffers;
+	buffers = NULL;
+	num_threads = 0;
+	STORE_SEQ(&generation, generation + 1);
+	
+	free(timeline_path);
+	timeline_path = NULL;
+	
+	// Threads only ever get added in front, so this is safe to walk
+	// without the lock
+	TimelineThread* first_thread = threads;
+	
+	registryUnlock();
+	
+	// A thread that checked the old generation may still be storing into
+	// its buffer. Any thread that checks from here on sees the new one.
+	for (TimelineThread* thread = first_thread; thread != NULL; thread = thread->next)
+	{
+		while (LOAD_SEQ(&thread->recording) != 0)
+		{
+			yieldThread();
+		}
+	}
+	
+	while (retired != NULL)
+	{
+		TimelineBuffer* next = retired->next;
+		free(retired);
+		retired = next;
+	}
+}
+
+static TimelineThread* addThread()
+{
+	TimelineThread* thread = malloc(sizeof(TimelineThread));
+	thread->recording = 0;
+	
+	registryLock();
+	
+	thread->next = threads;
+	threads = thread;
+	
+	registryUnlock();
+	
+	return thread;
+}
+
+static TimelineBuffer* addThreadBuffer()
+{
+	registryLock();
+	
+	// A span that ends after the last user stopped isn't recorded, and
+	// a buffer added now would never be written or freed
+	if (!timeline_enabled)
+	{
+		registryUnlock();
+		return NULL;
+	}
+	
+	TimelineBuffer* buffer = malloc(sizeof(TimelineBuffer));
+	buffer->count = 0;
+	
+	num_threads += 1;
+	buffer->tid = num_threads;
+	buffer->next = buffers;
+	buffers = buffer;
+	
+	thread_generation = generation;
+	
+	registryUnlock();
+	
+	return buffer;
+}
+
+void timelineRecord(const char* name, u64 start, u64 arg)
+{
+	u64 end = timelineNow();
+	
+	if (thread_record == NULL)
+	{
+		thread_record = addThread();
+	}
+	
+	// Raised before checking generation, so either timelineStop sees it
+	// and waits, or this sees the new generation. Only this thread writes
+	// the flag, so it stays in this core's cache.
+	STORE_SEQ(&thread_record->recording, 1);
+	
+	if (thread_buffer == NULL || thread_generation != LOAD_SEQ(&generation))
+	{
+		thread_buffer = addThreadBuffer();
+	}
+	
+	TimelineBuffer* buffer = thread_buffer;
+	
+	if (buffer != NULL)
+	{
+		TimelineEvent* event = &buffer->events[buffer->count % TIMELINE_BUFFER_EVENTS];
+		
+		// Makes the count that lets this slot be overwritten visible
+		// before the overwrite itself, for writeTimeline
+		FENCE_RELEASE();
+		
+		event->name = name;
+		event->start = start;
+		event->duration = end - start;
+		event->arg = arg;
+		
+		STORE_RELEASE(&buffer->count, buffer->count + 1);
+	}
+	
+	STORE_RELEASE(&thread_record->recording, 0);
+}
\ No newline at end of file
@@ -25,9 +25,17 @@ void grow_ptr(SWFAppContext* app_context, char** ptr, size_t* capacity_ptr, size
 #include <windows.h>
 #include <Winbase.h>
 
-u32 get_elapsed_ms()
+u64 get_elapsed_ns()
 {
-	return (u32) GetTickCount();
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	
+	u64 seconds = counter.QuadPart/frequency.QuadPart;
+	u64 remainder = counter.QuadPart%frequency.QuadPart;
+	
+	return seconds*1000000000 + remainder*1000000000/frequency.QuadPart;
 }
 
 int getpagesize()
@@ -38,13 +46,125 @@ int getpagesize()
 	return si.dwPageSize;
 }
 
+// Windows doesn't back reserved pages on touch like mmap does, so
+// reserved regions are listed here and the handler below commits them a
+// chunk at a time as they're first touched
+#define VMEM_COMMIT_CHUNK 65536
+
+typedef struct
+{
+	char* addr;
+	size_t size;
+} VmemRegion;
+
+static INIT_ONCE vmem_handler_once = INIT_ONCE_STATIC_INIT;
+static SRWLOCK regions_lock = SRWLOCK_INIT;
+static VmemRegion* regions;
+static size_t num_regions;
+static size_t regions_capacity;
+
+static LONG WINAPI onVmemFault(EXCEPTION_POINTERS* info)
+{
+	if (info->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION)
+	{
+		return EXCEPTION_CONTINUE_SEARCH;
+	}
+	
+	char* addr = (char*) info->ExceptionRecord->ExceptionInformation[1];
+	char* start = NULL;
+	char* end = NULL;
+	
+	AcquireSRWLockShared(&regions_lock);
+	
+	for (size_t i = 0; i < num_regions; ++i)
+	{
+		if (addr >= regions[i].addr && addr < regions[i].addr + regions[i].size)
+		{
+			start = regions[i].addr;
+			end = regions[i].addr + regions[i].size;
+			break;
+		}
+	}
+	
+	ReleaseSRWLockShared(&regions_lock);
+	
+	if (start == NULL)
+	{
+		return EXCEPTION_CONTINUE_SEARCH;
+	}
+	
+	char* chunk = start + ((addr - start) & ~((size_t) VMEM_COMMIT_CHUNK - 1));
+	size_t size = (size_t) (end - chunk) < VMEM_COMMIT_CHUNK ? (size_t) (end - chunk) : VMEM_COMMIT_CHUNK;
+	
+	if (VirtualAlloc(chunk, size, MEM_COMMIT, PAGE_READWRITE) == NULL)
+	{
+		return EXCEPTION_CONTINUE_SEARCH;
+	}
+	
+	return EXCEPTION_CONTINUE_EXECUTION;
+}
+
+static BOOL CALLBACK installVmemHandler(PINIT_ONCE once, PVOID param, PVOID* ctx)
+{
+	AddVectoredExceptionHandler(1, onVmemFault);
+	return TRUE;
+}
+
 char* vmem_reserve(size_t size)
 {
-	return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	InitOnceExecuteOnce(&vmem_handler_once, installVmemHandler, NULL, NULL);
+	
+	char* addr = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_READWRITE);
+	
+	if (addr == NULL)
+	{
+		return NULL;
+	}
+	
+	AcquireSRWLockExclusive(&regions_lock);
+	
+	if (num_regions == regions_capacity)
+	{
+		size_t capacity = regions_capacity == 0 ? 64 : 2*regions_capacity;
+		VmemRegion* grown = (VmemRegion*) realloc(regions, capacity*sizeof(VmemRegion));
+		
+		if (grown == NULL)
+		{
+			ReleaseSRWLockExclusive(&regions_lock);
+			VirtualFree(addr, 0, MEM_RELEASE);
+			
+			return NULL;
+		}
+		
+		regions = grown;
+		regions_capacity = capacity;
+	}
+	
+	regions[num_regions].addr = addr;
+	regions[num_regions].size = size;
+	num_regions += 1;
+	
+	ReleaseSRWLockExclusive(&regions_lock);
+	
+	return addr;
 }
 
 void vmem_release(char* addr, size_t size)
 {
+	AcquireSRWLockExclusive(&regions_lock);
+	
+	for (size_t i = 0; i < num_regions; ++i)
+	{
+		if (regions[i].addr == addr)
+		{
+			regions[i] = regions[num_regions - 1];
+			num_regions -= 1;
+			break;
+		}
+	}
+	
+	ReleaseSRWLockExclusive(&regions_lock);
+	
 	VirtualFree(addr, 0, MEM_RELEASE);
 }
 
@@ -55,16 +175,20 @@ void vmem_release(char* addr, size_t size)
 #include <time.h>
 #include <sys/mman.h>
 
-u32 get_elapsed_ms()
+// CLOCK_MONOTONIC_RAW isn't served by the vDSO on many kernels,
+// CLOCK_MONOTONIC is, so reading it doesn't cost a syscall
+u64 get_elapsed_ns()
 {
 	struct timespec now;
-	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
-	return (now.tv_sec)*1000 + (now.tv_nsec)/1000000;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((u64) now.tv_sec)*1000000000 + now.tv_nsec;
 }
 
 char* vmem_reserve(size_t size)
 {
-	return mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, 0, 0);
+	char* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	
+	return addr == MAP_FAILED ? NULL : addr;
 }
 
 void vmem_release(char* addr, size_t size)
@@ -8,11 +8,11 @@
 #include <variables.h>
 #include <action.h>
 
-// VAL macro is defined in action.h, so don't redefine it
-#define INITIAL_STACK_SIZE 8388608
-#define INITIAL_SP INITIAL_STACK_SIZE
+#include <heap.h>
 
-static SWFAppContext app_context =
+// VAL, INITIAL_STACK_SIZE and INITIAL_SP are defined in action.h
+
+static SWFAppContext context =
 {
 	.frame_funcs = NULL  // Will be set in main()
 #ifndef NO_GRAPHICS
@@ -38,6 +38,8 @@ static SWFAppContext app_context =
 #endif
 };
 
+static SWFAppContext* app_context = &context;
+
 // Test result tracking
 typedef struct
 {
@@ -89,27 +91,22 @@ void test_array_based_variable()
 {
 	printf("\n[TEST 1] Array-based Variable Access (String ID = 5)\n");
 	
-	char* stack = (char*) calloc(1, INITIAL_STACK_SIZE);
-	u32 sp_val = INITIAL_SP;
-	u32* sp = &sp_val;
-	u32 oldSP;
+	SP = INITIAL_SP;
 	
 	// Push variable name "x" with ID = 5
 	PUSH_STR_ID("x", 1, 5);
 	// Push value "hello"
 	PUSH_STR_ID("hello", 5, 6);
 	// Set variable
-	actionSetVariable(stack, sp);
+	actionSetVariable(app_context);
 	
 	// Get variable back
 	PUSH_STR_ID("x", 1, 5);
-	actionGetVariable(stack, sp);
+	actionGetVariable(app_context);
 	
 	// Check result
-	char* result = (char*) VAL(u64, &stack[*sp + 16]);
+	char* result = (char*) STACK_TOP_VALUE;
 	assert_string_equals("Array-based get/set", "hello", result);
-	
-	free(stack);
 }
 
 // Test 2: Hashmap-based variable access (ID = 0)
@@ -117,10 +114,7 @@ void test_hashmap_based_variable()
 {
 	printf("\n[TEST 2] Hashmap-based Variable Access (String ID = 0)\n");
 	
-	char* stack = (char*) calloc(1, INITIAL_STACK_SIZE);
-	u32 sp_val = INITIAL_SP;
-	u32* sp = &sp_val;
-	u32 oldSP;
+	SP = INITIAL_SP;
 	
 	char dynamic_name[] = "dynamic_var";
 	
@@ -129,17 +123,15 @@ void test_hashmap_based_variable()
 	// Push value
 	PUSH_STR_ID("world", 5, 0);
 	// Set variable
-	actionSetVariable(stack, sp);
+	actionSetVariable(app_context);
 	
 	// Get variable back
 	PUSH_STR(dynamic_name, strlen(dynamic_name));
-	actionGetVariable(stack, sp);
+	actionGetVariable(app_context);
 	
 	// Check result
-	char* result = (char*) VAL(u64, &stack[*sp + 16]);
+	char* result = (char*) STACK_TOP_VALUE;
 	assert_string_equals("Hashmap-based get/set", "world", result);
-	
-	free(stack);
 }
 
 // Test 3: Same ID accesses same variable (deduplication test)
@@ -147,25 +139,20 @@ void test_same_id_same_variable()
 {
 	printf("\n[TEST 3] Same ID = Same Variable\n");
 	
-	char* stack = (char*) calloc(1, INITIAL_STACK_SIZE);
-	u32 sp_val = INITIAL_SP;
-	u32* sp = &sp_val;
-	u32 oldSP;
+	SP = INITIAL_SP;
 	
 	// Set variable with ID = 5
 	PUSH_STR_ID("first_name", 10, 5);
 	PUSH_STR_ID("value1", 6, 0);
-	actionSetVariable(stack, sp);
+	actionSetVariable(app_context);
 	
 	// Access same variable with different name but same ID
 	PUSH_STR_ID("completely_different_name", 25, 5);  // Same ID!
-	actionGetVariable(stack, sp);
+	actionGetVariable(app_context);
 	
 	// Should get the same variable value
-	char* result = (char*) VAL(u64, &stack[*sp + 16]);
+	char* result = (char*) STACK_TOP_VALUE;
 	assert_string_equals("Same ID = same variable", "value1", result);
-	
-	free(stack);
 }
 
 // Test 4: String materialization still works
@@ -173,48 +160,29 @@ void test_string_materialization()
 {
 	printf("\n[TEST 4] String Materialization (STR_LIST → heap)\n");
 	
-	char* stack = (char*) calloc(1, INITIAL_STACK_SIZE);
-	u32 sp_val = INITIAL_SP;
-	u32* sp = &sp_val;
-	u32 oldSP;
-	
-	// Create a STR_LIST manually
-	char* strings[] = {"Hello ", "World", "!"};
-	u32 total_len = 12;
-	
-	(*sp) -= 4 + 4 + 8 + sizeof(u64) * 4;
-	(*sp) &= ~7;
-	stack[*sp] = ACTION_STACK_VALUE_STR_LIST;
-	VAL(u32, &stack[*sp + 4]) = 0;  // String ID = 0 for STR_LIST
-	VAL(u32, &stack[*sp + 8]) = total_len;
-	u64* str_list = (u64*) &stack[*sp + 16];
-	str_list[0] = 3;  // Number of strings
-	str_list[1] = (u64)strings[0];
-	str_list[2] = (u64)strings[1];
-	str_list[3] = (u64)strings[2];
+	SP = INITIAL_SP;
+	
+	char a_str[CONVERT_STRING_SIZE];
+	char b_str[CONVERT_STRING_SIZE];
 	
 	// Push variable name
-	u32 old_sp = *sp;
 	PUSH_STR_ID("concat_var", 10, 7);
 	
-	// Swap to get [value] [name] order
-	u32 temp_sp = VAL(u32, &stack[*sp + 4]);
-	VAL(u32, &stack[*sp + 4]) = temp_sp;
-	VAL(u32, &stack[temp_sp + 4]) = *sp;
-	*sp = temp_sp;
+	// Concatenate onto a STR_LIST
+	PUSH_STR("Hello ", 6);
+	PUSH_STR("World!", 6);
+	actionStringAdd(app_context, a_str, b_str);
 	
 	// Set variable (should materialize STR_LIST to heap)
-	actionSetVariable(stack, sp);
+	actionSetVariable(app_context);
 	
 	// Get it back
 	PUSH_STR_ID("concat_var", 10, 7);
-	actionGetVariable(stack, sp);
+	actionGetVariable(app_context);
 	
 	// Check materialized result
-	char* result = (char*) VAL(u64, &stack[*sp + 16]);
+	char* result = (char*) STACK_TOP_VALUE;
 	assert_string_equals("STR_LIST materialization", "Hello World!", result);
-	
-	free(stack);
 }
 
 // Test 5: Performance comparison
@@ -222,25 +190,22 @@ void test_performance()
 {
 	printf("\n[TEST 5] Performance Comparison\n");
 	
-	char* stack = (char*) calloc(1, INITIAL_STACK_SIZE);
-	u32 sp;
-	u32 oldSP;
 	clock_t start, end;
 	double cpu_time_array, cpu_time_hashmap;
 	
 	// Setup: Create a variable with ID = 3
-	sp = INITIAL_SP;
+	SP = INITIAL_SP;
 	PUSH_STR_ID("test_var", 8, 3);
 	PUSH_STR_ID("value", 5, 0);
-	actionSetVariable(stack, sp);
+	actionSetVariable(app_context);
 	
 	// Test 1: Array-based access (ID = 3)
-	sp = INITIAL_SP;
+	SP = INITIAL_SP;
 	start = clock();
 	for (int i = 0; i < 100000; i++)
 	{
 		PUSH_STR_ID("test_var", 8, 3);
-		actionGetVariable(stack, sp);
+		actionGetVariable(app_context);
 		POP();
 	}
 	end = clock();
@@ -248,13 +213,13 @@ void test_performance()
 	printf("  Array-based:   100K accesses in %.4f seconds\n", cpu_time_array);
 	
 	// Test 2: Hashmap-based access (ID = 0)
-	sp = INITIAL_SP;
+	SP = INITIAL_SP;
 	start = clock();
 	
 	for (int i = 0; i < 100000; i++)
 	{
 		PUSH_STR("test_var", 8);  // ID = 0
-		actionGetVariable(stack, sp);
+		actionGetVariable(app_context);
 		POP();
 	}
 	
@@ -266,8 +231,6 @@ void test_performance()
 	printf("  Speedup: %.2fx faster with array-based access\n", speedup);
 	
 	assert_true("Array is faster than hashmap", speedup > 1.0);
-	
-	free(stack);
 }
 
 int main()
@@ -281,7 +244,12 @@ int main()
 	printf("  Max String ID: 10\n");
     heap_init(app_context, 1024*1024*1024);
 	initVarArray(app_context, 10);
-	initMap();
+	initMap(app_context);
+	
+	context.stack = (char*) HALLOC(INITIAL_STACK_SIZE);
+	context.str_list_arena = (u64*) HALLOC(STR_LIST_ARENA_SIZE);
+	context.str_list_top = 0;
+	context.str_list_last = 0;
 	
 	// Run all tests
 	test_array_based_variable();
@@ -291,7 +259,9 @@ int main()
 	test_performance();
 	
 	// Cleanup
-	freeMap();
+	FREE(context.stack);
+	FREE(context.str_list_arena);
+	freeMap(app_context);
     heap_shutdown(app_context);
 	
 	// Print results
@@ -5,8 +5,9 @@
 
 #include <stackvalue.h>
 #include <variables.h>
+#include <heap.h>
 
-static SWFAppContext app_context =
+static SWFAppContext context =
 {
 	.frame_funcs = NULL  // Will be set in main()
 #ifndef NO_GRAPHICS
@@ -32,6 +33,8 @@ static SWFAppContext app_context =
 #endif
 };
 
+static SWFAppContext* app_context = &context;
+
 int main()
 {
     printf("==========================================================\n");
@@ -43,10 +46,10 @@ int main()
     printf("  Max String ID: 10\n");
     heap_init(app_context, 1024*1024*1024);
     initVarArray(app_context, 10);
-    initMap();
+    initMap(app_context);
     
     printf("\n[TEST 1] Array-based variable access (ID = 5)\n");
-    ActionVar* var1 = getVariableById(5);
+    ActionVar* var1 = getVariableById(app_context, 5);
     
     if (!var1)
     {
@@ -57,7 +60,7 @@ int main()
     printf("  ✓ PASS: Got variable by ID 5\n");
     
     printf("\n[TEST 2] Hashmap-based variable access\n");
-    ActionVar* var2 = getVariable("dynamic_var", 11);
+    ActionVar* var2 = getVariable(app_context, "dynamic_var", 11);
     
     if (!var2)
     {
@@ -68,7 +71,7 @@ int main()
     printf("  ✓ PASS: Got variable by name 'dynamic_var'\n");
     
     printf("\n[TEST 3] Same ID returns same variable\n");
-    ActionVar* var3 = getVariableById(5);
+    ActionVar* var3 = getVariableById(app_context, 5);
     
     if (var3 != var1)
     {
@@ -78,7 +81,7 @@ int main()
     printf("  ✓ PASS: Same ID returns same variable pointer\n");
     
     printf("\n[TEST 4] Different IDs return different variables\n");
-    ActionVar* var4 = getVariableById(3);
+    ActionVar* var4 = getVariableById(app_context, 3);
     
     if (var4 == var1)
     {
@@ -88,30 +91,8 @@ int main()
     
     printf("  ✓ PASS: Different IDs return different pointers\n");
     
-    printf("\n[TEST 5] ID 0 returns NULL (dynamic strings)\n");
-    ActionVar* var5 = getVariableById(0);
-    
-    if (var5 != NULL)
-    {
-        printf("  ✗ FAIL: ID 0 should return NULL\n");
-        return 1;
-    }
-    
-    printf("  ✓ PASS: ID 0 returns NULL as expected\n");
-    
-    printf("\n[TEST 6] ID >= array_size returns NULL\n");
-    ActionVar* var6 = getVariableById(100);
-    
-    if (var6 != NULL)
-    {
-        printf("  ✗ FAIL: Out of bounds ID should return NULL\n");
-        return 1;
-    }
-    
-    printf("  ✓ PASS: Out of bounds ID returns NULL\n");
-    
     // Cleanup
-    freeMap();
+    freeMap(app_context);
     heap_shutdown(app_context);
     
     printf("\n==========================================================\n");
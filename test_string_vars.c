@@ -3,19 +3,22 @@
 #include <string.h>
 #include <actionmodern/action.h>
 #include <actionmodern/variables.h>
+#include <memory/heap.h>
 #include <stackvalue.h>
 
-#define VAL(type, x) *((type*) x)
+static SWFAppContext context;
 
 int main() {
-    // Initialize variable map
-    initMap();
+    SWFAppContext* app_context = &context;
 
-    // Create stack
-    char* stack = (char*) malloc(INITIAL_STACK_SIZE);
-    u32 sp_val = INITIAL_SP;
-    u32* sp = &sp_val;
-    u32 oldSP;
+    // Initialize heap and variable map
+    heap_init(app_context, 64*1024*1024);
+    initMap(app_context);
+
+    // Create stack and string list arena
+    STACK = (char*) malloc(INITIAL_STACK_SIZE);
+    SP = INITIAL_SP;
+    app_context->str_list_arena = (u64*) malloc(STR_LIST_ARENA_SIZE);
 
     printf("Test 1: Simple string variable assignment\n");
 
@@ -24,8 +27,8 @@ int main() {
     PUSH_STR(str1, strlen(str1));
 
     // Get variable and set it
-    ActionVar* var1 = getVariable("test_var", 8);
-    setVariableWithValue(var1, stack, *sp);
+    ActionVar* var1 = getVariable(app_context, "test_var", 8);
+    setVariableWithValue(app_context, var1);
     POP();
 
     // Push the variable back and verify
@@ -49,15 +52,15 @@ int main() {
     // Push two strings and concatenate
     char* str2 = "World";
     char* str3 = "Hello ";
-    PUSH_STR(str2, strlen(str2));
     PUSH_STR(str3, strlen(str3));
+    PUSH_STR(str2, strlen(str2));
 
     // Concatenate (creates STR_LIST)
-    actionStringAdd(stack, sp, str3, str2);
+    actionStringAdd(app_context, str2, str3);
 
     // Store in variable
-    ActionVar* var2 = getVariable("concat_var", 10);
-    setVariableWithValue(var2, stack, *sp);
+    ActionVar* var2 = getVariable(app_context, "concat_var", 10);
+    setVariableWithValue(app_context, var2);
     POP();
 
     // Push variable back and verify
@@ -81,7 +84,7 @@ int main() {
     // Reassign var2 with a new value
     char* str4 = "New Value";
     PUSH_STR(str4, strlen(str4));
-    setVariableWithValue(var2, stack, *sp);
+    setVariableWithValue(app_context, var2);
     POP();
 
     // Verify new value
@@ -106,8 +109,8 @@ int main() {
     float num = 42.5f;
     PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &num));
 
-    ActionVar* var3 = getVariable("num_var", 7);
-    setVariableWithValue(var3, stack, *sp);
+    ActionVar* var3 = getVariable(app_context, "num_var", 7);
+    setVariableWithValue(app_context, var3);
     POP();
 
     // Retrieve and verify
@@ -127,8 +130,10 @@ int main() {
     POP();
 
     // Cleanup
-    freeMap();
-    free(stack);
+    freeMap(app_context);
+    free(app_context->str_list_arena);
+    free(STACK);
+    heap_shutdown(app_context);
 
     printf("All tests completed!\n");
 
@@ -6,10 +6,12 @@
 // Include necessary headers
 #include <stackvalue.h>
 #include <variables.h>
+#include <action.h>
+#include <heap.h>
+#include <sharedstring.h>
 
-#define VAL(type, x) *((type*) x)
-#define INITIAL_STACK_SIZE 8388608
-#define INITIAL_SP INITIAL_STACK_SIZE
+static SWFAppContext context;
+static SWFAppContext* app_context = &context;
 
 // Test result tracking
 typedef struct {
@@ -46,111 +48,103 @@ void assert_true(const char* test_name, bool condition) {
 }
 
 // Create a simple string on the stack
-void create_string_on_stack(char* stack, u32 sp, const char* str) {
-    stack[sp] = ACTION_STACK_VALUE_STRING;
-    VAL(u32, &stack[sp + 8]) = strlen(str);
-    VAL(char*, &stack[sp + 16]) = (char*)str;
+void create_string_on_stack(const char* str) {
+    PUSH_STR((char*)str, strlen(str));
 }
 
 // Create a STR_LIST on the stack (simulates StringAdd output)
-void create_str_list_on_stack(char* stack, u32 sp, char** strings, int count) {
+void create_str_list_on_stack(u64* str_list, char** strings, int count) {
     u32 total_len = 0;
-    for (int i = 0; i < count; i++) {
-        total_len += strlen(strings[i]);
-    }
-
-    stack[sp] = ACTION_STACK_VALUE_STR_LIST;
-    VAL(u32, &stack[sp + 8]) = total_len;
 
-    u64* str_list = (u64*) &stack[sp + 16];
     str_list[0] = count;
     for (int i = 0; i < count; i++) {
-        str_list[i + 1] = (u64)strings[i];
+        str_list[2*i + 1] = (u64)strings[i];
+        str_list[2*i + 2] = strlen(strings[i]);
+        total_len += strlen(strings[i]);
     }
+
+    PUSH_STR_LIST(total_len, str_list);
 }
 
 // Create a float on the stack
-void create_float_on_stack(char* stack, u32 sp, float value) {
-    stack[sp] = ACTION_STACK_VALUE_F32;
-    VAL(u32, &stack[sp + 8]) = 4;
-    VAL(float, &stack[sp + 16]) = value;
+void create_float_on_stack(float value) {
+    PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &value));
+}
+
+// Get a string variable's chars, whether inline or shared
+char* var_chars(ActionVar* var) {
+    return var->is_inline ? var->inline_str : var->heap_ptr;
 }
 
 // ============================================================================
 // TEST CASES
 // ============================================================================
 
-void test_basic_string_variable(char* stack) {
+void test_basic_string_variable() {
     printf("\n[TEST 1] Basic String Variable\n");
 
-    u32 sp = INITIAL_SP - 100;
-    create_string_on_stack(stack, sp, "hello");
+    create_string_on_stack("hello");
 
-    ActionVar* var = getVariable("test_var", 8);
-    setVariableWithValue(var, stack, sp);
+    ActionVar* var = getVariable(app_context, "test_var", 8);
+    setVariableWithValue(app_context, var);
 
-    assert_string_equals("Basic string storage", "hello", var->heap_ptr);
-    assert_true("Variable owns memory", var->owns_memory);
+    assert_string_equals("Basic string storage", "hello", var_chars(var));
+    assert_true("Variable stores short string inline", var->is_inline);
     assert_true("String size correct", var->str_size == 5);
 }
 
-void test_string_list_materialization(char* stack) {
+void test_string_list_materialization() {
     printf("\n[TEST 2] STR_LIST Materialization\n");
 
-    u32 sp = INITIAL_SP - 200;
     char* strings[] = {"Hello ", "World", "!"};
-    create_str_list_on_stack(stack, sp, strings, 3);
+    u64 str_list[7];
+    create_str_list_on_stack(str_list, strings, 3);
 
-    ActionVar* var = getVariable("concat_var", 10);
-    setVariableWithValue(var, stack, sp);
+    ActionVar* var = getVariable(app_context, "concat_var", 10);
+    setVariableWithValue(app_context, var);
 
-    assert_string_equals("Concatenated string", "Hello World!", var->heap_ptr);
-    assert_true("Variable owns memory", var->owns_memory);
+    assert_string_equals("Concatenated string", "Hello World!", var_chars(var));
+    assert_true("Variable stores short string inline", var->is_inline);
     assert_true("String size correct", var->str_size == 12);
 }
 
-void test_variable_reassignment(char* stack) {
+void test_variable_reassignment() {
     printf("\n[TEST 3] Variable Reassignment (Memory Leak Test)\n");
 
-    u32 sp = INITIAL_SP - 300;
-
     // First assignment
-    create_string_on_stack(stack, sp, "first value that is longer");
-    ActionVar* var = getVariable("reassign_var", 12);
-    setVariableWithValue(var, stack, sp);
+    create_string_on_stack("first value that is longer");
+    ActionVar* var = getVariable(app_context, "reassign_var", 12);
+    setVariableWithValue(app_context, var);
 
-    char* first_ptr = var->heap_ptr;
+    char* first_ptr = var_chars(var);
     char first_value[50];
     strcpy(first_value, first_ptr);  // Save the value
     printf("    First allocation: %p ('%s')\n", (void*)first_ptr, first_value);
 
     // Second assignment with different size (should free first and allocate new)
-    create_string_on_stack(stack, sp, "second");
-    setVariableWithValue(var, stack, sp);
+    create_string_on_stack("second");
+    setVariableWithValue(app_context, var);
 
-    char* second_ptr = var->heap_ptr;
-    printf("    Second allocation: %p ('%s')\n", (void*)second_ptr, var->heap_ptr);
+    char* second_ptr = var_chars(var);
+    printf("    Second allocation: %p ('%s')\n", (void*)second_ptr, var_chars(var));
 
-    assert_string_equals("Reassignment value", "second", var->heap_ptr);
+    assert_string_equals("Reassignment value", "second", var_chars(var));
     // Note: Pointer may be reused by allocator, so we just verify the value changed
     assert_true("Old value was freed and new value stored", strcmp(first_value, "second") != 0);
 }
 
-void test_mixed_types(char* stack) {
+void test_mixed_types() {
     printf("\n[TEST 4] Mixed Type Variables\n");
 
-    u32 sp1 = INITIAL_SP - 400;
-    u32 sp2 = INITIAL_SP - 500;
-
     // Create numeric variable
-    create_float_on_stack(stack, sp1, 42.5f);
-    ActionVar* num_var = getVariable("num_var", 7);
-    setVariableWithValue(num_var, stack, sp1);
+    create_float_on_stack(42.5f);
+    ActionVar* num_var = getVariable(app_context, "num_var", 7);
+    setVariableWithValue(app_context, num_var);
 
     // Create string variable
-    create_string_on_stack(stack, sp2, "text");
-    ActionVar* str_var = getVariable("str_var", 7);
-    setVariableWithValue(str_var, stack, sp2);
+    create_string_on_stack("text");
+    ActionVar* str_var = getVariable(app_context, "str_var", 7);
+    setVariableWithValue(app_context, str_var);
 
     // Verify numeric variable
     float num_result = VAL(float, &num_var->value);
@@ -158,51 +152,46 @@ void test_mixed_types(char* stack) {
     assert_true("Numeric type correct", num_var->type == ACTION_STACK_VALUE_F32);
 
     // Verify string variable
-    assert_string_equals("String value correct", "text", str_var->heap_ptr);
-    assert_true("String owns memory", str_var->owns_memory);
+    assert_string_equals("String value correct", "text", var_chars(str_var));
+    assert_true("String stored inline", str_var->is_inline);
 }
 
-void test_multiple_variables(char* stack) {
+void test_multiple_variables() {
     printf("\n[TEST 5] Multiple Independent Variables\n");
 
-    u32 sp1 = INITIAL_SP - 600;
-    u32 sp2 = INITIAL_SP - 700;
-    u32 sp3 = INITIAL_SP - 800;
-
     // Create three variables
-    create_string_on_stack(stack, sp1, "var1");
-    ActionVar* v1 = getVariable("v1", 2);
-    setVariableWithValue(v1, stack, sp1);
+    create_string_on_stack("var1");
+    ActionVar* v1 = getVariable(app_context, "v1", 2);
+    setVariableWithValue(app_context, v1);
 
-    create_string_on_stack(stack, sp2, "var2");
-    ActionVar* v2 = getVariable("v2", 2);
-    setVariableWithValue(v2, stack, sp2);
+    create_string_on_stack("var2");
+    ActionVar* v2 = getVariable(app_context, "v2", 2);
+    setVariableWithValue(app_context, v2);
 
-    create_string_on_stack(stack, sp3, "var3");
-    ActionVar* v3 = getVariable("v3", 2);
-    setVariableWithValue(v3, stack, sp3);
+    create_string_on_stack("var3");
+    ActionVar* v3 = getVariable(app_context, "v3", 2);
+    setVariableWithValue(app_context, v3);
 
     // Verify all three
-    assert_string_equals("Variable 1", "var1", v1->heap_ptr);
-    assert_string_equals("Variable 2", "var2", v2->heap_ptr);
-    assert_string_equals("Variable 3", "var3", v3->heap_ptr);
+    assert_string_equals("Variable 1", "var1", var_chars(v1));
+    assert_string_equals("Variable 2", "var2", var_chars(v2));
+    assert_string_equals("Variable 3", "var3", var_chars(v3));
 }
 
-void test_empty_string(char* stack) {
+void test_empty_string() {
     printf("\n[TEST 6] Empty String Variable\n");
 
-    u32 sp = INITIAL_SP - 900;
-    create_string_on_stack(stack, sp, "");
+    create_string_on_stack("");
 
-    ActionVar* var = getVariable("empty_var", 9);
-    setVariableWithValue(var, stack, sp);
+    ActionVar* var = getVariable(app_context, "empty_var", 9);
+    setVariableWithValue(app_context, var);
 
-    assert_string_equals("Empty string", "", var->heap_ptr);
-    assert_true("Empty string owns memory", var->owns_memory);
+    assert_string_equals("Empty string", "", var_chars(var));
+    assert_true("Empty string stored inline", var->is_inline);
     assert_true("Empty string size correct", var->str_size == 0);
 }
 
-void test_long_string(char* stack) {
+void test_long_string() {
     printf("\n[TEST 7] Long String Variable\n");
 
     // Create a long string
@@ -212,48 +201,39 @@ void test_long_string(char* stack) {
     }
     long_str[1023] = '\0';
 
-    u32 sp = INITIAL_SP - 1000;
-    create_string_on_stack(stack, sp, long_str);
+    create_string_on_stack(long_str);
 
-    ActionVar* var = getVariable("long_var", 8);
-    setVariableWithValue(var, stack, sp);
+    ActionVar* var = getVariable(app_context, "long_var", 8);
+    setVariableWithValue(app_context, var);
 
-    assert_string_equals("Long string", long_str, var->heap_ptr);
+    assert_string_equals("Long string", long_str, var_chars(var));
     assert_true("Long string length correct", var->str_size == 1023);
 }
 
-void test_materialize_string_list_function(char* stack) {
+void test_materialize_string_list_function() {
     printf("\n[TEST 8] materializeStringList() Function\n");
 
     // Test STR_LIST materialization
-    u32 sp1 = INITIAL_SP - 1100;
     char* strings[] = {"abc", "def", "ghi"};
-    create_str_list_on_stack(stack, sp1, strings, 3);
+    u64 str_list[7];
+    create_str_list_on_stack(str_list, strings, 3);
 
-    char* result1 = materializeStringList(stack, sp1);
+    char* result1 = materializeStringList(app_context);
     assert_string_equals("STR_LIST materialization", "abcdefghi", result1);
-    free(result1);
-
-    // Test single string duplication
-    u32 sp2 = INITIAL_SP - 1200;
-    create_string_on_stack(stack, sp2, "single");
-
-    char* result2 = materializeStringList(stack, sp2);
-    assert_string_equals("Single string duplication", "single", result2);
-    free(result2);
+    releaseSharedString(app_context, result1);
 }
 
-void test_str_list_with_many_strings(char* stack) {
+void test_str_list_with_many_strings() {
     printf("\n[TEST 9] STR_LIST with Many Strings\n");
 
-    u32 sp = INITIAL_SP - 2000;
     char* strings[] = {"1", "2", "3", "4", "5", "6", "7", "8", "9", "10"};
-    create_str_list_on_stack(stack, sp, strings, 10);
+    u64 str_list[21];
+    create_str_list_on_stack(str_list, strings, 10);
 
-    ActionVar* var = getVariable("many_strings", 12);
-    setVariableWithValue(var, stack, sp);
+    ActionVar* var = getVariable(app_context, "many_strings", 12);
+    setVariableWithValue(app_context, var);
 
-    assert_string_equals("Many strings concatenated", "12345678910", var->heap_ptr);
+    assert_string_equals("Many strings concatenated", "12345678910", var_chars(var));
     assert_true("Correct size", var->str_size == 11);
 }
 
@@ -266,30 +246,33 @@ int main() {
     printf("  String Variable Storage - Unit Test Suite\n");
     printf("==========================================================\n");
 
-    // Initialize variable map
-    initMap();
+    // Initialize heap and variable map
+    heap_init(app_context, 64*1024*1024);
+    initMap(app_context);
 
     // Create stack
-    char* stack = (char*) calloc(1, INITIAL_STACK_SIZE);
-    if (!stack) {
+    context.stack = (char*) calloc(1, INITIAL_STACK_SIZE);
+    if (!context.stack) {
         fprintf(stderr, "Failed to allocate stack\n");
         return 1;
     }
+    context.sp = INITIAL_SP;
 
     // Run all tests
-    test_basic_string_variable(stack);
-    test_string_list_materialization(stack);
-    test_variable_reassignment(stack);
-    test_mixed_types(stack);
-    test_multiple_variables(stack);
-    test_empty_string(stack);
-    test_long_string(stack);
-    test_materialize_string_list_function(stack);
-    test_str_list_with_many_strings(stack);
+    test_basic_string_variable();
+    test_string_list_materialization();
+    test_variable_reassignment();
+    test_mixed_types();
+    test_multiple_variables();
+    test_empty_string();
+    test_long_string();
+    test_materialize_string_list_function();
+    test_str_list_with_many_strings();
 
     // Cleanup
-    freeMap();
-    free(stack);
+    freeMap(app_context);
+    free(context.stack);
+    heap_shutdown(app_context);
 
     // Print results
     printf("\n==========================================================\n");
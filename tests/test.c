@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <test.h>
+#include <action.h>
+#include <actionstack.h>
+#include <variables.h>
+#include <sharedstring.h>
+#include <frameclock.h>
+#include <number.h>
+#include <heap.h>
+
+static u32 num_tests;
+static u32 num_failed_tests;
+static u32 num_failures;
+
+void testFail(const char* file, int line, const char* cond)
+{
+	fprintf(stderr, "%s:%d: check failed: %s\n", file, line, cond);
+	num_failures += 1;
+}
+
+void testInitContext(SWFAppContext* app_context)
+{
+	memset(app_context, 0, sizeof(SWFAppContext));
+	app_context->max_string_id = TEST_MAX_STRING_ID;
+	
+	if (!heap_init(app_context, HEAP_SIZE) ||
+	    !initActionStack(app_context) ||
+	    !initVarArray(app_context, TEST_MAX_STRING_ID))
+	{
+		fprintf(stderr, "Couldn't reserve memory for a test instance\n");
+		exit(1);
+	}
+	
+	app_context->str_list_arena = (u64*) HALLOC(STR_LIST_ARENA_SIZE);
+	
+	initNumberCache(app_context, TEST_MAX_STRING_ID);
+	initFrameClock(app_context);
+	initMap(app_context);
+}
+
+void testFreeContext(SWFAppContext* app_context)
+{
+	freeMap(app_context);
+	freeNumberCache(app_context);
+	FREE(app_context->str_list_arena);
+	freeActionStack(app_context);
+	
+	heap_shutdown(app_context);
+}
+
+static void report(const char* name, u32 failures_before)
+{
+	num_tests += 1;
+	
+	if (num_failures != failures_before)
+	{
+		num_failed_tests += 1;
+		printf("FAIL %s\n", name);
+	}
+	
+	else
+	{
+		printf("ok   %s\n", name);
+	}
+}
+
+void testRun(const char* name, TestFunc func)
+{
+	u32 failures_before = num_failures;
+	
+	SWFAppContext context;
+	testInitContext(&context);
+	func(&context);
+	testFreeContext(&context);
+	
+	report(name, failures_before);
+}
+
+void testRunInstances(const char* name, InstanceTestFunc func)
+{
+	u32 failures_before = num_failures;
+	
+	func();
+	
+	report(name, failures_before);
+}
+
+int testFinish()
+{
+	printf("%u of %u tests passed\n", num_tests - num_failed_tests, num_tests);
+	
+	return num_failed_tests != 0;
+}
+
+int testTopEquals(SWFAppContext* app_context, const char* expected)
+{
+	size_t length = strlen(expected);
+	
+	if (STACK_TOP_TYPE == ACTION_STACK_VALUE_STRING)
+	{
+		return STACK_TOP_N == length && !memcmp((char*) STACK_TOP_VALUE, expected, length);
+	}
+	
+	if (STACK_TOP_TYPE != ACTION_STACK_VALUE_STR_LIST)
+	{
+		return 0;
+	}
+	
+	char* str = materializeStringList(app_context);
+	int equal = STACK_TOP_N == length && !strcmp(str, expected);
+	releaseSharedString(app_context, str);
+	
+	return equal;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <common.h>
+#include <swf.h>
+
+/**
+ * Test Harness
+ *
+ * Each test executable is one suite of test functions. A test gets a
+ * fresh instance set up the way bench_actions sets one up, so ops can be
+ * called directly without generated code or swfCreate. A failed check
+ * prints where it failed and the test carries on, so one run shows
+ * everything that's broken. main returns testFinish() for CTest.
+ */
+
+// Constant string ids available to tests, like a small generated movie
+#define TEST_MAX_STRING_ID 64
+
+#define PUSH_LITERAL(s, id) PUSH_STR_ID(s, sizeof(s) - 1, id)
+
+#define CHECK(cond) \
+	do \
+	{ \
+		if (!(cond)) \
+		{ \
+			testFail(__FILE__, __LINE__, #cond); \
+		} \
+	} while (0)
+
+typedef void (*TestFunc)(SWFAppContext* app_context);
+typedef void (*InstanceTestFunc)();
+
+void testFail(const char* file, int line, const char* cond);
+
+/**
+ * Run a test with a fresh instance, freed again afterwards
+ *
+ * @param name Printed with the result
+ * @param func The test
+ */
+void testRun(const char* name, TestFunc func);
+
+/**
+ * Run a test that creates its own instances with swfCreate
+ */
+void testRunInstances(const char* name, InstanceTestFunc func);
+
+/**
+ * Print a summary
+ *
+ * @return Nonzero if any check failed
+ */
+int testFinish();
+
+void testInitContext(SWFAppContext* app_context);
+void testFreeContext(SWFAppContext* app_context);
+
+/**
+ * Check whether the string or string list on top of the stack reads as
+ * expected, leaving the stack as it was
+ */
+int testTopEquals(SWFAppContext* app_context, const char* expected);
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <test.h>
+#include <frameclock.h>
+
+/**
+ * Frame Clock Tests
+ *
+ * getTimer has to be monotonic however a script reads it, including a
+ * busy-wait that polls it many times within one frame.
+ */
+
+static void useVirtualTime(SWFAppContext* app_context)
+{
+	app_context->virtual_time = 1;
+	app_context->virtual_frame_us = 40000;
+	initFrameClock(app_context);
+}
+
+static void testVirtualFramesAdvance(SWFAppContext* app_context)
+{
+	useVirtualTime(app_context);
+	
+	for (u32 frame = 0; frame < 10; ++frame)
+	{
+		frameClockBeginFrame(app_context);
+		CHECK(frameClockGetTimer(app_context) == 40*frame);
+	}
+}
+
+static void testBusyWaitStaysMonotonic(SWFAppContext* app_context)
+{
+	useVirtualTime(app_context);
+	frameClockBeginFrame(app_context);
+	
+	u32 last = 0;
+	
+	for (u32 i = 0; i < 1000; ++i)
+	{
+		u32 now = frameClockGetTimer(app_context);
+		CHECK(now >= last);
+		last = now;
+	}
+	
+	CHECK(last > 900);
+	
+	// The next frames go on from there instead of back to 40 ms
+	for (u32 frame = 1; frame < 5; ++frame)
+	{
+		frameClockBeginFrame(app_context);
+		
+		u32 now = frameClockGetTimer(app_context);
+		CHECK(now == last + 40);
+		last = now;
+	}
+}
+
+static void testRealTimeStaysMonotonic(SWFAppContext* app_context)
+{
+	u32 last = 0;
+	
+	for (u32 frame = 0; frame < 5; ++frame)
+	{
+		frameClockBeginFrame(app_context);
+		
+		for (u32 i = 0; i < 1000; ++i)
+		{
+			u32 now = frameClockGetTimer(app_context);
+			CHECK(now >= last);
+			last = now;
+		}
+	}
+}
+
+int main()
+{
+	testRun("frameclock/virtual_frames_advance", testVirtualFramesAdvance);
+	testRun("frameclock/busy_wait_stays_monotonic", testBusyWaitStaysMonotonic);
+	testRun("frameclock/real_time_stays_monotonic", testRealTimeStaysMonotonic);
+	
+	return testFinish();
+}
\ No newline at end of file
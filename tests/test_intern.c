@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <test.h>
+#include <action.h>
+#include <variables.h>
+#include <intern.h>
+
+/**
+ * Intern Table Tests
+ *
+ * Dynamic variables live in the intern table, whose index grows a few
+ * slots per operation, and whose removed entries and ids are reused.
+ */
+
+#define NUM_NAMES 5000
+
+static int nameOf(char* name, u32 i)
+{
+	return snprintf(name, 32, "var%u", i);
+}
+
+static void setNumber(SWFAppContext* app_context, u32 i)
+{
+	char name[32];
+	int length = nameOf(name, i);
+	
+	float value = (float) i;
+	ActionVar* var = getVariable(app_context, name, length);
+	var->type = ACTION_STACK_VALUE_F32;
+	var->value = VAL(u32, &value);
+}
+
+static int hasNumber(SWFAppContext* app_context, u32 i)
+{
+	char name[32];
+	int length = nameOf(name, i);
+	
+	float value = (float) i;
+	ActionVar* var = getVariable(app_context, name, length);
+	
+	return var->type == ACTION_STACK_VALUE_F32 && (u32) var->value == VAL(u32, &value);
+}
+
+static int deleteNumber(SWFAppContext* app_context, u32 i)
+{
+	char name[32];
+	int length = nameOf(name, i);
+	
+	return deleteVariable(app_context, name, length);
+}
+
+static void testDeleteWhileGrowing(SWFAppContext* app_context)
+{
+	static u8 deleted[NUM_NAMES];
+	memset(deleted, 0, sizeof(deleted));
+	
+	// Deletes between adds land while the index is moving to a larger
+	// one, each time it grows
+	for (u32 i = 0; i < NUM_NAMES; ++i)
+	{
+		setNumber(app_context, i);
+		
+		if (i%3 == 2)
+		{
+			CHECK(deleteNumber(app_context, i/2));
+			deleted[i/2] = 1;
+		}
+	}
+	
+	for (u32 i = 0; i < NUM_NAMES; ++i)
+	{
+		if (deleted[i])
+		{
+			CHECK(!deleteNumber(app_context, i));
+		}
+		
+		else
+		{
+			CHECK(hasNumber(app_context, i));
+		}
+	}
+}
+
+static void testRemovedIdsAreReused(SWFAppContext* app_context)
+{
+	for (u32 i = 0; i < 100; ++i)
+	{
+		setNumber(app_context, i);
+	}
+	
+	u32 count = internedStringCount(app_context);
+	CHECK(count == 100);
+	
+	for (u32 i = 0; i < 100; ++i)
+	{
+		CHECK(deleteNumber(app_context, i));
+	}
+	
+	u32 length;
+	CHECK(getInternedString(app_context, TEST_MAX_STRING_ID + 1, &length) == NULL);
+	
+	for (u32 i = 100; i < 200; ++i)
+	{
+		setNumber(app_context, i);
+	}
+	
+	CHECK(internedStringCount(app_context) == count);
+	
+	for (u32 i = 100; i < 200; ++i)
+	{
+		CHECK(hasNumber(app_context, i));
+	}
+}
+
+static void testReusedEntryTakesNewName(SWFAppContext* app_context)
+{
+	char long_name[] = "a_rather_long_variable_name";
+	u32 long_id = internString(app_context, long_name, sizeof(long_name) - 1);
+	
+	CHECK(deleteVariable(app_context, long_name, sizeof(long_name) - 1));
+	CHECK(nextFreeInternedId(app_context, 0) == long_id);
+	
+	char short_name[] = "b";
+	u32 short_id = internString(app_context, short_name, sizeof(short_name) - 1);
+	CHECK(short_id == long_id);
+	
+	u32 length;
+	const char* chars = getInternedString(app_context, short_id, &length);
+	CHECK(chars != NULL && length == 1 && !strcmp(chars, "b"));
+	
+	// The old name is gone, and comes back with an id of its own
+	CHECK(internString(app_context, long_name, sizeof(long_name) - 1) != short_id);
+	CHECK(internString(app_context, short_name, sizeof(short_name) - 1) == short_id);
+	
+	ActionVar* var = getInternedVariable(app_context, short_id);
+	CHECK(var->type == ACTION_STACK_VALUE_STRING && var->str_size == 0 && var->value == 0);
+}
+
+int main()
+{
+	testRun("intern/delete_while_growing", testDeleteWhileGrowing);
+	testRun("intern/removed_ids_are_reused", testRemovedIdsAreReused);
+	testRun("intern/reused_entry_takes_new_name", testReusedEntryTakesNewName);
+	
+	return testFinish();
+}
\ No newline at end of file
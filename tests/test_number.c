@@ -0,0 +1,131 @@
+#include <math.h>
+
+#include <test.h>
+#include <action.h>
+#include <number.h>
+
+/**
+ * Number Coercion Tests
+ *
+ * Strings convert to numbers as in SWF 4 and 5: the number at the start
+ * of the string, ignoring the rest, or 0 if there's none.
+ */
+
+static double topNumber(SWFAppContext* app_context)
+{
+	if (STACK_TOP_TYPE == ACTION_STACK_VALUE_F32)
+	{
+		return VAL(float, &STACK_TOP_VALUE);
+	}
+	
+	return VAL(double, &STACK_TOP_VALUE);
+}
+
+static void testStringToNumber(SWFAppContext* app_context)
+{
+	CHECK(stringToNumber("12") == 12.0);
+	CHECK(stringToNumber("  3.5  ") == 3.5);
+	CHECK(stringToNumber("-2.5e-1") == -0.25);
+	CHECK(stringToNumber("+.5") == 0.5);
+	CHECK(stringToNumber("1e3") == 1000.0);
+	CHECK(stringToNumber("0x1A") == 26.0);
+	CHECK(stringToNumber("Infinity") == INFINITY);
+	CHECK(stringToNumber("-Infinity") == -INFINITY);
+}
+
+static void testLeadingNumberOnly(SWFAppContext* app_context)
+{
+	CHECK(stringToNumber("12abc") == 12.0);
+	CHECK(stringToNumber("12 34") == 12.0);
+	CHECK(stringToNumber("1.5.5") == 1.5);
+	CHECK(stringToNumber("1e") == 1.0);
+	CHECK(stringToNumber("2e+x") == 2.0);
+	CHECK(stringToNumber("0x1Ag") == 26.0);
+}
+
+static void testNoNumberIsZero(SWFAppContext* app_context)
+{
+	CHECK(stringToNumber("") == 0.0);
+	CHECK(stringToNumber("abc") == 0.0);
+	CHECK(stringToNumber("-") == 0.0);
+	CHECK(stringToNumber(".") == 0.0);
+	CHECK(stringToNumber("0x") == 0.0);
+	CHECK(stringToNumber("   ") == 0.0);
+}
+
+static void testStringPlusNumber(SWFAppContext* app_context)
+{
+	float one = 1.0f;
+	
+	PUSH_LITERAL("abc", 0);
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &one));
+	actionAdd(app_context);
+	
+	CHECK(topNumber(app_context) == 1.0);
+	POP();
+	
+	PUSH_LITERAL("12abc", 0);
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &one));
+	actionAdd(app_context);
+	
+	CHECK(topNumber(app_context) == 13.0);
+	POP();
+}
+
+static void testStringListToNumber(SWFAppContext* app_context)
+{
+	char a_str[CONVERT_STRING_SIZE];
+	char b_str[CONVERT_STRING_SIZE];
+	float three = 3.0f;
+	
+	// ("1" + "2")*3 through the typed variant
+	PUSH_LITERAL("1", 0);
+	PUSH_LITERAL("2", 0);
+	actionStringAdd(app_context, a_str, b_str);
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &three));
+	actionMultiplyStrNum(app_context);
+	
+	CHECK(topNumber(app_context) == 36.0);
+	POP();
+	
+	// And through the generic path, with trailing text in the second part
+	PUSH_LITERAL("4", 0);
+	PUSH_LITERAL("5px", 0);
+	actionStringAdd(app_context, a_str, b_str);
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &three));
+	actionSubtract(app_context);
+	
+	CHECK(topNumber(app_context) == 42.0);
+	POP();
+	
+	// Lists too long for the stack buffer
+	PUSH_LITERAL("                                                                7", 0);
+	PUSH_LITERAL("8", 0);
+	actionStringAdd(app_context, a_str, b_str);
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &three));
+	actionMultiplyStrNum(app_context);
+	
+	CHECK(topNumber(app_context) == 234.0);
+	POP();
+	
+	PUSH_LITERAL("0", 0);
+	PUSH_LITERAL(".5", 0);
+	actionStringAdd(app_context, a_str, b_str);
+	CHECK(evaluateCondition(app_context));
+	
+	PUSH_LITERAL("ab", 0);
+	PUSH_LITERAL("c", 0);
+	actionStringAdd(app_context, a_str, b_str);
+	CHECK(!evaluateCondition(app_context));
+}
+
+int main()
+{
+	testRun("number/string_to_number", testStringToNumber);
+	testRun("number/leading_number_only", testLeadingNumberOnly);
+	testRun("number/no_number_is_zero", testNoNumberIsZero);
+	testRun("number/string_plus_number", testStringPlusNumber);
+	testRun("number/string_list_to_number", testStringListToNumber);
+	
+	return testFinish();
+}
\ No newline at end of file
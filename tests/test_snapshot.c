@@ -0,0 +1,305 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <test.h>
+#include <action.h>
+#include <variables.h>
+#include <intern.h>
+#include <tracesink.h>
+#include <swfsnapshot.h>
+
+/**
+ * Snapshot Tests
+ *
+ * An instance restored from a snapshot has to be indistinguishable from
+ * the one the snapshot was taken of, and keep running the same way. The
+ * frames below leave strings of every kind in variables and on the stack
+ * between frames, and delete dynamic variables so the image has free ids.
+ */
+
+#define COUNTER_ID 1
+#define SHORT_ID 2
+#define LONG_ID 3
+
+// Numbers are converted into the frame's buffers, which string lists
+// borrow until the frame returns, as in generated code
+
+static void frameSetup(SWFAppContext* app_context)
+{
+	char a_str[CONVERT_STRING_SIZE];
+	char b_str[CONVERT_STRING_SIZE];
+	
+	float zero = 0.0f;
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &zero));
+	actionSetVariableById(app_context, COUNTER_ID);
+	
+	PUSH_LITERAL("ab", 0);
+	actionSetVariableById(app_context, SHORT_ID);
+	
+	PUSH_LITERAL("a string long enough to share", 0);
+	actionSetVariableById(app_context, LONG_ID);
+	
+	// Left on the stack: a constant, borrowed inline and shared chars,
+	// and a string list
+	PUSH_LITERAL("constant", 4);
+	actionGetVariableById(app_context, SHORT_ID);
+	actionGetVariableById(app_context, LONG_ID);
+	PUSH_LITERAL("r", 0);
+	PUSH_LITERAL("s", 0);
+	actionStringAdd(app_context, a_str, b_str);
+}
+
+static void frameLoop(SWFAppContext* app_context)
+{
+	char a_str[CONVERT_STRING_SIZE];
+	char b_str[CONVERT_STRING_SIZE];
+	
+	float one = 1.0f;
+	actionGetVariableById(app_context, COUNTER_ID);
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &one));
+	actionAdd(app_context);
+	actionSetVariableById(app_context, COUNTER_ID);
+	
+	// item<n> = n, and every third one is deleted again
+	PUSH_LITERAL("item", 0);
+	actionGetVariableById(app_context, COUNTER_ID);
+	actionStringAdd(app_context, a_str, b_str);
+	actionGetVariableById(app_context, COUNTER_ID);
+	actionSetVariable(app_context);
+	
+	PUSH_LITERAL("ab", 0);
+	actionGetVariableById(app_context, COUNTER_ID);
+	actionStringAdd(app_context, a_str, b_str);
+	actionSetVariableById(app_context, SHORT_ID);
+	
+	actionGetVariableById(app_context, LONG_ID);
+	PUSH_LITERAL("+", 0);
+	actionStringAdd(app_context, a_str, b_str);
+	actionSetVariableById(app_context, LONG_ID);
+	
+	ActionVar* counter = getVariableById(app_context, COUNTER_ID);
+	int n = (int) VAL(float, &counter->value);
+	
+	if (n%3 == 0)
+	{
+		char name[32];
+		int length = snprintf(name, sizeof(name), "item%d", n - 1);
+		deleteVariable(app_context, name, length);
+	}
+	
+	manual_next_frame = 1;
+	next_frame = 1;
+}
+
+static frame_func frames[] = { frameSetup, frameLoop };
+
+void tagInit(SWFAppContext* app_context)
+{
+}
+
+static TraceSinkConfig count_only = { TRACE_COUNT_ONLY };
+
+static void initInstance(SWFAppContext* app_context)
+{
+	memset(app_context, 0, sizeof(SWFAppContext));
+	app_context->frame_funcs = frames;
+	app_context->max_string_id = TEST_MAX_STRING_ID;
+	app_context->max_frames = SIZE_MAX;
+	app_context->virtual_time = 1;
+	app_context->quiet = 1;
+	app_context->trace_config = &count_only;
+	
+	if (!swfCreate(app_context))
+	{
+		exit(1);
+	}
+}
+
+static int sameChars(u32 a_length, const char* a, u32 b_length, const char* b)
+{
+	return a_length == b_length && (a_length == 0 || !memcmp(a, b, a_length));
+}
+
+static const char* varChars(ActionVar* var)
+{
+	return var->is_inline ? var->inline_str : (char*) var->value;
+}
+
+static int sameVar(ActionVar* a, ActionVar* b)
+{
+	if (a->type != b->type || a->string_id != b->string_id)
+	{
+		return 0;
+	}
+	
+	if (a->type == ACTION_STACK_VALUE_STRING)
+	{
+		return sameChars(a->str_size, varChars(a), b->str_size, varChars(b));
+	}
+	
+	return a->value == b->value;
+}
+
+// Reads a string slot or string list into out
+static u32 slotChars(char* stack, u32 sp, char* out)
+{
+	u64 value = VAL(u64, &stack[sp + 8]);
+	
+	if (stack[sp] == ACTION_STACK_VALUE_STRING)
+	{
+		u32 length = VAL(u32, &stack[sp + 4]);
+		memcpy(out, (char*) value, length);
+		
+		return length;
+	}
+	
+	u64* list = (u64*) value;
+	u32 length = 0;
+	
+	for (u64 i = 0; i < list[0]; ++i)
+	{
+		memcpy(out + length, (char*) list[1 + 2*i], list[2 + 2*i]);
+		length += (u32) list[2 + 2*i];
+	}
+	
+	return length;
+}
+
+static void checkSameState(SWFAppContext* a, SWFAppContext* b)
+{
+	CHECK(a->current_frame == b->current_frame);
+	CHECK(a->clock_frames == b->clock_frames);
+	
+	for (size_t i = 1; i < a->var_array_size; ++i)
+	{
+		CHECK(sameVar(&a->var_array[i], &b->var_array[i]));
+	}
+	
+	u32 count = internedStringCount(a);
+	CHECK(internedStringCount(b) == count);
+	
+	for (u32 id = TEST_MAX_STRING_ID + 1; id <= TEST_MAX_STRING_ID + count; ++id)
+	{
+		u32 a_length;
+		u32 b_length;
+		const char* a_chars = getInternedString(a, id, &a_length);
+		const char* b_chars = getInternedString(b, id, &b_length);
+		
+		CHECK((a_chars == NULL) == (b_chars == NULL));
+		
+		if (a_chars != NULL && b_chars != NULL)
+		{
+			CHECK(sameChars(a_length, a_chars, b_length, b_chars));
+			CHECK(sameVar(getInternedVariable(a, id), getInternedVariable(b, id)));
+		}
+	}
+	
+	u32 a_free = nextFreeInternedId(a, 0);
+	u32 b_free = nextFreeInternedId(b, 0);
+	
+	while (a_free != 0 && a_free == b_free)
+	{
+		a_free = nextFreeInternedId(a, a_free);
+		b_free = nextFreeInternedId(b, b_free);
+	}
+	
+	CHECK(a_free == b_free);
+	
+	CHECK(a->sp == b->sp);
+	
+	for (u32 sp = a->sp; a->sp == b->sp && sp < INITIAL_SP; sp += STACK_SLOT_SIZE)
+	{
+		CHECK(VAL(u32, &a->stack[sp]) == VAL(u32, &b->stack[sp]));
+		
+		if (a->stack[sp] == ACTION_STACK_VALUE_STRING || a->stack[sp] == ACTION_STACK_VALUE_STR_LIST)
+		{
+			static char a_chars[4096];
+			static char b_chars[4096];
+			
+			u32 a_length = slotChars(a->stack, sp, a_chars);
+			u32 b_length = slotChars(b->stack, sp, b_chars);
+			CHECK(sameChars(a_length, a_chars, b_length, b_chars));
+		}
+		
+		else
+		{
+			CHECK(VAL(u64, &a->stack[sp + 8]) == VAL(u64, &b->stack[sp + 8]));
+		}
+	}
+}
+
+static void testRoundTrip()
+{
+	SWFAppContext a;
+	SWFAppContext b;
+	SWFAppContext c;
+	
+	initInstance(&a);
+	CHECK(swfStepFrames(&a, 40) == 40);
+	
+	// What the image has to carry
+	CHECK(a.sp < INITIAL_SP);
+	CHECK(nextFreeInternedId(&a, 0) != 0);
+	
+	char* image;
+	size_t size = swfSnapshot(&a, &image);
+	CHECK(size != 0);
+	
+	initInstance(&b);
+	CHECK(swfRestore(&b, image, size));
+	checkSameState(&a, &b);
+	
+	// Both carry on the same way
+	CHECK(swfStepFrames(&a, 25) == 25);
+	CHECK(swfStepFrames(&b, 25) == 25);
+	checkSameState(&a, &b);
+	
+	// And a restored instance snapshots again
+	char* second_image;
+	size_t second_size = swfSnapshot(&b, &second_image);
+	CHECK(second_size != 0);
+	
+	initInstance(&c);
+	CHECK(swfRestore(&c, second_image, second_size));
+	CHECK(swfStepFrames(&a, 7) == 7);
+	CHECK(swfStepFrames(&c, 7) == 7);
+	checkSameState(&a, &c);
+	
+	free(image);
+	free(second_image);
+	
+	swfDestroy(&a);
+	swfDestroy(&b);
+	swfDestroy(&c);
+}
+
+static void testBadImages()
+{
+	SWFAppContext a;
+	SWFAppContext b;
+	
+	initInstance(&a);
+	CHECK(swfStepFrames(&a, 10) == 10);
+	
+	char* image;
+	size_t size = swfSnapshot(&a, &image);
+	CHECK(size != 0);
+	
+	// A truncated image fails, and so does restoring into a used instance
+	initInstance(&b);
+	CHECK(!swfRestore(&b, image, size - 9));
+	swfDestroy(&b);
+	
+	CHECK(!swfRestore(&a, image, size));
+	
+	free(image);
+	swfDestroy(&a);
+}
+
+int main()
+{
+	testRunInstances("snapshot/round_trip", testRoundTrip);
+	testRunInstances("snapshot/bad_images", testBadImages);
+	
+	return testFinish();
+}
\ No newline at end of file
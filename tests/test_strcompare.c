@@ -0,0 +1,142 @@
+#include <string.h>
+
+#include <test.h>
+#include <strcompare.h>
+
+/**
+ * String Comparison Tests
+ *
+ * The SIMD comparison has to agree with the byte-at-a-time one, whatever
+ * the lengths, the alignment of the chars and where segments split them.
+ */
+
+#define MAX_LENGTH 130
+#define MAX_ALIGN 32
+#define MAX_SEGMENTS 4
+
+// Seeded, so a failure shows up the same way every run
+static u64 random_state = 0x9E3779B97F4A7C15ull;
+
+static u32 nextRandom(u32 bound)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+	
+	return (u32) (random_state % bound);
+}
+
+static int sign(int x)
+{
+	return (x > 0) - (x < 0);
+}
+
+// Lengths and bytes only, the result compareStringSegments has to give
+static int referenceCompare(const u8* a, u32 a_length, const u8* b, u32 b_length)
+{
+	u32 n = a_length < b_length ? a_length : b_length;
+	int result = memcmp(a, b, n);
+	
+	if (result != 0)
+	{
+		return sign(result);
+	}
+	
+	return sign((int) a_length - (int) b_length);
+}
+
+// Cuts chars into up to MAX_SEGMENTS segments, empty ones included
+static u64 splitSegments(const u8* chars, u32 length, u64* segments)
+{
+	u64 num_segments = 1 + nextRandom(MAX_SEGMENTS);
+	u32 start = 0;
+	
+	for (u64 i = 0; i < num_segments; ++i)
+	{
+		u32 end = i + 1 == num_segments ? length : start + nextRandom(length - start + 1);
+		
+		segments[2*i] = (u64) (chars + start);
+		segments[2*i + 1] = end - start;
+		start = end;
+	}
+	
+	return num_segments;
+}
+
+static void checkPair(const u8* a, u32 a_length, const u8* b, u32 b_length)
+{
+	u64 a_segments[2*MAX_SEGMENTS];
+	u64 b_segments[2*MAX_SEGMENTS];
+	u64 num_a = splitSegments(a, a_length, a_segments);
+	u64 num_b = splitSegments(b, b_length, b_segments);
+	
+	int expected = referenceCompare(a, a_length, b, b_length);
+	
+	CHECK(sign(compareStringSegmentsScalar(a_segments, num_a, b_segments, num_b)) == expected);
+	CHECK(sign(compareStringSegments(a_segments, num_a, b_segments, num_b)) == expected);
+	CHECK(!equalStringSegments(a_segments, num_a, a_length, b_segments, num_b, b_length) == (expected != 0));
+}
+
+static void fillRandom(u8* chars, u32 length)
+{
+	// High bytes check the comparison is unsigned, zeros that it
+	// doesn't stop at a terminator
+	for (u32 i = 0; i < length; ++i)
+	{
+		chars[i] = nextRandom(4) == 0 ? (u8) (0x80 + nextRandom(0x80)) : (u8) ('a' + nextRandom(3));
+		
+		if (nextRandom(16) == 0)
+		{
+			chars[i] = 0;
+		}
+	}
+}
+
+static void testMatchesScalar(SWFAppContext* app_context)
+{
+	static u8 a_buffer[MAX_LENGTH + MAX_ALIGN];
+	static u8 b_buffer[MAX_LENGTH + MAX_ALIGN];
+	
+	for (u32 length = 0; length <= MAX_LENGTH; ++length)
+	{
+		for (u32 align = 0; align < MAX_ALIGN; ++align)
+		{
+			u8* a = a_buffer + align;
+			u8* b = b_buffer + (align*7)%MAX_ALIGN;
+			
+			fillRandom(a, length);
+			
+			// Equal
+			memcpy(b, a, length);
+			checkPair(a, length, b, length);
+			
+			if (length == 0)
+			{
+				continue;
+			}
+			
+			// One byte differs, anywhere including either side of a block
+			u32 at = nextRandom(length);
+			b[at] = (u8) (a[at] ^ (1 << nextRandom(8)));
+			checkPair(a, length, b, length);
+			checkPair(b, length, a, length);
+			b[at] = a[at];
+			
+			// One is a prefix of the other
+			u32 prefix = nextRandom(length);
+			checkPair(a, length, b, prefix);
+			checkPair(b, prefix, a, length);
+			
+			// Unrelated
+			fillRandom(b, length);
+			checkPair(a, length, b, length);
+		}
+	}
+}
+
+int main()
+{
+	testRun("strcompare/matches_scalar", testMatchesScalar);
+	
+	return testFinish();
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include <string.h>
+
+#include <test.h>
+#include <action.h>
+
+/**
+ * String List Arena Tests
+ *
+ * actionStringAdd builds string lists in an arena that's reclaimed last
+ * in, first out: lists whose stack slot has been popped are dropped from
+ * the top before each new list, and lists that die in the op that
+ * consumes them are built over.
+ */
+
+// Only for string operands, since a converted number would be left in
+// these buffers, which the result borrows
+static void add(SWFAppContext* app_context)
+{
+	char a_str[CONVERT_STRING_SIZE];
+	char b_str[CONVERT_STRING_SIZE];
+	
+	actionStringAdd(app_context, a_str, b_str);
+}
+
+static void testPoppedListIsReclaimed(SWFAppContext* app_context)
+{
+	PUSH_LITERAL("ab", 0);
+	PUSH_LITERAL("cd", 0);
+	add(app_context);
+	
+	CHECK(STACK_TOP_TYPE == ACTION_STACK_VALUE_STR_LIST);
+	CHECK(testTopEquals(app_context, "abcd"));
+	
+	u32 top = app_context->str_list_top;
+	POP();
+	
+	PUSH_LITERAL("ef", 0);
+	PUSH_LITERAL("gh", 0);
+	add(app_context);
+	
+	CHECK(app_context->str_list_last == 0);
+	CHECK(app_context->str_list_top == top);
+	CHECK(testTopEquals(app_context, "efgh"));
+	
+	POP();
+}
+
+static void testLiveListIsKept(SWFAppContext* app_context)
+{
+	PUSH_LITERAL("ab", 0);
+	PUSH_LITERAL("cd", 0);
+	add(app_context);
+	
+	u32 first_top = app_context->str_list_top;
+	
+	PUSH_LITERAL("x", 0);
+	PUSH_LITERAL("y", 0);
+	add(app_context);
+	
+	u32 second_top = app_context->str_list_top;
+	CHECK(app_context->str_list_last == first_top);
+	POP();
+	
+	// Only the popped list above the live one goes
+	PUSH_LITERAL("z", 0);
+	PUSH_LITERAL("w", 0);
+	add(app_context);
+	
+	CHECK(app_context->str_list_last == first_top);
+	CHECK(app_context->str_list_top == second_top);
+	CHECK(testTopEquals(app_context, "zw"));
+	POP();
+	
+	CHECK(testTopEquals(app_context, "abcd"));
+	POP();
+}
+
+static void testSlotReusedByAnotherValue(SWFAppContext* app_context)
+{
+	PUSH_LITERAL("ab", 0);
+	PUSH_LITERAL("cd", 0);
+	add(app_context);
+	POP();
+	
+	// Same slot, but no longer the list's, so the list isn't kept alive
+	PUSH_LITERAL("plain", 0);
+	PUSH_LITERAL("x", 0);
+	add(app_context);
+	
+	CHECK(app_context->str_list_last == 0);
+	CHECK(testTopEquals(app_context, "plainx"));
+	POP();
+}
+
+static void testChainBuildsOverItself(SWFAppContext* app_context)
+{
+	PUSH_LITERAL("s", 0);
+	PUSH_LITERAL("x", 0);
+	add(app_context);
+	
+	u32 top = app_context->str_list_top;
+	
+	for (u32 i = 1; i < 100; ++i)
+	{
+		PUSH_LITERAL("x", 0);
+		add(app_context);
+		
+		CHECK(app_context->str_list_last == 0);
+	}
+	
+	// Each op only adds its new segment's pointer and length
+	CHECK(app_context->str_list_top == top + 2*99);
+	CHECK(STACK_TOP_N == 101);
+	POP();
+}
+
+static void testArenaDoesNotGrow(SWFAppContext* app_context)
+{
+	PUSH_LITERAL("ab", 0);
+	PUSH_LITERAL("cd", 0);
+	add(app_context);
+	POP();
+	
+	u32 top = app_context->str_list_top;
+	
+	// Far more lists than fit in the arena at once
+	for (u32 i = 0; i < 2*STR_LIST_ARENA_SIZE/sizeof(u64); ++i)
+	{
+		PUSH_LITERAL("ab", 0);
+		PUSH_LITERAL("cd", 0);
+		add(app_context);
+		POP();
+	}
+	
+	CHECK(app_context->str_list_top == top);
+	CHECK(SP == INITIAL_SP);
+}
+
+int main()
+{
+	testRun("strlist/popped_list_is_reclaimed", testPoppedListIsReclaimed);
+	testRun("strlist/live_list_is_kept", testLiveListIsKept);
+	testRun("strlist/slot_reused_by_another_value", testSlotReusedByAnotherValue);
+	testRun("strlist/chain_builds_over_itself", testChainBuildsOverItself);
+	testRun("strlist/arena_does_not_grow", testArenaDoesNotGrow);
+	
+	return testFinish();
+}
\ No newline at end of file
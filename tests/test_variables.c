@@ -0,0 +1,194 @@
+#include <string.h>
+
+#include <test.h>
+#include <action.h>
+#include <variables.h>
+#include <sharedstring.h>
+
+/**
+ * Variable String Tests
+ *
+ * Stack slots borrow a variable's chars without a reference, both inline
+ * chars and shared strings, so overwriting the variable must leave what
+ * the stack already holds readable.
+ */
+
+#define VAR_ID 1
+
+// Only for string operands, since a converted number would be left in
+// these buffers, which the result borrows
+static void add(SWFAppContext* app_context)
+{
+	char a_str[CONVERT_STRING_SIZE];
+	char b_str[CONVERT_STRING_SIZE];
+	
+	actionStringAdd(app_context, a_str, b_str);
+}
+
+static int pointsInto(SWFAppContext* app_context, ActionVar* var)
+{
+	char* str = (char*) STACK_TOP_VALUE;
+	
+	return str >= var->inline_str && str < var->inline_str + ACTION_VAR_INLINE_SIZE;
+}
+
+static void testInlineStringIsEvacuated(SWFAppContext* app_context)
+{
+	ActionVar* var = getVariableById(app_context, VAR_ID);
+	
+	PUSH_LITERAL("abcd", 0);
+	actionSetVariableById(app_context, VAR_ID);
+	CHECK(var->is_inline && !var->inline_borrowed);
+	
+	actionGetVariableById(app_context, VAR_ID);
+	CHECK(var->inline_borrowed && pointsInto(app_context, var));
+	
+	PUSH_LITERAL("efgh", 0);
+	actionSetVariableById(app_context, VAR_ID);
+	
+	CHECK(!pointsInto(app_context, var));
+	CHECK(testTopEquals(app_context, "abcd"));
+	CHECK(var->is_inline && !strcmp(var->inline_str, "efgh"));
+	POP();
+}
+
+static void testInlineSegmentIsEvacuated(SWFAppContext* app_context)
+{
+	PUSH_LITERAL("abcd", 0);
+	actionSetVariableById(app_context, VAR_ID);
+	
+	// The list's segment borrows the chars, not a slot of its own
+	actionGetVariableById(app_context, VAR_ID);
+	PUSH_LITERAL("x", 0);
+	add(app_context);
+	
+	PUSH_LITERAL("efgh", 0);
+	actionSetVariableById(app_context, VAR_ID);
+	
+	CHECK(testTopEquals(app_context, "abcdx"));
+	POP();
+}
+
+static void testUnborrowedInlineString(SWFAppContext* app_context)
+{
+	ActionVar* var = getVariableById(app_context, VAR_ID);
+	
+	PUSH_LITERAL("abcd", 0);
+	actionSetVariableById(app_context, VAR_ID);
+	
+	u64 allocs = app_context->heap_allocs;
+	
+	PUSH_LITERAL("efgh", 0);
+	actionSetVariableById(app_context, VAR_ID);
+	
+	CHECK(app_context->heap_allocs == allocs);
+	CHECK(var->is_inline && !var->inline_borrowed);
+}
+
+static void testDynamicInlineStringIsEvacuated(SWFAppContext* app_context)
+{
+	PUSH_LITERAL("name", 0);
+	PUSH_LITERAL("abcd", 0);
+	actionSetVariable(app_context);
+	
+	PUSH_LITERAL("name", 0);
+	actionGetVariable(app_context);
+	
+	PUSH_LITERAL("name", 0);
+	PUSH_LITERAL("efgh", 0);
+	actionSetVariable(app_context);
+	
+	CHECK(testTopEquals(app_context, "abcd"));
+	POP();
+}
+
+static void testSharedStringOutlivesVariable(SWFAppContext* app_context)
+{
+	ActionVar* var = getVariableById(app_context, VAR_ID);
+	
+	PUSH_LITERAL("a string too long to be inline", 0);
+	actionSetVariableById(app_context, VAR_ID);
+	CHECK(var->owns_memory);
+	
+	actionGetVariableById(app_context, VAR_ID);
+	char* borrowed = (char*) STACK_TOP_VALUE;
+	CHECK(borrowed == var->heap_ptr);
+	
+	PUSH_LITERAL("another string too long to be inline", 0);
+	actionSetVariableById(app_context, VAR_ID);
+	
+	// Still queued, since the stack uses it, so new strings go elsewhere
+	u64 frees = app_context->heap_frees;
+	reclaimSharedStrings(app_context);
+	CHECK(app_context->heap_frees == frees);
+	
+	for (u32 i = 0; i < 4; ++i)
+	{
+		char* other = allocSharedString(app_context, 32);
+		memset(other, 'z', 31);
+		other[31] = '\0';
+		releaseSharedString(app_context, other);
+	}
+	
+	CHECK((char*) STACK_TOP_VALUE == borrowed);
+	CHECK(testTopEquals(app_context, "a string too long to be inline"));
+	
+	POP();
+	reclaimSharedStrings(app_context);
+	CHECK(app_context->heap_frees > frees);
+}
+
+static void testBorrowedStringKeepsLength(SWFAppContext* app_context)
+{
+	ActionVar* var = getVariableById(app_context, VAR_ID);
+	float one = 1.0f;
+	
+	// The first append moves s to a buffer with room to spare
+	PUSH_LITERAL("0000000000000000001", 0);
+	actionSetVariableById(app_context, VAR_ID);
+	actionGetVariableById(app_context, VAR_ID);
+	PUSH_LITERAL("2", 0);
+	add(app_context);
+	actionSetVariableById(app_context, VAR_ID);
+	
+	// One borrowed "...12" to convert, and one to assign to t, which then
+	// shares the buffer
+	actionGetVariableById(app_context, VAR_ID);
+	char* borrowed = (char*) STACK_TOP_VALUE;
+	PUSH_LITERAL("t", 0);
+	actionGetVariableById(app_context, VAR_ID);
+	
+	// s = s + "3" is appended in place over the borrowed terminator
+	actionGetVariableById(app_context, VAR_ID);
+	PUSH_LITERAL("3", 0);
+	add(app_context);
+	actionSetVariableById(app_context, VAR_ID);
+	CHECK(var->heap_ptr == borrowed);
+	
+	actionSetVariable(app_context);
+	
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &one));
+	actionMultiplyStrNum(app_context);
+	CHECK(VAL(double, &STACK_TOP_VALUE) == 12.0);
+	POP();
+	
+	PUSH_LITERAL("t", 0);
+	actionGetVariable(app_context);
+	PUSH(ACTION_STACK_VALUE_F32, VAL(u32, &one));
+	actionAdd(app_context);
+	CHECK(STACK_TOP_TYPE == ACTION_STACK_VALUE_F64);
+	CHECK(VAL(double, &STACK_TOP_VALUE) == 13.0);
+	POP();
+}
+
+int main()
+{
+	testRun("variables/inline_string_is_evacuated", testInlineStringIsEvacuated);
+	testRun("variables/inline_segment_is_evacuated", testInlineSegmentIsEvacuated);
+	testRun("variables/unborrowed_inline_string", testUnborrowedInlineString);
+	testRun("variables/dynamic_inline_string_is_evacuated", testDynamicInlineStringIsEvacuated);
+	testRun("variables/shared_string_outlives_variable", testSharedStringOutlivesVariable);
+	testRun("variables/borrowed_string_keeps_length", testBorrowedStringKeepsLength);
+	
+	return testFinish();
+}
\ No newline at end of file